@@ -0,0 +1,119 @@
+/**********************************************************/
+/*                                                        */
+/* File: admission.c                                      */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Admission of new flows into the cache     */
+/*                                                        */
+/**********************************************************/
+
+#include "admission.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/time.h>
+
+/*
+ * Function for the admission initialization.
+ *
+ * @param admission         Pointer to the admission storage.
+ * @param packets_threshold The number of packets which admits the flow.
+ * @param octets_threshold  The number of bytes which admits the flow
+ *                          or 0 if the bytes are not checked.
+ * @param period_seconds    The period of clearing the sketch.
+ */
+void admission_init (flow_admission_t admission,
+                     uint32_t packets_threshold,
+                     uint32_t octets_threshold,
+                     uint32_t period_seconds)
+{
+    memset(admission->sketch, 0, sizeof(admission->sketch));
+
+    admission->packets_threshold = packets_threshold;
+    admission->octets_threshold = octets_threshold;
+    admission->period_seconds = period_seconds;
+    admission->period_started = false;
+    admission->admitted_flows = 0;
+    admission->aggregated_packets = 0;
+}
+
+/*
+ * Function for counting the packet of a flow which is not cached
+ * and deciding if the flow is admitted into the flow cache.
+ *
+ * @param admission         Pointer to the admission storage.
+ * @param flow_hash         The hash of the flow key.
+ * @param packet_time_stamp The time stamp of the packet.
+ * @param packet_bytes      The number of Layer 3 bytes in the packet.
+ * @return                  True if the flow is admitted, false if the packet
+ *                          belongs to the aggregated mice.
+ */
+bool admission_admit (flow_admission_t admission,
+                      uint32_t flow_hash,
+                      const struct timeval* packet_time_stamp,
+                      uint16_t packet_bytes)
+{
+    admission_counter_t counters[ADMISSION_SKETCH_ROWS];
+    uint32_t packets = UINT32_MAX;
+    uint32_t octets = UINT32_MAX;
+
+    if (!admission->period_started ||
+        packet_time_stamp->tv_sec - admission->period_start.tv_sec >=
+        (time_t) admission->period_seconds)
+    {
+        memset(admission->sketch, 0, sizeof(admission->sketch));
+
+        admission->period_start = *packet_time_stamp;
+        admission->period_started = true;
+    }
+
+    // The rows are indexed by the independent halves of the hash.
+    counters[0] = &(admission->sketch[0][flow_hash & (ADMISSION_SKETCH_WIDTH - 1)]);
+    counters[1] = &(admission->sketch[1][flow_hash >> (32 - ADMISSION_SKETCH_BITS)]);
+
+    for (int i = 0; i < ADMISSION_SKETCH_ROWS; i++)
+    {
+        if (counters[i]->packets < packets)
+        {
+            packets = counters[i]->packets;
+        }
+
+        if (counters[i]->octets < octets)
+        {
+            octets = counters[i]->octets;
+        }
+    }
+
+    packets += 1;
+    octets += packet_bytes;
+
+    // Conservative update, only the counters below the new estimate
+    // are raised. It reduces the overestimation by the colliding flows.
+    for (int i = 0; i < ADMISSION_SKETCH_ROWS; i++)
+    {
+        if (counters[i]->packets < packets)
+        {
+            counters[i]->packets = packets;
+        }
+
+        if (counters[i]->octets < octets)
+        {
+            counters[i]->octets = octets;
+        }
+    }
+
+    if (packets >= admission->packets_threshold ||
+        (admission->octets_threshold != 0 && octets >= admission->octets_threshold))
+    {
+        admission->admitted_flows++;
+
+        return true;
+    }
+
+    admission->aggregated_packets++;
+
+    return false;
+}
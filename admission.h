@@ -0,0 +1,84 @@
+/**********************************************************/
+/*                                                        */
+/* File: admission.h                                      */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Header file for the new flow admission    */
+/*                                                        */
+/**********************************************************/
+
+#ifndef FLOW_ADMISSION_H
+#define FLOW_ADMISSION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+#define ADMISSION_SKETCH_ROWS  (2)
+#define ADMISSION_SKETCH_BITS  (16)
+#define ADMISSION_SKETCH_WIDTH (1 << ADMISSION_SKETCH_BITS)
+
+typedef struct admission_counter* admission_counter_t;
+typedef struct flow_admission* flow_admission_t;
+
+/*
+ * Structure to store a counter of the count-min sketch.
+ */
+struct admission_counter
+{
+    uint32_t packets;
+    uint32_t octets;
+};
+
+/*
+ * Structure to store the admission of new flows. The packets of the flows
+ * not yet cached are counted by a count-min sketch indexed by the flow hash.
+ * A flow is admitted into the flow cache when the estimated number
+ * of its packets or bytes reaches the threshold. The sketch is cleared
+ * every period, so the flows have to reach the threshold within the period.
+ */
+struct flow_admission
+{
+    struct admission_counter sketch[ADMISSION_SKETCH_ROWS][ADMISSION_SKETCH_WIDTH];
+    uint32_t packets_threshold;
+    uint32_t octets_threshold;     // 0 if the bytes are not checked.
+    uint32_t period_seconds;       // The period of clearing the sketch.
+    struct timeval period_start;
+    bool period_started;
+    uint64_t admitted_flows;
+    uint64_t aggregated_packets;
+};
+
+/*
+ * Function for the admission initialization.
+ *
+ * @param admission         Pointer to the admission storage.
+ * @param packets_threshold The number of packets which admits the flow.
+ * @param octets_threshold  The number of bytes which admits the flow
+ *                          or 0 if the bytes are not checked.
+ * @param period_seconds    The period of clearing the sketch.
+ */
+void admission_init (flow_admission_t admission,
+                     uint32_t packets_threshold,
+                     uint32_t octets_threshold,
+                     uint32_t period_seconds);
+
+/*
+ * Function for counting the packet of a flow which is not cached
+ * and deciding if the flow is admitted into the flow cache.
+ *
+ * @param admission         Pointer to the admission storage.
+ * @param flow_hash         The hash of the flow key.
+ * @param packet_time_stamp The time stamp of the packet.
+ * @param packet_bytes      The number of Layer 3 bytes in the packet.
+ * @return                  True if the flow is admitted, false if the packet
+ *                          belongs to the aggregated mice.
+ */
+bool admission_admit (flow_admission_t admission,
+                      uint32_t flow_hash,
+                      const struct timeval* packet_time_stamp,
+                      uint16_t packet_bytes);
+
+#endif // FLOW_ADMISSION_H
@@ -0,0 +1,88 @@
+/**********************************************************/
+/*                                                        */
+/* File: aggregation.c                                    */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Aggregation schemes of the flow keys      */
+/*                                                        */
+/**********************************************************/
+
+#include "aggregation.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * The names of the aggregation schemes.
+ */
+static const char* scheme_names[AGGREGATION_SCHEMES_NUMBER] =
+{
+    "none",
+    "prefix",
+    "source-prefix",
+    "protocol-port",
+    "protocol"
+};
+
+/*
+ * Function for parsing the aggregation scheme name.
+ *
+ * @param name The name of the scheme.
+ * @return     The scheme or AGGREGATION_SCHEMES_NUMBER for an unknown name.
+ */
+uint8_t aggregation_parse_scheme (const char* name)
+{
+    uint8_t scheme;
+
+    for (scheme = 0; scheme < AGGREGATION_SCHEMES_NUMBER; scheme++)
+    {
+        if (strcmp(name, scheme_names[scheme]) == 0)
+        {
+            break;
+        }
+    }
+
+    return scheme;
+}
+
+/*
+ * Function for getting the name of the aggregation scheme.
+ *
+ * @param scheme The aggregation scheme.
+ * @return       The name of the scheme.
+ */
+const char* aggregation_scheme_name (uint8_t scheme)
+{
+    if (scheme >= AGGREGATION_SCHEMES_NUMBER)
+    {
+        scheme = AGGREGATION_NONE;
+    }
+
+    return scheme_names[scheme];
+}
+
+/*
+ * Function for getting the prefix lengths of the aggregated addresses.
+ *
+ * @param scheme   The aggregation scheme.
+ * @param src_mask Output parameter that contains the source prefix length.
+ * @param dst_mask Output parameter that contains the destination prefix
+ *                 length.
+ */
+void aggregation_masks (uint8_t scheme, uint8_t* src_mask, uint8_t* dst_mask)
+{
+    *src_mask = 0;
+    *dst_mask = 0;
+
+    if (scheme == AGGREGATION_PREFIX || scheme == AGGREGATION_SOURCE_PREFIX)
+    {
+        *src_mask = AGGREGATION_PREFIX_BITS;
+    }
+
+    if (scheme == AGGREGATION_PREFIX)
+    {
+        *dst_mask = AGGREGATION_PREFIX_BITS;
+    }
+}
@@ -0,0 +1,113 @@
+/**********************************************************/
+/*                                                        */
+/* File: aggregation.h                                    */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Header file for the flow aggregation      */
+/*                                                        */
+/**********************************************************/
+
+#ifndef FLOW_AGGREGATION_H
+#define FLOW_AGGREGATION_H
+
+#include <arpa/inet.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "netflow_v5.h"
+
+#define AGGREGATION_PREFIX_BITS (24) // The prefix length of the prefix schemes.
+
+/*
+ * Enumeration of the aggregation schemes.
+ */
+enum aggregation_scheme
+{
+    AGGREGATION_NONE,          // The full key.
+    AGGREGATION_PREFIX,        // Source and destination /24 prefix pair.
+    AGGREGATION_SOURCE_PREFIX, // Source /24 prefix.
+    AGGREGATION_PROTOCOL_PORT, // Protocol and destination port.
+    AGGREGATION_PROTOCOL,      // Protocol.
+    AGGREGATION_SCHEMES_NUMBER
+};
+
+/*
+ * The mask of a prefix in the network byte order.
+ */
+#define PREFIX_MASK(bits) ((bits) == 0 ? 0 : htonl(UINT32_MAX << (32 - (bits))))
+
+/*
+ * Reduction of a key to the fields of a scheme. The arguments are constants,
+ * so every scheme is compiled into its own code without any branches.
+ */
+#define AGGREGATE_KEY(key, src_bits, dst_bits, keep_prot, keep_src_port, keep_dst_port, keep_tos) \
+    do                                                                  \
+    {                                                                   \
+        (key)->src_addr &= PREFIX_MASK(src_bits);                       \
+        (key)->dst_addr &= PREFIX_MASK(dst_bits);                       \
+        (key)->prot = (keep_prot) ? (key)->prot : 0;                    \
+        (key)->src_port = (keep_src_port) ? (key)->src_port : 0;        \
+        (key)->dst_port = (keep_dst_port) ? (key)->dst_port : 0;        \
+        (key)->tos = (keep_tos) ? (key)->tos : 0;                       \
+    } while (0)
+
+/*
+ * Function for parsing the aggregation scheme name.
+ *
+ * @param name The name of the scheme.
+ * @return     The scheme or AGGREGATION_SCHEMES_NUMBER for an unknown name.
+ */
+uint8_t aggregation_parse_scheme (const char* name);
+
+/*
+ * Function for getting the name of the aggregation scheme.
+ *
+ * @param scheme The aggregation scheme.
+ * @return       The name of the scheme.
+ */
+const char* aggregation_scheme_name (uint8_t scheme);
+
+/*
+ * Function for getting the prefix lengths of the aggregated addresses.
+ *
+ * @param scheme   The aggregation scheme.
+ * @param src_mask Output parameter that contains the source prefix length.
+ * @param dst_mask Output parameter that contains the destination prefix
+ *                 length.
+ */
+void aggregation_masks (uint8_t scheme, uint8_t* src_mask, uint8_t* dst_mask);
+
+/*
+ * Function for reducing a flow key to the fields of the aggregation scheme.
+ * The function is called for every packet, so it is inlined and the scheme
+ * selects the code specialized for it.
+ *
+ * @param key    Pointer to the flow key.
+ * @param scheme The aggregation scheme.
+ */
+static inline void aggregate_key (netflow_v5_key_t key, uint8_t scheme)
+{
+    switch (scheme)
+    {
+        case AGGREGATION_PREFIX:
+            AGGREGATE_KEY(key, AGGREGATION_PREFIX_BITS, AGGREGATION_PREFIX_BITS,
+                          false, false, false, false);
+            break;
+        case AGGREGATION_SOURCE_PREFIX:
+            AGGREGATE_KEY(key, AGGREGATION_PREFIX_BITS, 0,
+                          false, false, false, false);
+            break;
+        case AGGREGATION_PROTOCOL_PORT:
+            AGGREGATE_KEY(key, 0, 0, true, false, true, false);
+            break;
+        case AGGREGATION_PROTOCOL:
+            AGGREGATE_KEY(key, 0, 0, true, false, false, false);
+            break;
+        default:
+            break;
+    }
+}
+
+#endif // FLOW_AGGREGATION_H
@@ -0,0 +1,859 @@
+/**********************************************************/
+/*                                                        */
+/* File: arrow.c                                          */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Arrow IPC flow file                       */
+/*                                                        */
+/**********************************************************/
+
+#include "arrow.h"
+
+#include <arpa/inet.h>
+#include <endian.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "error.h"
+
+#define ARROW_CONTINUATION     (UINT32_C(0xFFFFFFFF))
+#define ARROW_METADATA_V5      (4)
+#define ARROW_HEADER_SCHEMA    (1)
+#define ARROW_HEADER_BATCH     (3)
+#define ARROW_TYPE_INT         (2)
+#define ARROW_TYPE_TIMESTAMP   (10)
+#define ARROW_UNIT_MILLISECOND (1)
+#define ARROW_FIELD_NODE_SIZE  (16)
+#define ARROW_BUFFER_SIZE      (16)
+#define ARROW_BLOCK_SIZE       (24)
+#define ARROW_GATHER_SIZE      (256) // The reverse directions gathered at once.
+
+/*
+ * Enumeration of the columns.
+ */
+enum arrow_column_index
+{
+    ARROW_SRC_ADDR,
+    ARROW_DST_ADDR,
+    ARROW_SRC_PORT,
+    ARROW_DST_PORT,
+    ARROW_PROTOCOL,
+    ARROW_TOS,
+    ARROW_TCP_FLAGS,
+    ARROW_PACKETS,
+    ARROW_OCTETS,
+    ARROW_FIRST,
+    ARROW_LAST
+};
+
+/*
+ * Structure to store the schema of a column. The addresses are unsigned
+ * integers in the host byte order, the times are timestamps in milliseconds.
+ */
+struct arrow_column
+{
+    const char* name;
+    uint8_t type;
+    uint8_t width;
+    bool is_signed;
+};
+
+static const struct arrow_column arrow_columns[ARROW_COLUMNS_NUMBER] =
+{
+    { "src_addr",  ARROW_TYPE_INT,       4, false },
+    { "dst_addr",  ARROW_TYPE_INT,       4, false },
+    { "src_port",  ARROW_TYPE_INT,       2, false },
+    { "dst_port",  ARROW_TYPE_INT,       2, false },
+    { "protocol",  ARROW_TYPE_INT,       1, false },
+    { "tos",       ARROW_TYPE_INT,       1, false },
+    { "tcp_flags", ARROW_TYPE_INT,       1, false },
+    { "packets",   ARROW_TYPE_INT,       8, false },
+    { "octets",    ARROW_TYPE_INT,       8, false },
+    { "first",     ARROW_TYPE_TIMESTAMP, 8, true },
+    { "last",      ARROW_TYPE_TIMESTAMP, 8, true }
+};
+
+/*
+ * Function for getting the size of a row of the columns.
+ *
+ * @return The size of a row in bytes.
+ */
+size_t arrow_row_size (void)
+{
+    size_t row_size = 0;
+
+    for (uint8_t i = 0; i < ARROW_COLUMNS_NUMBER; i++)
+    {
+        row_size += arrow_columns[i].width;
+    }
+
+    return row_size;
+}
+
+/*
+ * Function for getting the size of a value of a column.
+ *
+ * @param column The index of the column.
+ * @return       The size of a value in bytes.
+ */
+size_t arrow_column_width (uint8_t column)
+{
+    return arrow_columns[column].width;
+}
+
+/*
+ * The helper function for rounding a size up to the alignment.
+ *
+ * @param size The size.
+ * @return     The aligned size.
+ */
+static uint64_t arrow_align (uint64_t size)
+{
+    return (size + ARROW_ALIGNMENT - 1) & ~(uint64_t) (ARROW_ALIGNMENT - 1);
+}
+
+/*
+ * The helper function for starting the metadata. The buffer is grown
+ * to the size, the metadata never exceeds it.
+ *
+ * @param builder Pointer to the builder.
+ * @param size    The maximum size of the metadata.
+ * @return        Status of function processing.
+ */
+static uint8_t arrow_builder_start (arrow_builder_t builder, size_t size)
+{
+    uint8_t* data;
+
+    if (builder->capacity < size)
+    {
+        data = (uint8_t*) realloc(builder->data, size);
+
+        if (data == NULL)
+        {
+            return MEMORY_HANDLING_ERROR;
+        }
+
+        builder->data = data;
+        builder->capacity = size;
+    }
+
+    builder->length = 0;
+
+    return NO_ERROR;
+}
+
+/*
+ * The helper function for reserving zeroed bytes of the metadata.
+ *
+ * @param builder Pointer to the builder.
+ * @param size    The reserved size.
+ * @param align   The alignment of the reserved bytes.
+ * @return        The position of the reserved bytes.
+ */
+static size_t arrow_reserve (arrow_builder_t builder, size_t size, size_t align)
+{
+    size_t position = (builder->length + align - 1) & ~(align - 1);
+
+    memset(builder->data + builder->length, 0, position + size - builder->length);
+    builder->length = position + size;
+
+    return position;
+}
+
+/*
+ * The helper functions for storing the little-endian scalars
+ * of the metadata.
+ *
+ * @param builder  Pointer to the builder.
+ * @param position The position of the scalar.
+ * @param value    The stored value.
+ */
+static void arrow_put8 (arrow_builder_t builder, size_t position, uint8_t value)
+{
+    builder->data[position] = value;
+}
+
+static void arrow_put16 (arrow_builder_t builder, size_t position, uint16_t value)
+{
+    value = htole16(value);
+    memcpy(builder->data + position, &value, sizeof(value));
+}
+
+static void arrow_put32 (arrow_builder_t builder, size_t position, uint32_t value)
+{
+    value = htole32(value);
+    memcpy(builder->data + position, &value, sizeof(value));
+}
+
+static void arrow_put64 (arrow_builder_t builder, size_t position, uint64_t value)
+{
+    value = htole64(value);
+    memcpy(builder->data + position, &value, sizeof(value));
+}
+
+/*
+ * The helper function for storing an offset to a following table, vector
+ * or string.
+ *
+ * @param builder  Pointer to the builder.
+ * @param position The position of the offset.
+ * @param target   The position of the referenced object.
+ */
+static void arrow_put_offset (arrow_builder_t builder, size_t position, size_t target)
+{
+    arrow_put32(builder, position, (uint32_t) (target - position));
+}
+
+/*
+ * The helper function for adding a table. The fields are placed
+ * by the decreasing size, so they stay aligned, and the vtable follows
+ * the table.
+ *
+ * @param builder       Pointer to the builder.
+ * @param fields_number The number of fields of the table.
+ * @param sizes         The sizes of the fields, 0 if the field is absent.
+ * @param positions     Output parameter for the positions of the fields.
+ * @return              The position of the table.
+ */
+static size_t arrow_table (arrow_builder_t builder,
+                           uint8_t fields_number,
+                           const uint8_t* sizes,
+                           size_t* positions)
+{
+    size_t table_size = sizeof(int32_t);
+    size_t table;
+    size_t vtable;
+
+    memset(positions, 0, fields_number * sizeof(size_t));
+
+    for (uint8_t size = 8; size > 0; size /= 2)
+    {
+        for (uint8_t i = 0; i < fields_number; i++)
+        {
+            if (sizes[i] == size)
+            {
+                table_size = (table_size + size - 1) & ~((size_t) size - 1);
+                positions[i] = table_size;
+                table_size += size;
+            }
+        }
+    }
+
+    table = arrow_reserve(builder, table_size, 8);
+    vtable = arrow_reserve(builder, 2 * (2 + (size_t) fields_number), 2);
+
+    arrow_put16(builder, vtable, (uint16_t) (2 * (2 + fields_number)));
+    arrow_put16(builder, vtable + 2, (uint16_t) table_size);
+
+    for (uint8_t i = 0; i < fields_number; i++)
+    {
+        arrow_put16(builder, vtable + 4 + 2 * i, (sizes[i] > 0) ? (uint16_t) positions[i] : 0);
+        positions[i] += table;
+    }
+
+    // The vtable is found at the table position minus the signed offset.
+    arrow_put32(builder, table, (uint32_t) (int32_t) ((int64_t) table - (int64_t) vtable));
+
+    return table;
+}
+
+/*
+ * The helper function for adding a vector. The elements are zeroed.
+ *
+ * @param builder      Pointer to the builder.
+ * @param count        The number of elements.
+ * @param element_size The size of an element.
+ * @param align        The alignment of the elements.
+ * @return             The position of the vector length, the elements follow.
+ */
+static size_t arrow_vector (arrow_builder_t builder,
+                            uint32_t count,
+                            size_t element_size,
+                            size_t align)
+{
+    size_t position;
+
+    // The elements after the length have to be aligned.
+    while ((builder->length + sizeof(uint32_t)) % align != 0)
+    {
+        builder->data[builder->length++] = 0;
+    }
+
+    position = arrow_reserve(builder, sizeof(uint32_t) + count * element_size, 1);
+    arrow_put32(builder, position, count);
+
+    return position;
+}
+
+/*
+ * The helper function for adding a zero-terminated string.
+ *
+ * @param builder Pointer to the builder.
+ * @param string  The string.
+ * @return        The position of the string length.
+ */
+static size_t arrow_string (arrow_builder_t builder, const char* string)
+{
+    size_t length = strlen(string);
+    size_t position = arrow_vector(builder, (uint32_t) length + 1, 1, sizeof(uint32_t));
+
+    arrow_put32(builder, position, (uint32_t) length);
+    memcpy(builder->data + position + sizeof(uint32_t), string, length);
+
+    return position;
+}
+
+/*
+ * The helper function for adding the schema table of the flow columns.
+ *
+ * @param builder Pointer to the builder.
+ * @return        The position of the schema table.
+ */
+static size_t arrow_schema (arrow_builder_t builder)
+{
+    // endianness, fields
+    static const uint8_t schema_sizes[] = { 2, 4 };
+    // name, nullable, type_type, type, dictionary, children
+    static const uint8_t field_sizes[] = { 4, 1, 1, 4, 0, 4 };
+    // bitWidth, is_signed
+    static const uint8_t int_sizes[] = { 4, 1 };
+    // unit, timezone
+    static const uint8_t timestamp_sizes[] = { 2, 4 };
+    size_t schema[2];
+    size_t field[6];
+    size_t type[2];
+    size_t schema_table;
+    size_t fields;
+    size_t position;
+
+    schema_table = arrow_table(builder, 2, schema_sizes, schema);
+    arrow_put16(builder, schema[0], (BYTE_ORDER == BIG_ENDIAN) ? 1 : 0);
+
+    fields = arrow_vector(builder, ARROW_COLUMNS_NUMBER, sizeof(uint32_t), sizeof(uint32_t));
+    arrow_put_offset(builder, schema[1], fields);
+
+    for (uint8_t i = 0; i < ARROW_COLUMNS_NUMBER; i++)
+    {
+        position = arrow_table(builder, 6, field_sizes, field);
+        arrow_put_offset(builder, fields + sizeof(uint32_t) * (1 + i), position);
+
+        arrow_put8(builder, field[1], 0);
+        arrow_put8(builder, field[2], arrow_columns[i].type);
+        arrow_put_offset(builder, field[0], arrow_string(builder, arrow_columns[i].name));
+
+        if (arrow_columns[i].type == ARROW_TYPE_TIMESTAMP)
+        {
+            position = arrow_table(builder, 2, timestamp_sizes, type);
+            arrow_put16(builder, type[0], ARROW_UNIT_MILLISECOND);
+            arrow_put_offset(builder, type[1], arrow_string(builder, "UTC"));
+        }
+        else
+        {
+            position = arrow_table(builder, 2, int_sizes, type);
+            arrow_put32(builder, type[0], 8 * (uint32_t) arrow_columns[i].width);
+            arrow_put8(builder, type[1], arrow_columns[i].is_signed);
+        }
+
+        arrow_put_offset(builder, field[3], position);
+        // The primitive columns have no children, the vector is required.
+        arrow_put_offset(builder, field[5], arrow_vector(builder, 0, 0, sizeof(uint32_t)));
+    }
+
+    return schema_table;
+}
+
+/*
+ * The helper function for adding the message table, its header table
+ * follows.
+ *
+ * @param builder     Pointer to the builder.
+ * @param header_type The type of the header.
+ * @param body_length The length of the message body.
+ * @return            The position of the header offset.
+ */
+static size_t arrow_message (arrow_builder_t builder, uint8_t header_type, uint64_t body_length)
+{
+    // version, header_type, header, bodyLength
+    static const uint8_t message_sizes[] = { 2, 1, 4, 8 };
+    size_t message[4];
+    size_t root = arrow_reserve(builder, sizeof(uint32_t), sizeof(uint32_t));
+
+    arrow_put_offset(builder, root, arrow_table(builder, 4, message_sizes, message));
+    arrow_put16(builder, message[0], ARROW_METADATA_V5);
+    arrow_put8(builder, message[1], header_type);
+    arrow_put64(builder, message[3], body_length);
+
+    return message[2];
+}
+
+/*
+ * The helper function for writing bytes to the file.
+ *
+ * @param writer Pointer to the writer.
+ * @param data   The written bytes.
+ * @param size   The number of bytes.
+ * @return       Status of function processing.
+ */
+static uint8_t arrow_write (arrow_writer_t writer, const void* data, size_t size)
+{
+    if (size > 0 && fwrite(data, 1, size, writer->file) != size)
+    {
+        return ARROW_FILE_ERROR;
+    }
+
+    writer->file_offset += size;
+
+    return NO_ERROR;
+}
+
+/*
+ * The helper function for writing the encapsulated metadata. The metadata
+ * is padded to the alignment and prefixed by the continuation marker
+ * and its length.
+ *
+ * @param writer Pointer to the writer.
+ * @return       Status of function processing.
+ */
+static uint8_t arrow_write_metadata (arrow_writer_t writer)
+{
+    uint32_t prefix[2];
+
+    arrow_reserve(&(writer->builder), arrow_align(writer->builder.length) -
+                  writer->builder.length, 1);
+
+    prefix[0] = htole32(ARROW_CONTINUATION);
+    prefix[1] = htole32((uint32_t) writer->builder.length);
+
+    if (arrow_write(writer, prefix, sizeof(prefix)) != NO_ERROR)
+    {
+        return ARROW_FILE_ERROR;
+    }
+
+    return arrow_write(writer, writer->builder.data, writer->builder.length);
+}
+
+/*
+ * The helper function for writing the current record batch. Every column
+ * has an empty validity buffer (no nulls) and the data buffer.
+ *
+ * @param writer Pointer to the writer.
+ * @return       Status of function processing.
+ */
+static uint8_t arrow_write_batch (arrow_writer_t writer)
+{
+    static const uint8_t padding[ARROW_ALIGNMENT] = { 0 };
+    // length, nodes, buffers
+    static const uint8_t batch_sizes[] = { 8, 4, 4 };
+    uint8_t status;
+    size_t batch[3];
+    size_t header;
+    size_t nodes;
+    size_t buffers;
+    size_t length;
+    uint64_t body_length = 0;
+    struct arrow_block* blocks;
+    arrow_builder_t builder = &(writer->builder);
+
+    for (uint8_t i = 0; i < ARROW_COLUMNS_NUMBER; i++)
+    {
+        body_length += arrow_align((uint64_t) writer->rows_number * arrow_columns[i].width);
+    }
+
+    if (writer->blocks_number == writer->blocks_capacity)
+    {
+        writer->blocks_capacity = (writer->blocks_capacity > 0) ? writer->blocks_capacity * 2 : 64;
+        blocks = (struct arrow_block*) realloc(writer->blocks,
+                                               writer->blocks_capacity *
+                                               sizeof(struct arrow_block));
+
+        if (blocks == NULL)
+        {
+            return MEMORY_HANDLING_ERROR;
+        }
+
+        writer->blocks = blocks;
+    }
+
+    status = arrow_builder_start(builder, ARROW_METADATA_SIZE);
+
+    if (status != NO_ERROR)
+    {
+        return status;
+    }
+
+    header = arrow_message(builder, ARROW_HEADER_BATCH, body_length);
+    arrow_put_offset(builder, header, arrow_table(builder, 3, batch_sizes, batch));
+    arrow_put64(builder, batch[0], writer->rows_number);
+
+    nodes = arrow_vector(builder, ARROW_COLUMNS_NUMBER, ARROW_FIELD_NODE_SIZE, 8);
+    arrow_put_offset(builder, batch[1], nodes);
+
+    buffers = arrow_vector(builder, 2 * ARROW_COLUMNS_NUMBER, ARROW_BUFFER_SIZE, 8);
+    arrow_put_offset(builder, batch[2], buffers);
+
+    body_length = 0;
+
+    for (uint8_t i = 0; i < ARROW_COLUMNS_NUMBER; i++)
+    {
+        length = (size_t) writer->rows_number * arrow_columns[i].width;
+
+        // The length, the null count is zero.
+        arrow_put64(builder, nodes + 4 + ARROW_FIELD_NODE_SIZE * i, writer->rows_number);
+        // The validity buffer is empty, the data buffer follows.
+        arrow_put64(builder, buffers + 4 + ARROW_BUFFER_SIZE * 2 * i, body_length);
+        arrow_put64(builder, buffers + 4 + ARROW_BUFFER_SIZE * (2 * i + 1), body_length);
+        arrow_put64(builder, buffers + 4 + ARROW_BUFFER_SIZE * (2 * i + 1) + 8, length);
+
+        body_length += arrow_align(length);
+    }
+
+    writer->blocks[writer->blocks_number].offset = writer->file_offset;
+
+    status = arrow_write_metadata(writer);
+
+    for (uint8_t i = 0; i < ARROW_COLUMNS_NUMBER && status == NO_ERROR; i++)
+    {
+        length = (size_t) writer->rows_number * arrow_columns[i].width;
+
+        status = arrow_write(writer, writer->columns[i], length);
+
+        if (status == NO_ERROR)
+        {
+            status = arrow_write(writer, padding, arrow_align(length) - length);
+        }
+    }
+
+    if (status != NO_ERROR)
+    {
+        return status;
+    }
+
+    writer->blocks[writer->blocks_number].metadata_length =
+            (uint32_t) (2 * sizeof(uint32_t) + builder->length);
+    writer->blocks[writer->blocks_number].body_length = body_length;
+    writer->blocks_number++;
+
+    writer->rows_number = 0;
+
+    return NO_ERROR;
+}
+
+/*
+ * The helper function for converting a time stamp into the milliseconds
+ * since the epoch.
+ *
+ * @param time The time stamp.
+ * @return     The milliseconds since the epoch.
+ */
+static int64_t arrow_epoch_ms (const struct timeval* time)
+{
+    return (int64_t) time->tv_sec * 1000 + (int64_t) time->tv_usec / 1000;
+}
+
+/*
+ * The helper function for appending rows to the columns of the current
+ * batch. Every column is filled by its own loop over the flows.
+ *
+ * @param writer       Pointer to the writer.
+ * @param flows        An array of flows to append, they fit into the batch.
+ * @param flows_number The number of flows in the array of flows to append.
+ * @param reverse      The reverse direction of the biflows is appended.
+ */
+static void arrow_append_columns (arrow_writer_t writer,
+                                  flow_node_t* flows,
+                                  uint32_t flows_number,
+                                  bool reverse)
+{
+    uint32_t row = writer->rows_number;
+    uint32_t* src_addr = (uint32_t*) writer->columns[ARROW_SRC_ADDR] + row;
+    uint32_t* dst_addr = (uint32_t*) writer->columns[ARROW_DST_ADDR] + row;
+    uint16_t* src_port = (uint16_t*) writer->columns[ARROW_SRC_PORT] + row;
+    uint16_t* dst_port = (uint16_t*) writer->columns[ARROW_DST_PORT] + row;
+    uint8_t* protocol = writer->columns[ARROW_PROTOCOL] + row;
+    uint8_t* tos = writer->columns[ARROW_TOS] + row;
+    uint8_t* tcp_flags = writer->columns[ARROW_TCP_FLAGS] + row;
+    uint64_t* packets = (uint64_t*) writer->columns[ARROW_PACKETS] + row;
+    uint64_t* octets = (uint64_t*) writer->columns[ARROW_OCTETS] + row;
+    int64_t* first = (int64_t*) writer->columns[ARROW_FIRST] + row;
+    int64_t* last = (int64_t*) writer->columns[ARROW_LAST] + row;
+
+    for (uint32_t i = 0; i < flows_number; i++)
+    {
+        src_addr[i] = ntohl(reverse ? flows[i]->dst_addr : flows[i]->src_addr);
+    }
+
+    for (uint32_t i = 0; i < flows_number; i++)
+    {
+        dst_addr[i] = ntohl(reverse ? flows[i]->src_addr : flows[i]->dst_addr);
+    }
+
+    for (uint32_t i = 0; i < flows_number; i++)
+    {
+        src_port[i] = reverse ? flows[i]->dst_port : flows[i]->src_port;
+    }
+
+    for (uint32_t i = 0; i < flows_number; i++)
+    {
+        dst_port[i] = reverse ? flows[i]->src_port : flows[i]->dst_port;
+    }
+
+    for (uint32_t i = 0; i < flows_number; i++)
+    {
+        protocol[i] = flows[i]->prot;
+    }
+
+    for (uint32_t i = 0; i < flows_number; i++)
+    {
+        tos[i] = flows[i]->tos;
+    }
+
+    for (uint32_t i = 0; i < flows_number; i++)
+    {
+        tcp_flags[i] = reverse ? flow_reverse_direction(flows[i])->tcp_flags : flows[i]->tcp_flags;
+    }
+
+    for (uint32_t i = 0; i < flows_number; i++)
+    {
+        packets[i] = reverse ? flow_reverse_direction(flows[i])->packets : flows[i]->packets;
+    }
+
+    for (uint32_t i = 0; i < flows_number; i++)
+    {
+        octets[i] = reverse ? flow_reverse_direction(flows[i])->octets : flows[i]->octets;
+    }
+
+    for (uint32_t i = 0; i < flows_number; i++)
+    {
+        first[i] = arrow_epoch_ms(reverse ? &(flow_reverse_direction(flows[i])->first) :
+                                  &(flows[i]->first));
+    }
+
+    for (uint32_t i = 0; i < flows_number; i++)
+    {
+        last[i] = arrow_epoch_ms(reverse ? &(flow_reverse_direction(flows[i])->last) :
+                                 &(flows[i]->last));
+    }
+
+    writer->rows_number += flows_number;
+    writer->records_number += flows_number;
+}
+
+/*
+ * The helper function for appending rows, the batch is written
+ * whenever it is full.
+ *
+ * @param writer       Pointer to the writer.
+ * @param flows        An array of flows to append.
+ * @param flows_number The number of flows in the array of flows to append.
+ * @param reverse      The reverse direction of the biflows is appended.
+ * @return             Status of function processing.
+ */
+static uint8_t arrow_append (arrow_writer_t writer,
+                             flow_node_t* flows,
+                             uint32_t flows_number,
+                             bool reverse)
+{
+    uint8_t status = NO_ERROR;
+    uint32_t rows_number;
+
+    while (flows_number > 0 && status == NO_ERROR)
+    {
+        rows_number = writer->batch_rows - writer->rows_number;
+        rows_number = (flows_number < rows_number) ? flows_number : rows_number;
+
+        arrow_append_columns(writer, flows, rows_number, reverse);
+
+        flows += rows_number;
+        flows_number -= rows_number;
+
+        if (writer->rows_number == writer->batch_rows)
+        {
+            status = arrow_write_batch(writer);
+        }
+    }
+
+    return status;
+}
+
+/*
+ * Function for opening the Arrow file. The file is created or truncated
+ * and the schema is written.
+ *
+ * @param writer    Pointer to the allocated writer.
+ * @param file_name The name of the file.
+ * @return          Status of function processing.
+ */
+uint8_t arrow_open (arrow_writer_t writer, const char* file_name)
+{
+    // The magic is padded to the alignment.
+    static const char magic[ARROW_ALIGNMENT] = ARROW_MAGIC;
+    uint8_t status;
+    size_t header;
+
+    writer->file_offset = 0;
+    writer->rows_number = 0;
+    writer->blocks_number = 0;
+    writer->records_number = 0;
+
+    status = arrow_builder_start(&(writer->builder), ARROW_METADATA_SIZE);
+
+    if (status != NO_ERROR)
+    {
+        return status;
+    }
+
+    // The schema table has to follow the message table.
+    header = arrow_message(&(writer->builder), ARROW_HEADER_SCHEMA, 0);
+    arrow_put_offset(&(writer->builder), header, arrow_schema(&(writer->builder)));
+
+    writer->file = fopen(file_name, "wb");
+
+    if (writer->file == NULL)
+    {
+        return ARROW_FILE_ERROR;
+    }
+
+    status = arrow_write(writer, magic, sizeof(magic));
+
+    if (status != NO_ERROR)
+    {
+        return status;
+    }
+
+    return arrow_write_metadata(writer);
+}
+
+/*
+ * Function for appending flows to the columns. A biflow is appended
+ * as two rows, one per direction. The full batches are written.
+ *
+ * @param writer       Pointer to the writer.
+ * @param flows        An array of flows to append.
+ * @param flows_number The number of flows in the array of flows to append.
+ * @return             Status of function processing.
+ */
+uint8_t arrow_write_flows (arrow_writer_t writer,
+                           flow_node_t* flows,
+                           const uint16_t flows_number)
+{
+    uint8_t status = NO_ERROR;
+    flow_node_t reverse_flows[ARROW_GATHER_SIZE];
+    uint32_t reverse_number;
+    uint32_t count;
+
+    for (uint32_t i = 0; i < flows_number && status == NO_ERROR; i += count)
+    {
+        count = flows_number - i;
+        count = (count < ARROW_GATHER_SIZE) ? count : ARROW_GATHER_SIZE;
+
+        status = arrow_append(writer, flows + i, count, false);
+
+        // The reverse directions of the biflows follow their initiators.
+        reverse_number = 0;
+
+        for (uint32_t j = 0; j < count; j++)
+        {
+            if (flow_reverse_direction(flows[i + j]) != NULL)
+            {
+                reverse_flows[reverse_number++] = flows[i + j];
+            }
+        }
+
+        if (status == NO_ERROR)
+        {
+            status = arrow_append(writer, reverse_flows, reverse_number, true);
+        }
+    }
+
+    return status;
+}
+
+/*
+ * Function for closing the Arrow file. The last batch, the end of stream
+ * marker and the footer are written.
+ *
+ * @param writer Pointer to the writer.
+ * @return       Status of function processing.
+ */
+uint8_t arrow_close (arrow_writer_t writer)
+{
+    // version, schema, dictionaries, recordBatches
+    static const uint8_t footer_sizes[] = { 2, 4, 4, 4 };
+    uint8_t status = NO_ERROR;
+    uint32_t end_of_stream[2];
+    int32_t footer_length;
+    size_t footer[4];
+    size_t root;
+    size_t blocks;
+    arrow_builder_t builder = &(writer->builder);
+
+    if (writer->rows_number > 0)
+    {
+        status = arrow_write_batch(writer);
+    }
+
+    if (status == NO_ERROR)
+    {
+        end_of_stream[0] = htole32(ARROW_CONTINUATION);
+        end_of_stream[1] = 0;
+
+        status = arrow_write(writer, end_of_stream, sizeof(end_of_stream));
+    }
+
+    if (status == NO_ERROR)
+    {
+        status = arrow_builder_start(builder, ARROW_METADATA_SIZE +
+                                     (size_t) writer->blocks_number * ARROW_BLOCK_SIZE);
+    }
+
+    if (status == NO_ERROR)
+    {
+        root = arrow_reserve(builder, sizeof(uint32_t), sizeof(uint32_t));
+        arrow_put_offset(builder, root, arrow_table(builder, 4, footer_sizes, footer));
+        arrow_put16(builder, footer[0], ARROW_METADATA_V5);
+        arrow_put_offset(builder, footer[2], arrow_vector(builder, 0, ARROW_BLOCK_SIZE, 8));
+
+        blocks = arrow_vector(builder, writer->blocks_number, ARROW_BLOCK_SIZE, 8);
+        arrow_put_offset(builder, footer[3], blocks);
+
+        for (uint32_t i = 0; i < writer->blocks_number; i++)
+        {
+            arrow_put64(builder, blocks + 4 + ARROW_BLOCK_SIZE * i, writer->blocks[i].offset);
+            arrow_put32(builder, blocks + 4 + ARROW_BLOCK_SIZE * i + 8,
+                        writer->blocks[i].metadata_length);
+            arrow_put64(builder, blocks + 4 + ARROW_BLOCK_SIZE * i + 16,
+                        writer->blocks[i].body_length);
+        }
+
+        arrow_put_offset(builder, footer[1], arrow_schema(builder));
+
+        footer_length = (int32_t) htole32((uint32_t) builder->length);
+
+        status = arrow_write(writer, builder->data, builder->length);
+
+        if (status == NO_ERROR)
+        {
+            status = arrow_write(writer, &footer_length, sizeof(footer_length));
+        }
+
+        if (status == NO_ERROR)
+        {
+            status = arrow_write(writer, ARROW_MAGIC, strlen(ARROW_MAGIC));
+        }
+    }
+
+    if (fclose(writer->file) != 0 && status == NO_ERROR)
+    {
+        status = ARROW_FILE_ERROR;
+    }
+
+    writer->file = NULL;
+
+    return status;
+}
@@ -0,0 +1,128 @@
+/**********************************************************/
+/*                                                        */
+/* File: arrow.h                                          */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Header file for the Arrow IPC flow file   */
+/*                                                        */
+/**********************************************************/
+
+#ifndef FLOW_ARROW_H
+#define FLOW_ARROW_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "netflow_v5.h"
+
+#define ARROW_MAGIC          "ARROW1"
+#define ARROW_ALIGNMENT      (8)
+#define ARROW_COLUMNS_NUMBER (11)
+#define ARROW_METADATA_SIZE  (8192) // Metadata without the record batch blocks.
+
+typedef struct arrow_block* arrow_block_t;
+typedef struct arrow_builder* arrow_builder_t;
+typedef struct arrow_writer* arrow_writer_t;
+
+/*
+ * Enumeration of the number of rows of a record batch.
+ */
+enum arrow_batch_limits
+{
+    ARROW_BATCH_MIN = 1,
+    ARROW_BATCH_DEFAULT = 65536,
+    ARROW_BATCH_MAX = 1048576
+};
+
+/*
+ * Structure to store the position of a record batch in the file,
+ * the footer lists them for the random access.
+ */
+struct arrow_block
+{
+    uint64_t offset;
+    uint32_t metadata_length; // Including the continuation and length prefix.
+    uint64_t body_length;
+};
+
+/*
+ * Structure to store the buffer of the flatbuffers metadata. The metadata
+ * is written from the start, the offsets always point forward.
+ */
+struct arrow_builder
+{
+    uint8_t* data;
+    size_t length;
+    size_t capacity;
+};
+
+/*
+ * Structure to store the Arrow IPC file writer. The flows are appended
+ * to the columns of the current record batch, a full batch is written
+ * as one message with the columns as its body buffers.
+ */
+struct arrow_writer
+{
+    FILE* file;
+    uint64_t file_offset;
+    uint8_t* columns[ARROW_COLUMNS_NUMBER]; // Each for the batch rows.
+    uint32_t batch_rows;
+    uint32_t rows_number;                   // The rows of the current batch.
+    struct arrow_builder builder;
+    struct arrow_block* blocks;
+    uint32_t blocks_number;
+    uint32_t blocks_capacity;
+    uint64_t records_number;                // The appended rows.
+};
+
+/*
+ * Function for getting the size of a row of the columns.
+ *
+ * @return The size of a row in bytes.
+ */
+size_t arrow_row_size (void);
+
+/*
+ * Function for getting the size of a value of a column.
+ *
+ * @param column The index of the column.
+ * @return       The size of a value in bytes.
+ */
+size_t arrow_column_width (uint8_t column);
+
+/*
+ * Function for opening the Arrow file. The file is created or truncated
+ * and the schema is written.
+ *
+ * @param writer    Pointer to the allocated writer.
+ * @param file_name The name of the file.
+ * @return          Status of function processing.
+ */
+uint8_t arrow_open (arrow_writer_t writer, const char* file_name);
+
+/*
+ * Function for appending flows to the columns. A biflow is appended
+ * as two rows, one per direction. The full batches are written.
+ *
+ * @param writer       Pointer to the writer.
+ * @param flows        An array of flows to append.
+ * @param flows_number The number of flows in the array of flows to append.
+ * @return             Status of function processing.
+ */
+uint8_t arrow_write_flows (arrow_writer_t writer,
+                           flow_node_t* flows,
+                           const uint16_t flows_number);
+
+/*
+ * Function for closing the Arrow file. The last batch, the end of stream
+ * marker and the footer are written.
+ *
+ * @param writer Pointer to the writer.
+ * @return       Status of function processing.
+ */
+uint8_t arrow_close (arrow_writer_t writer);
+
+#endif // FLOW_ARROW_H
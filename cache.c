@@ -0,0 +1,1193 @@
+/**********************************************************/
+/*                                                        */
+/* File: cache.c                                          */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Flow cache implementation                 */
+/*                                                        */
+/**********************************************************/
+
+#include "cache.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "error.h"
+#include "memory.h"
+#include "netflow_v5.h"
+#include "util.h"
+
+/*
+ * The helper function for mixing bits of a 64-bit value.
+ *
+ * The function is the finalizer of the MurmurHash3 hash function:
+ *
+ * Source: https://github.com/aappleby/smhasher/blob/master/src/MurmurHash3.cpp
+ * Author: Austin Appleby
+ * Copyright: The code is released to the public domain.
+ *
+ * @param value Input value.
+ * @return      The mixed value.
+ */
+static uint64_t mix_64 (uint64_t value)
+{
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+
+    return value;
+}
+
+/*
+ * The SipHash round.
+ */
+#define ROTATE_64(value, bits) (((value) << (bits)) | ((value) >> (64 - (bits))))
+#define SIP_ROUND(v0, v1, v2, v3)                                       \
+    do                                                                  \
+    {                                                                   \
+        v0 += v1; v1 = ROTATE_64(v1, 13); v1 ^= v0; v0 = ROTATE_64(v0, 32); \
+        v2 += v3; v3 = ROTATE_64(v3, 16); v3 ^= v2;                     \
+        v0 += v3; v3 = ROTATE_64(v3, 21); v3 ^= v0;                     \
+        v2 += v1; v1 = ROTATE_64(v1, 17); v1 ^= v2; v2 = ROTATE_64(v2, 32); \
+    } while (0)
+
+/*
+ * The helper function for the keyed hash of two 64-bit words (16 bytes).
+ *
+ * The function is the SipHash-1-3 (one compression round, three finalization
+ * rounds):
+ *
+ * Source: https://github.com/veorq/SipHash
+ * Authors: Jean-Philippe Aumasson, Daniel J. Bernstein
+ * Copyright: The code is released under CC0 (public domain).
+ *
+ * @param hash_key The secret key.
+ * @param first    The first word of the message.
+ * @param second   The second word of the message.
+ * @return         The hash of the message.
+ */
+static uint64_t siphash_13 (const uint64_t hash_key[2], uint64_t first, uint64_t second)
+{
+    uint64_t v0 = 0x736f6d6570736575ULL ^ hash_key[0];
+    uint64_t v1 = 0x646f72616e646f6dULL ^ hash_key[1];
+    uint64_t v2 = 0x6c7967656e657261ULL ^ hash_key[0];
+    uint64_t v3 = 0x7465646279746573ULL ^ hash_key[1];
+    const uint64_t length = (uint64_t) 16 << 56; // The last block with the length.
+
+    v3 ^= first;
+    SIP_ROUND(v0, v1, v2, v3);
+    v0 ^= first;
+
+    v3 ^= second;
+    SIP_ROUND(v0, v1, v2, v3);
+    v0 ^= second;
+
+    v3 ^= length;
+    SIP_ROUND(v0, v1, v2, v3);
+    v0 ^= length;
+
+    v2 ^= 0xff;
+    SIP_ROUND(v0, v1, v2, v3);
+    SIP_ROUND(v0, v1, v2, v3);
+    SIP_ROUND(v0, v1, v2, v3);
+
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+/*
+ * The helper function for getting an entry by its index.
+ *
+ * @param cache Pointer to the flow cache.
+ * @param index Index of the entry.
+ * @return      The entry.
+ */
+static inline flow_entry_t cache_entry (flow_cache_t cache, uint32_t index)
+{
+    return (flow_entry_t) (cache->entries + (size_t) index * cache->entry_size);
+}
+
+/*
+ * The helper function for getting an index of an entry.
+ *
+ * @param cache Pointer to the flow cache.
+ * @param entry The entry.
+ * @return      Index of the entry.
+ */
+static inline uint32_t cache_index (flow_cache_t cache, flow_entry_t entry)
+{
+    return (uint32_t) (((uint8_t*) entry - cache->entries) / cache->entry_size);
+}
+
+/*
+ * The helper function for getting the bucket of a hash. The bucket is
+ * in the old table if it was not migrated yet.
+ *
+ * @param cache Pointer to the flow cache.
+ * @param hash  The hash of the key.
+ * @return      Pointer to the bucket.
+ */
+static inline uint32_t* cache_bucket (flow_cache_t cache, uint32_t hash)
+{
+    if (cache->old_buckets != NULL &&
+        (hash & cache->old_bucket_mask) >= cache->rehash_index)
+    {
+        return &(cache->old_buckets[hash & cache->old_bucket_mask]);
+    }
+
+    return &(cache->buckets[hash & cache->bucket_mask]);
+}
+
+/*
+ * The helper function for getting the front cache slot of a hash. The slot
+ * is selected by the upper bits of the hash, the lower bits select
+ * the bucket.
+ *
+ * @param cache Pointer to the flow cache.
+ * @param hash  The hash of a key.
+ * @return      Pointer to the slot.
+ */
+static inline struct flow_front_slot* cache_front (flow_cache_t cache, uint32_t hash)
+{
+    return &(cache->front[hash >> (32 - CACHE_FRONT_BITS)]);
+}
+
+/*
+ * The helper function for migrating a few buckets from the old table
+ * into the current one. The old table is released after the migration
+ * of its last bucket.
+ *
+ * @param cache Pointer to the flow cache.
+ */
+static void cache_rehash_step (flow_cache_t cache)
+{
+    flow_entry_t entry;
+    uint32_t index;
+    uint32_t* bucket;
+
+    for (uint32_t step = 0;
+         step < CACHE_REHASH_STEP && cache->old_buckets != NULL;
+         step++)
+    {
+        index = cache->old_buckets[cache->rehash_index];
+
+        while (index != CACHE_NIL)
+        {
+            entry = cache_entry(cache, index);
+            index = entry->hash_next;
+
+            bucket = &(cache->buckets[entry->hash & cache->bucket_mask]);
+            entry->hash_next = *bucket;
+            *bucket = cache_index(cache, entry);
+        }
+
+        cache->rehash_index++;
+
+        if (cache->rehash_index > cache->old_bucket_mask)
+        {
+            free_cache_buckets(&(cache->old_buckets), &(cache->old_buckets_size));
+            cache->old_bucket_mask = 0;
+            cache->rehash_index = 0;
+        }
+    }
+}
+
+/*
+ * The helper function for starting a resize of the hash table. The table
+ * grows when the load factor exceeds 1 and it shrinks when the load factor
+ * drops under 1/CACHE_SHRINK_RATIO. The resize is not started before
+ * the previous one is finished. A failed allocation is not an error,
+ * the table just keeps its size.
+ *
+ * @param cache Pointer to the flow cache.
+ */
+static void cache_check_resize (flow_cache_t cache)
+{
+    uint32_t buckets_number = cache->bucket_mask + 1;
+    uint32_t new_buckets_number;
+    uint32_t* new_buckets = NULL;
+    size_t new_buckets_size;
+    bool huge_pages;
+
+    if (cache->old_buckets != NULL)
+    {
+        return;
+    }
+
+    if (cache->entries_number > buckets_number &&
+        buckets_number < cache->max_buckets)
+    {
+        new_buckets_number = buckets_number << 1;
+    }
+    else if (cache->entries_number < buckets_number / CACHE_SHRINK_RATIO &&
+             buckets_number > cache->min_buckets)
+    {
+        new_buckets_number = buckets_number >> 1;
+    }
+    else
+    {
+        return;
+    }
+
+    if (allocate_cache_buckets(&new_buckets,
+                               &new_buckets_size,
+                               new_buckets_number,
+                               false,
+                               false,
+                               &huge_pages) != EXIT_SUCCESS)
+    {
+        return;
+    }
+
+    cache->old_buckets = cache->buckets;
+    cache->old_bucket_mask = cache->bucket_mask;
+    cache->old_buckets_size = cache->buckets_size;
+    cache->rehash_index = 0;
+
+    cache->buckets = new_buckets;
+    cache->bucket_mask = new_buckets_number - 1;
+    cache->buckets_size = new_buckets_size;
+
+    cache->resizes_number++;
+}
+
+/*
+ * The helper function for appending an entry to the end of a list.
+ *
+ * @param cache Pointer to the flow cache.
+ * @param list  The list.
+ * @param index Index of the appended entry.
+ * @param age   True for the age list links, false for the lru list links.
+ */
+static void list_append (flow_cache_t cache, flow_list_t list, uint32_t index, bool age)
+{
+    flow_entry_t entry = cache_entry(cache, index);
+    uint32_t* prev = age ? &(entry->age_prev) : &(entry->lru_prev);
+    uint32_t* next = age ? &(entry->age_next) : &(entry->lru_next);
+
+    *prev = list->tail;
+    *next = CACHE_NIL;
+
+    if (list->tail == CACHE_NIL)
+    {
+        list->head = index;
+    }
+    else if (age)
+    {
+        cache_entry(cache, list->tail)->age_next = index;
+    }
+    else
+    {
+        cache_entry(cache, list->tail)->lru_next = index;
+    }
+
+    list->tail = index;
+}
+
+/*
+ * The helper function for unlinking an entry from a list.
+ *
+ * @param cache Pointer to the flow cache.
+ * @param list  The list.
+ * @param index Index of the unlinked entry.
+ * @param age   True for the age list links, false for the lru list links.
+ */
+static void list_unlink (flow_cache_t cache, flow_list_t list, uint32_t index, bool age)
+{
+    flow_entry_t entry = cache_entry(cache, index);
+    uint32_t prev = age ? entry->age_prev : entry->lru_prev;
+    uint32_t next = age ? entry->age_next : entry->lru_next;
+
+    if (prev == CACHE_NIL)
+    {
+        list->head = next;
+    }
+    else if (age)
+    {
+        cache_entry(cache, prev)->age_next = next;
+    }
+    else
+    {
+        cache_entry(cache, prev)->lru_next = next;
+    }
+
+    if (next == CACHE_NIL)
+    {
+        list->tail = prev;
+    }
+    else if (age)
+    {
+        cache_entry(cache, next)->age_prev = prev;
+    }
+    else
+    {
+        cache_entry(cache, next)->lru_prev = prev;
+    }
+}
+
+/*
+ * Function for computing the number of buckets for the maximum number
+ * of cached flows.
+ *
+ * @param entries_number The maximum number of cached flows.
+ * @return               The number of buckets (power of two).
+ */
+uint32_t cache_buckets_number (uint32_t entries_number)
+{
+    uint32_t buckets_number = 1;
+
+    // The load factor is kept at most 1.
+    while (buckets_number < entries_number)
+    {
+        buckets_number <<= 1;
+    }
+
+    return buckets_number;
+}
+
+/*
+ * Function for selecting the cache layout by the options.
+ *
+ * @param options Pointer to options storage.
+ * @return        The cache layout.
+ */
+uint8_t cache_select_layout (options_t options)
+{
+    if (options->wire_format_set)
+    {
+        return CACHE_LAYOUT_WIRE;
+    }
+
+    return options->biflow_set ? CACHE_LAYOUT_BIFLOW : CACHE_LAYOUT_FLOW;
+}
+
+/*
+ * Function for computing the size of an entry of the cache layout.
+ *
+ * @param layout The cache layout.
+ * @return       The size of an entry in bytes.
+ */
+size_t cache_entry_size (uint8_t layout)
+{
+    if (layout == CACHE_LAYOUT_WIRE)
+    {
+        return sizeof(struct flow_entry) + sizeof(struct wire_flow);
+    }
+
+    if (layout == CACHE_LAYOUT_BIFLOW)
+    {
+        return sizeof(struct flow_entry) + sizeof(struct flow_node) +
+               sizeof(struct flow_reverse);
+    }
+
+    return sizeof(struct flow_entry) + sizeof(struct flow_node);
+}
+
+/*
+ * Function for computing the memory size of the flow cache.
+ *
+ * @param entries_number The maximum number of cached flows.
+ * @param layout         The cache layout.
+ * @return               The memory size of the cache in bytes.
+ */
+uint64_t cache_memory_size (uint32_t entries_number, uint8_t layout)
+{
+    // The entry with the CACHE_NIL index is never used.
+    return ((uint64_t) entries_number + 1) * cache_entry_size(layout) +
+           (uint64_t) cache_buckets_number(entries_number) * sizeof(uint32_t);
+}
+
+/*
+ * Function for computing the maximum number of cached flows
+ * which fits into the memory budget.
+ *
+ * @param budget_bytes The memory budget in bytes.
+ * @param layout       The cache layout.
+ * @return             The maximum number of cached flows.
+ */
+uint64_t cache_entries_for_budget (uint64_t budget_bytes, uint8_t layout)
+{
+    uint64_t entries_number = budget_bytes / (cache_entry_size(layout) + sizeof(uint32_t));
+
+    if (entries_number > UINT32_MAX - 1)
+    {
+        entries_number = UINT32_MAX - 1;
+    }
+
+    // The buckets are rounded up to the power of two,
+    // so the estimate is lowered until it fits.
+    while (entries_number > 0 &&
+           cache_memory_size((uint32_t) entries_number, layout) > budget_bytes)
+    {
+        entries_number -= (entries_number / 64) + 1;
+    }
+
+    return entries_number;
+}
+
+/*
+ * Function for setting a random key of the flow hash. The key is read
+ * from the system random source, if it is not available, the key
+ * is derived from the time and the process id.
+ *
+ * @param cache Pointer to the flow cache.
+ */
+void cache_seed_hash (flow_cache_t cache)
+{
+    FILE* random_source = fopen("/dev/urandom", "rb");
+    size_t read_number = 0;
+    struct timeval now;
+
+    if (random_source != NULL)
+    {
+        read_number = fread(cache->hash_key, sizeof(cache->hash_key), 1, random_source);
+        fclose(random_source);
+    }
+
+    if (read_number != 1)
+    {
+        gettimeofday(&now, NULL);
+
+        cache->hash_key[0] = mix_64(((uint64_t) now.tv_sec << 20) ^ (uint64_t) now.tv_usec);
+        cache->hash_key[1] = mix_64(((uint64_t) getpid() << 32) ^ cache->hash_key[0]);
+    }
+}
+
+/*
+ * Function for setting the key of the flow hash given by user, so the runs
+ * over the parts of the same traffic select the same flows.
+ *
+ * @param cache Pointer to the flow cache.
+ * @param key   The key of the flow hash.
+ */
+void cache_set_hash_key (flow_cache_t cache, const uint64_t key[2])
+{
+    cache->hash_key[0] = key[0];
+    cache->hash_key[1] = key[1];
+}
+
+/*
+ * Function for computing the hash of a flow key. The hash is keyed
+ * by the random key of the cache, so the collisions cannot be computed
+ * in advance.
+ *
+ * @param cache Pointer to the flow cache.
+ * @param key   Pointer to the flow key.
+ * @return      The hash of the key.
+ */
+uint32_t cache_hash (flow_cache_t cache, netflow_v5_key_t key)
+{
+    // The fields are combined one by one, so the padding of the key
+    // does not affect the hash.
+    uint64_t addresses = ((uint64_t) key->src_addr << 32) | key->dst_addr;
+    uint64_t others = ((uint64_t) key->src_port << 48) |
+                      ((uint64_t) key->dst_port << 32) |
+                      ((uint64_t) key->input << 16) |
+                      ((uint64_t) key->prot << 8) |
+                      (uint64_t) key->tos;
+
+    return (uint32_t) siphash_13(cache->hash_key, addresses, others);
+}
+
+/*
+ * Function for finding the timeout class of a flow. The classes with
+ * a port are preferred to the classes of the whole protocol.
+ *
+ * @param timeout_classes Pointer to the timeout classes.
+ * @param key             Pointer to the flow key.
+ * @return                The timeout class of the flow.
+ */
+uint8_t cache_timeout_class (timeout_classes_t timeout_classes, netflow_v5_key_t key)
+{
+    uint8_t timeout_class = CACHE_DEFAULT_CLASS;
+    timeout_class_t definition;
+
+    for (uint8_t i = 0; i < timeout_classes->classes_number; i++)
+    {
+        definition = &(timeout_classes->classes[i]);
+
+        if (definition->prot != key->prot)
+        {
+            continue;
+        }
+
+        if (!definition->port_set)
+        {
+            // The first matching class of the whole protocol is used
+            // if no class of the port matches.
+            if (timeout_class == CACHE_DEFAULT_CLASS)
+            {
+                timeout_class = i + 1;
+            }
+        }
+        else if (definition->port == key->src_port || definition->port == key->dst_port)
+        {
+            return i + 1;
+        }
+    }
+
+    return timeout_class;
+}
+
+/*
+ * Function for searching the flow in the cache by key. The length
+ * of the search is monitored, the chains longer than CACHE_PROBE_ALARM
+ * are counted and the first one is reported.
+ *
+ * @param cache Pointer to the flow cache.
+ * @param key   Pointer to key which is searched.
+ * @param hash  The hash of the key.
+ * @return      The found entry or NULL if the flow is not cached.
+ */
+flow_entry_t cache_search (flow_cache_t cache, netflow_v5_key_t key, uint32_t hash)
+{
+    flow_entry_t entry = NULL;
+    uint32_t index;
+    uint32_t probe_length = 0;
+    struct flow_front_slot* front = cache_front(cache, hash);
+
+    cache->lookups_number++;
+
+    if (front->hash == hash && front->index != CACHE_NIL)
+    {
+        entry = cache_entry(cache, front->index);
+
+        if (compare_flows(&(entry->key), key) == 0)
+        {
+            cache->front_hits++;
+
+            return entry;
+        }
+    }
+
+    index = *cache_bucket(cache, hash);
+    entry = NULL;
+
+    while (index != CACHE_NIL)
+    {
+        entry = cache_entry(cache, index);
+        probe_length++;
+
+        if (entry->hash == hash && compare_flows(&(entry->key), key) == 0)
+        {
+            front->hash = hash;
+            front->index = index;
+
+            break;
+        }
+
+        index = entry->hash_next;
+        entry = NULL;
+    }
+
+    cache->probes_number += probe_length;
+
+    if (probe_length > cache->max_probe_length)
+    {
+        cache->max_probe_length = probe_length;
+
+        if (probe_length > CACHE_PROBE_ALARM && cache->probe_alarms == 0)
+        {
+            fprintf(stderr, "Warning: flow hash chain of %u entries, "
+                            "possible hash collision attack\n", probe_length);
+        }
+    }
+
+    if (probe_length > CACHE_PROBE_ALARM)
+    {
+        cache->probe_alarms++;
+    }
+
+    return entry;
+}
+
+/*
+ * Function for inserting a new flow into the cache. The flow
+ * of the entry is left for the caller to set.
+ *
+ * @param cache         Pointer to the flow cache.
+ * @param key           Pointer to the key of the new flow.
+ * @param hash          The hash of the key.
+ * @param timeout_class The timeout class of the new flow.
+ * @return              The new entry or NULL if the cache is full.
+ */
+flow_entry_t cache_insert (flow_cache_t cache,
+                           netflow_v5_key_t key,
+                           uint32_t hash,
+                           uint8_t timeout_class)
+{
+    flow_entry_t entry;
+    uint32_t index;
+    uint32_t* bucket;
+
+    cache_rehash_step(cache);
+
+    if (cache->free_entries != CACHE_NIL)
+    {
+        // Reuse a released entry.
+        index = cache->free_entries;
+        cache->free_entries = cache_entry(cache, index)->hash_next;
+    }
+    else if (cache->used_entries < cache->max_entries)
+    {
+        // Take a never used entry, so the memory is touched only when needed.
+        cache->used_entries++;
+        index = cache->used_entries;
+    }
+    else
+    {
+        return NULL;
+    }
+
+    entry = cache_entry(cache, index);
+
+    memcpy(&(entry->key), key, sizeof(entry->key));
+    entry->hash = hash;
+    entry->closed = false;
+    entry->timeout_class = timeout_class;
+    entry->tcp_state = TCP_STATE_NONE;
+
+    bucket = cache_bucket(cache, hash);
+    entry->hash_next = *bucket;
+    *bucket = index;
+
+    list_append(cache, &(cache->age_list), index, true);
+    list_append(cache, &(cache->lru_lists[timeout_class]), index, false);
+
+    // The new flow is expected to be found by the next packets.
+    cache_front(cache, hash)->hash = hash;
+    cache_front(cache, hash)->index = index;
+
+    cache->entries_number++;
+    cache_check_resize(cache);
+
+    return entry;
+}
+
+/*
+ * Function for removing an entry from the cache. The entry data stay
+ * unchanged until the entry is reused by the next insertion.
+ *
+ * @param cache Pointer to the flow cache.
+ * @param entry The removed entry.
+ */
+void cache_remove (flow_cache_t cache, flow_entry_t entry)
+{
+    uint32_t index = cache_index(cache, entry);
+    uint32_t* link = cache_bucket(cache, entry->hash);
+
+    // Unlink from the bucket.
+    while (*link != index)
+    {
+        link = &(cache_entry(cache, *link)->hash_next);
+    }
+
+    *link = entry->hash_next;
+
+    if (cache_front(cache, entry->hash)->index == index)
+    {
+        cache_front(cache, entry->hash)->index = CACHE_NIL;
+    }
+
+    list_unlink(cache, &(cache->age_list), index, true);
+    list_unlink(cache,
+                entry->closed ? &(cache->closed_list) :
+                                &(cache->lru_lists[entry->timeout_class]),
+                index,
+                false);
+
+    entry->hash_next = cache->free_entries;
+    cache->free_entries = index;
+
+    cache->entries_number--;
+    cache_check_resize(cache);
+    cache_rehash_step(cache);
+}
+
+/*
+ * Function for marking the update of a flow, the flow is moved
+ * to the end of the lru list.
+ *
+ * @param cache Pointer to the flow cache.
+ * @param entry The updated entry.
+ */
+void cache_touch (flow_cache_t cache, flow_entry_t entry)
+{
+    uint32_t index = cache_index(cache, entry);
+    flow_list_t lru_list = &(cache->lru_lists[entry->timeout_class]);
+
+    if (!entry->closed && lru_list->tail != index)
+    {
+        list_unlink(cache, lru_list, index, false);
+        list_append(cache, lru_list, index, false);
+    }
+}
+
+/*
+ * Function for moving a flow into the lru list of another timeout class.
+ * The function is called for the updated flows only, so the list stays
+ * ordered by the last update.
+ *
+ * @param cache         Pointer to the flow cache.
+ * @param entry         The updated entry.
+ * @param timeout_class The new timeout class.
+ */
+void cache_set_class (flow_cache_t cache, flow_entry_t entry, uint8_t timeout_class)
+{
+    uint32_t index = cache_index(cache, entry);
+
+    if (!entry->closed && entry->timeout_class != timeout_class)
+    {
+        list_unlink(cache, &(cache->lru_lists[entry->timeout_class]), index, false);
+        list_append(cache, &(cache->lru_lists[timeout_class]), index, false);
+    }
+
+    entry->timeout_class = timeout_class;
+}
+
+/*
+ * Function for moving a flow finished by the TCP flags into the list
+ * of closed flows.
+ *
+ * @param cache Pointer to the flow cache.
+ * @param entry The closed entry.
+ */
+void cache_close (flow_cache_t cache, flow_entry_t entry)
+{
+    uint32_t index = cache_index(cache, entry);
+
+    if (!entry->closed)
+    {
+        list_unlink(cache, &(cache->lru_lists[entry->timeout_class]), index, false);
+        list_append(cache, &(cache->closed_list), index, false);
+
+        entry->closed = true;
+    }
+}
+
+/*
+ * The helper function for getting the time of the first packet of an entry.
+ *
+ * @param cache Pointer to the flow cache.
+ * @param entry The entry.
+ * @return      The time stamp of the first packet.
+ */
+static struct timeval* cache_first_seen (flow_cache_t cache, flow_entry_t entry)
+{
+    if (cache->layout == CACHE_LAYOUT_WIRE)
+    {
+        return &(cache_wire(entry)->first);
+    }
+
+    return &(cache_flow(entry)->first);
+}
+
+/*
+ * The helper function for getting the time of the last packet of an entry
+ * in any direction.
+ *
+ * @param cache Pointer to the flow cache.
+ * @param entry The entry.
+ * @return      The time stamp of the last packet.
+ */
+static const struct timeval* cache_last_seen (flow_cache_t cache, flow_entry_t entry)
+{
+    if (cache->layout == CACHE_LAYOUT_WIRE)
+    {
+        return &(cache_wire(entry)->last);
+    }
+
+    return flow_last_seen(cache_flow(entry));
+}
+
+/*
+ * The helper function for accounting an exported flow in the statistics
+ * of its timeout class. The residency is measured in the packet time.
+ *
+ * @param netflow_records Pointer to the netflow recording system.
+ * @param entry           The exported entry.
+ */
+static void cache_account_export (netflow_recording_system_t netflow_records,
+                                  flow_entry_t entry)
+{
+    flow_class_statistics_t statistics =
+            &(netflow_records->cache->class_statistics[entry->timeout_class]);
+
+    statistics->exported_flows++;
+    statistics->residency_ms += get_timeval_ms(netflow_records->last_packet_time,
+                                               cache_first_seen(netflow_records->cache, entry));
+}
+
+/*
+ * The helper function for dropping an exported entry whose flow starts
+ * out of the time window. Such flows belong to the runs
+ * of the neighbouring windows.
+ *
+ * @param netflow_records Pointer to the netflow recording system.
+ * @param entry           The exported entry.
+ * @return                True if the entry was dropped.
+ */
+static bool cache_drop_outside_window (netflow_recording_system_t netflow_records,
+                                       flow_entry_t entry)
+{
+    struct timeval* first = cache_first_seen(netflow_records->cache, entry);
+    uint64_t first_ms = (uint64_t) first->tv_sec * 1000 + (uint64_t) first->tv_usec / 1000;
+
+    if (first_ms >= netflow_records->window_from_ms && first_ms < netflow_records->window_to_ms)
+    {
+        return false;
+    }
+
+    cache_remove(netflow_records->cache, entry);
+    *(netflow_records->cached_flows_number) -= 1;
+    netflow_records->window_dropped_flows++;
+
+    return true;
+}
+
+/*
+ * The helper function for exporting a batch of removed entries. The flows
+ * are exported by the cache layout, the wire format records are sent
+ * directly from the entries.
+ *
+ * @param netflow_records Pointer to the netflow recording system.
+ * @param sending_system  Pointer to the sending system.
+ * @param entries         The batch of exported entries.
+ * @param entries_number  The number of entries in the batch.
+ * @return                Status of function processing.
+ */
+static uint8_t cache_export_batch (netflow_recording_system_t netflow_records,
+                                   netflow_sending_system_t sending_system,
+                                   flow_entry_t* entries,
+                                   uint16_t entries_number)
+{
+    flow_node_t flows[MAX_FLOWS_NUMBER];
+    netflow_v5_flow_record_t records[MAX_FLOWS_NUMBER];
+
+    if (netflow_records->cache->layout == CACHE_LAYOUT_WIRE)
+    {
+        for (uint16_t i = 0; i < entries_number; i++)
+        {
+            records[i] = &(cache_wire(entries[i])->record);
+        }
+
+        return export_wire_records(netflow_records, sending_system, records, entries_number);
+    }
+
+    for (uint16_t i = 0; i < entries_number; i++)
+    {
+        flows[i] = cache_flow(entries[i]);
+    }
+
+    return export_flows(netflow_records, sending_system, flows, entries_number);
+}
+
+/*
+ * The helper function for adding an entry into the batch of exported flows.
+ * The entry is removed from the cache and the full batch is exported.
+ *
+ * @param netflow_records Pointer to the netflow recording system.
+ * @param sending_system  Pointer to the sending system.
+ * @param entry           The exported entry.
+ * @param entries         The batch of exported entries.
+ * @param entries_number  Pointer to the number of entries in the batch.
+ * @return                Status of function processing.
+ */
+static uint8_t cache_export_entry (netflow_recording_system_t netflow_records,
+                                   netflow_sending_system_t sending_system,
+                                   flow_entry_t entry,
+                                   flow_entry_t* entries,
+                                   uint16_t* entries_number)
+{
+    uint8_t status = NO_ERROR;
+
+    if (cache_drop_outside_window(netflow_records, entry))
+    {
+        return NO_ERROR;
+    }
+
+    cache_account_export(netflow_records, entry);
+
+    // The removed entry is not reused before the batch is exported.
+    cache_remove(netflow_records->cache, entry);
+
+    entries[*entries_number] = entry;
+    (*entries_number)++;
+
+    if (*entries_number == MAX_FLOWS_NUMBER)
+    {
+        status = cache_export_batch(netflow_records, sending_system, entries, *entries_number);
+        *entries_number = 0;
+    }
+
+    return status;
+}
+
+/*
+ * Function for computing a timeout shortened by the aggressive aging.
+ *
+ * @param cache           Pointer to the flow cache.
+ * @param timeout_seconds The configured timeout.
+ * @return                The effective timeout, at least one second.
+ */
+uint16_t cache_aged_timeout (flow_cache_t cache, uint16_t timeout_seconds)
+{
+    uint16_t timeout = timeout_seconds >> cache->aging_level;
+
+    return (timeout > 0) ? timeout : 1;
+}
+
+/*
+ * The helper function for the aggressive aging. Once per second of the packet
+ * time, the cache occupancy is compared to the water marks. Above the high
+ * mark the timeouts are halved, below the low mark they are doubled back
+ * to the configured values.
+ *
+ * @param cache             Pointer to the flow cache.
+ * @param actual_time_stamp The current timestamp.
+ * @param options           Pointer to options storage.
+ */
+static void cache_update_aging (flow_cache_t cache,
+                                struct timeval* actual_time_stamp,
+                                options_t options)
+{
+    uint64_t occupancy;
+    uint8_t level = cache->aging_level;
+
+    if (!options->aging_watermarks->is_user_set ||
+        actual_time_stamp->tv_sec == cache->aging_checked_sec)
+    {
+        return;
+    }
+
+    cache->aging_checked_sec = actual_time_stamp->tv_sec;
+    occupancy = (uint64_t) cache->entries_number * 100 / cache->max_entries;
+
+    if (occupancy >= options->aging_watermarks->high_percent &&
+        level < CACHE_AGING_MAX &&
+        (cache_aged_timeout(cache, options->active_entries_timeout->timeout_seconds) > 1 ||
+         cache_aged_timeout(cache, options->inactive_entries_timeout->timeout_seconds) > 1))
+    {
+        // The timeouts are shortened until both of them are one second.
+        level++;
+    }
+    else if (occupancy < options->aging_watermarks->low_percent && level > 0)
+    {
+        level--;
+    }
+    else
+    {
+        return;
+    }
+
+    cache->aging_level = level;
+    cache->aging_transitions++;
+
+    printf("aggressive aging: level %u, active timer %u s, inactive timer %u s "
+           "(cache %lu%% full)\n",
+           level,
+           cache_aged_timeout(cache, options->active_entries_timeout->timeout_seconds),
+           cache_aged_timeout(cache, options->inactive_entries_timeout->timeout_seconds),
+           occupancy);
+}
+
+/*
+ * The helper function for checking the active timer of a flow. With the time
+ * window, the flows are cut when the packet time crosses a multiple
+ * of the active timeout since the epoch. The cuts do not depend on the first
+ * packet seen by the run, so the runs of the neighbouring windows cut a long
+ * flow at the same times and its parts are exported by one run each.
+ *
+ * @param first             The time of the first packet of the flow.
+ * @param actual_time_stamp The current timestamp.
+ * @param active_timeout    The effective active timeout.
+ * @param aligned           The cuts are aligned to the multiples of the timeout.
+ * @return                  True if the flow is expired, false otherwise.
+ */
+static bool cache_active_expired (const struct timeval* first,
+                                  struct timeval* actual_time_stamp,
+                                  uint16_t active_timeout,
+                                  bool aligned)
+{
+    if (aligned)
+    {
+        return (uint64_t) actual_time_stamp->tv_sec / active_timeout !=
+               (uint64_t) first->tv_sec / active_timeout;
+    }
+
+    return actual_time_stamp->tv_sec - first->tv_sec > active_timeout;
+}
+
+/*
+ * Function for exporting the expired flows. The closed flows and the heads
+ * of the age and lru lists are checked, so only the expired flows
+ * are visited.
+ *
+ * @param netflow_records   Pointer to the netflow recording system.
+ * @param sending_system    Pointer to the sending system.
+ * @param actual_time_stamp The current timestamp of the currently last
+ *                          received packet.
+ * @param options           Pointer to options storage.
+ * @return                  Status of function processing.
+ */
+uint8_t cache_export_expired (netflow_recording_system_t netflow_records,
+                              netflow_sending_system_t sending_system,
+                              struct timeval* actual_time_stamp,
+                              options_t options)
+{
+    uint8_t status = NO_ERROR;
+    flow_cache_t cache = netflow_records->cache;
+    flow_entry_t entry;
+    flow_entry_t entries[MAX_FLOWS_NUMBER];
+    uint16_t entries_number = 0;
+    uint16_t active_timeout;
+    uint16_t inactive_timeout;
+
+    cache_update_aging(cache, actual_time_stamp, options);
+
+    active_timeout = cache_aged_timeout(cache,
+                                        options->active_entries_timeout->timeout_seconds);
+    inactive_timeout = cache_aged_timeout(cache,
+                                          options->inactive_entries_timeout->timeout_seconds);
+
+    // TCP flags check.
+    while (status == NO_ERROR && cache->closed_list.head != CACHE_NIL)
+    {
+        entry = cache_entry(cache, cache->closed_list.head);
+
+        status = cache_export_entry(netflow_records, sending_system, entry,
+                                    entries, &entries_number);
+    }
+
+    // Active timer check.
+    while (status == NO_ERROR && cache->age_list.head != CACHE_NIL)
+    {
+        entry = cache_entry(cache, cache->age_list.head);
+
+        if (!cache_active_expired(cache_first_seen(cache, entry), actual_time_stamp,
+                                  active_timeout, options->time_window->is_user_set))
+        {
+            break;
+        }
+
+        status = cache_export_entry(netflow_records, sending_system, entry,
+                                    entries, &entries_number);
+    }
+
+    // Inactive timer check, every timeout class has its own list.
+    for (uint8_t i = 0; i < CACHE_CLASSES; i++)
+    {
+        if (i == CACHE_HALF_OPEN_CLASS || i == CACHE_FIN_WAIT_CLASS)
+        {
+            if (!options->tcp_state_timeouts->is_user_set)
+            {
+                break;
+            }
+
+            inactive_timeout = cache_aged_timeout(cache, (i == CACHE_HALF_OPEN_CLASS) ?
+                                                  options->tcp_state_timeouts->half_open_seconds :
+                                                  options->tcp_state_timeouts->fin_wait_seconds);
+        }
+        else if (i > options->timeout_classes->classes_number)
+        {
+            // No flows in the unused classes.
+            continue;
+        }
+        else if (i != CACHE_DEFAULT_CLASS)
+        {
+            inactive_timeout = cache_aged_timeout(cache,
+                                                  options->timeout_classes->classes[i - 1].timeout_seconds);
+        }
+
+        while (status == NO_ERROR && cache->lru_lists[i].head != CACHE_NIL)
+        {
+            entry = cache_entry(cache, cache->lru_lists[i].head);
+
+            if (actual_time_stamp->tv_sec - cache_last_seen(cache, entry)->tv_sec <= inactive_timeout)
+            {
+                break;
+            }
+
+            status = cache_export_entry(netflow_records, sending_system, entry,
+                                        entries, &entries_number);
+        }
+    }
+
+    if (status == NO_ERROR && entries_number > 0)
+    {
+        status = cache_export_batch(netflow_records, sending_system, entries, entries_number);
+    }
+
+    return status;
+}
+
+/*
+ * Function for exporting the oldest flow from the cache.
+ *
+ * @param netflow_records Pointer to the netflow recording system.
+ * @param sending_system  Pointer to the sending system.
+ * @return                Status of function processing.
+ */
+uint8_t cache_export_oldest (netflow_recording_system_t netflow_records,
+                             netflow_sending_system_t sending_system)
+{
+    flow_cache_t cache = netflow_records->cache;
+    flow_entry_t entry;
+
+    if (cache->age_list.head == CACHE_NIL)
+    {
+        return NO_ERROR;
+    }
+
+    entry = cache_entry(cache, cache->age_list.head);
+
+    if (cache_drop_outside_window(netflow_records, entry))
+    {
+        return NO_ERROR;
+    }
+
+    cache_account_export(netflow_records, entry);
+
+    cache_remove(cache, entry);
+
+    return cache_export_batch(netflow_records, sending_system, &entry, 1);
+}
+
+/*
+ * Function for exporting all flows stored in the cache by the oldest one.
+ *
+ * @param netflow_records Pointer to the netflow recording system.
+ * @param sending_system  Pointer to the sending system.
+ * @return                Status of function processing.
+ */
+uint8_t cache_export_all (netflow_recording_system_t netflow_records,
+                          netflow_sending_system_t sending_system)
+{
+    uint8_t status = NO_ERROR;
+    flow_cache_t cache = netflow_records->cache;
+    flow_entry_t entries[MAX_FLOWS_NUMBER];
+    uint16_t entries_number = 0;
+
+    while (status == NO_ERROR && cache->age_list.head != CACHE_NIL)
+    {
+        status = cache_export_entry(netflow_records,
+                                    sending_system,
+                                    cache_entry(cache, cache->age_list.head),
+                                    entries,
+                                    &entries_number);
+    }
+
+    if (status == NO_ERROR && entries_number > 0)
+    {
+        status = cache_export_batch(netflow_records, sending_system, entries, entries_number);
+    }
+
+    return status;
+}
@@ -0,0 +1,406 @@
+/**********************************************************/
+/*                                                        */
+/* File: cache.h                                          */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Header file for the flow cache            */
+/*                                                        */
+/**********************************************************/
+
+#ifndef FLOW_CACHE_H
+#define FLOW_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+#include "netflow_v5.h"
+#include "option.h"
+
+// Index of no entry. The entry with this index is never used, so the zero
+// filled memory represents empty buckets and lists.
+#define CACHE_NIL (0)
+
+#define CACHE_MIN_BUCKETS  (1024) // The initial number of buckets.
+#define CACHE_REHASH_STEP  (8)    // Buckets migrated by a single operation.
+#define CACHE_SHRINK_RATIO (8)    // The load factor 1/8 shrinks the table.
+#define CACHE_AGING_MAX    (8)    // The timeouts are divided by 2^8 at most.
+#define CACHE_PROBE_ALARM  (32)   // The longer hash chain raises the alarm.
+#define CACHE_FRONT_BITS   (9)    // The front cache has 2^9 slots.
+#define CACHE_FRONT_SIZE   (1 << CACHE_FRONT_BITS)
+
+// The timeout class 0 is the default class with the inactive timeout,
+// the classes from 1 are the user timeout classes. The last two classes
+// are used by the TCP state tracking.
+#define CACHE_DEFAULT_CLASS   (0)
+#define CACHE_HALF_OPEN_CLASS (TIMEOUT_CLASSES_MAX + 1)
+#define CACHE_FIN_WAIT_CLASS  (TIMEOUT_CLASSES_MAX + 2)
+#define CACHE_CLASSES         (TIMEOUT_CLASSES_MAX + 3)
+
+/*
+ * Enumeration of the TCP connection states of a flow. The flows are
+ * unidirectional, so the handshake is seen as SYN by the client flow
+ * and as SYN-ACK by the server flow.
+ */
+enum tcp_state
+{
+    TCP_STATE_NONE,        // No TCP flow or no flags seen yet.
+    TCP_STATE_SYN,
+    TCP_STATE_SYN_ACK,
+    TCP_STATE_ESTABLISHED,
+    TCP_STATE_FIN_WAIT,
+    TCP_STATE_CLOSED
+};
+
+struct netflow_recording_system; // Forward declaration
+struct netflow_sending_system; // Forward declaration
+
+typedef struct flow_entry* flow_entry_t;
+typedef struct flow_list* flow_list_t;
+typedef struct flow_class_statistics* flow_class_statistics_t;
+typedef struct flow_cache* flow_cache_t;
+
+/*
+ * Layouts of the flow cache entries, the layout is selected at startup
+ * by the options:
+ * - flow   - the entry holds a flow,
+ * - biflow - the entry holds a flow followed by its reverse direction,
+ * - wire   - the entry holds a NetFlow v5 record as it is sent (-W).
+ */
+enum cache_layout
+{
+    CACHE_LAYOUT_FLOW,
+    CACHE_LAYOUT_BIFLOW,
+    CACHE_LAYOUT_WIRE
+};
+
+/*
+ * Structure to store a flow cache entry. The entries are linked by indexes
+ * into the array of entries, so the entries are independent on the address
+ * of the array. The entry is followed by the payload of the cache layout,
+ * so the size of the entries is given by the layout.
+ */
+struct flow_entry
+{
+    struct netflow_v5_key key;
+    uint32_t hash;      // Hash of the key.
+    uint32_t hash_next; // Next entry in the bucket (or in the free entries).
+    uint32_t age_prev;  // Neighbours in the list ordered by the flow creation.
+    uint32_t age_next;
+    uint32_t lru_prev;  // Neighbours in the list ordered by the last update
+    uint32_t lru_next;  // or in the list of closed flows.
+    bool closed;        // The flow is in the list of closed flows.
+    uint8_t timeout_class; // The class of the inactive timeout.
+    uint8_t tcp_state;     // The TCP connection state.
+    uint64_t payload[];    // The flow stored by the cache layout.
+};
+
+/*
+ * Structure to store a doubly linked list of entries.
+ */
+struct flow_list
+{
+    uint32_t head;
+    uint32_t tail;
+};
+
+/*
+ * Structure to store a slot of the front cache.
+ */
+struct flow_front_slot
+{
+    uint32_t hash;
+    uint32_t index; // The cached entry or CACHE_NIL.
+};
+
+/*
+ * Structure to store the statistics of a timeout class.
+ */
+struct flow_class_statistics
+{
+    uint64_t exported_flows;
+    uint64_t residency_ms; // The total time the exported flows were cached.
+};
+
+/*
+ * Structure to store the flow cache. The flows are found by a hash table
+ * with chaining. The expiry is driven by the lists, whose heads are
+ * the first flows to expire:
+ * - age list    - flows ordered by their creation (active timer),
+ * - lru lists   - flows ordered by their last update (inactive timer),
+ *                 one list per timeout class,
+ * - closed list - flows finished by the TCP flags.
+ *
+ * Under the aggressive aging, the timeouts are shortened while the cache
+ * stays above the high-water mark, so the cache drains by the timers
+ * instead of the eviction of the oldest flows.
+ *
+ * The recently found flows are remembered by a small direct-mapped front
+ * cache indexed by the hash, which fits into the L1 cache. The hot flows
+ * are found without walking the buckets. The front cache refers to
+ * the entries, so the counters are updated in place and the slot is cleared
+ * when the entry is removed.
+ *
+ * The hash table starts small and it is resized by the number of cached
+ * flows. The entries are migrated from the old table incrementally,
+ * a few buckets by every insertion and removal. The old buckets below
+ * the rehash index are already migrated.
+ */
+struct flow_cache
+{
+    uint8_t* entries;
+    size_t entry_size;         // Size of an entry by the cache layout.
+    uint8_t layout;            // The cache layout of the entries.
+    uint32_t* buckets;
+    uint32_t bucket_mask;
+    uint32_t* old_buckets;     // The table being migrated or NULL.
+    uint32_t old_bucket_mask;
+    uint32_t rehash_index;     // The next old bucket to migrate.
+    uint32_t min_buckets;      // The minimum number of buckets.
+    uint32_t max_buckets;      // The maximum number of buckets.
+    uint32_t max_entries;      // The maximum number of cached flows.
+    uint32_t used_entries;     // The number of ever used entries.
+    uint32_t free_entries;     // The list of released entries.
+    uint32_t entries_number;   // The number of cached flows.
+    uint64_t resizes_number;   // The number of started resizes.
+    size_t entries_size;       // Size of the array of entries in bytes.
+    size_t buckets_size;       // Size of the array of buckets in bytes.
+    size_t old_buckets_size;   // Size of the old array of buckets in bytes.
+    bool huge_pages;           // The cache is backed by huge pages.
+    uint64_t hash_key[2];      // The random key of the flow hash.
+    uint64_t lookups_number;   // The number of searches.
+    uint64_t probes_number;    // The number of entries visited by searches.
+    uint64_t probe_alarms;     // The searches longer than the alarm limit.
+    uint32_t max_probe_length; // The longest search.
+    uint64_t front_hits;       // The searches answered by the front cache.
+    struct flow_front_slot front[CACHE_FRONT_SIZE];
+    uint8_t aging_level;       // The timeouts are divided by 2^aging_level.
+    uint64_t aging_transitions; // The number of aging level changes.
+    time_t aging_checked_sec;  // The packet time of the last aging check.
+    struct flow_list age_list;
+    struct flow_list lru_lists[CACHE_CLASSES];
+    struct flow_class_statistics class_statistics[CACHE_CLASSES];
+    struct flow_list closed_list;
+};
+
+/*
+ * Function for getting the flow stored by an entry.
+ *
+ * @param entry The entry.
+ * @return      The flow of the entry.
+ */
+static inline flow_node_t cache_flow (flow_entry_t entry)
+{
+    return (flow_node_t) entry->payload;
+}
+
+/*
+ * Function for getting the flow stored by an entry of the wire layout.
+ *
+ * @param entry The entry.
+ * @return      The wire format flow of the entry.
+ */
+static inline wire_flow_t cache_wire (flow_entry_t entry)
+{
+    return (wire_flow_t) entry->payload;
+}
+
+/*
+ * Function for computing the number of buckets for the maximum number
+ * of cached flows.
+ *
+ * @param entries_number The maximum number of cached flows.
+ * @return               The number of buckets (power of two).
+ */
+uint32_t cache_buckets_number (uint32_t entries_number);
+
+/*
+ * Function for selecting the cache layout by the options.
+ *
+ * @param options Pointer to options storage.
+ * @return        The cache layout.
+ */
+uint8_t cache_select_layout (options_t options);
+
+/*
+ * Function for computing the size of an entry of the cache layout.
+ *
+ * @param layout The cache layout.
+ * @return       The size of an entry in bytes.
+ */
+size_t cache_entry_size (uint8_t layout);
+
+/*
+ * Function for computing the memory size of the flow cache.
+ *
+ * @param entries_number The maximum number of cached flows.
+ * @param layout         The cache layout.
+ * @return               The memory size of the cache in bytes.
+ */
+uint64_t cache_memory_size (uint32_t entries_number, uint8_t layout);
+
+/*
+ * Function for computing the maximum number of cached flows
+ * which fits into the memory budget.
+ *
+ * @param budget_bytes The memory budget in bytes.
+ * @param layout       The cache layout.
+ * @return             The maximum number of cached flows.
+ */
+uint64_t cache_entries_for_budget (uint64_t budget_bytes, uint8_t layout);
+
+/*
+ * Function for setting a random key of the flow hash. The key is read
+ * from the system random source, if it is not available, the key
+ * is derived from the time and the process id.
+ *
+ * @param cache Pointer to the flow cache.
+ */
+void cache_seed_hash (flow_cache_t cache);
+
+/*
+ * Function for setting the key of the flow hash given by user, so the runs
+ * over the parts of the same traffic select the same flows.
+ *
+ * @param cache Pointer to the flow cache.
+ * @param key   The key of the flow hash.
+ */
+void cache_set_hash_key (flow_cache_t cache, const uint64_t key[2]);
+
+/*
+ * Function for computing the hash of a flow key. The hash is keyed
+ * by the random key of the cache, so the collisions cannot be computed
+ * in advance.
+ *
+ * @param cache Pointer to the flow cache.
+ * @param key   Pointer to the flow key.
+ * @return      The hash of the key.
+ */
+uint32_t cache_hash (flow_cache_t cache, netflow_v5_key_t key);
+
+/*
+ * Function for finding the timeout class of a flow. The classes with
+ * a port are preferred to the classes of the whole protocol.
+ *
+ * @param timeout_classes Pointer to the timeout classes.
+ * @param key             Pointer to the flow key.
+ * @return                The timeout class of the flow.
+ */
+uint8_t cache_timeout_class (timeout_classes_t timeout_classes, netflow_v5_key_t key);
+
+/*
+ * Function for searching the flow in the cache by key. The length
+ * of the search is monitored, the chains longer than CACHE_PROBE_ALARM
+ * are counted and the first one is reported.
+ *
+ * @param cache Pointer to the flow cache.
+ * @param key   Pointer to key which is searched.
+ * @param hash  The hash of the key.
+ * @return      The found entry or NULL if the flow is not cached.
+ */
+flow_entry_t cache_search (flow_cache_t cache, netflow_v5_key_t key, uint32_t hash);
+
+/*
+ * Function for inserting a new flow into the cache. The flow
+ * of the entry is left for the caller to set.
+ *
+ * @param cache         Pointer to the flow cache.
+ * @param key           Pointer to the key of the new flow.
+ * @param hash          The hash of the key.
+ * @param timeout_class The timeout class of the new flow.
+ * @return              The new entry or NULL if the cache is full.
+ */
+flow_entry_t cache_insert (flow_cache_t cache,
+                           netflow_v5_key_t key,
+                           uint32_t hash,
+                           uint8_t timeout_class);
+
+/*
+ * Function for removing an entry from the cache. The entry data stay
+ * unchanged until the entry is reused by the next insertion.
+ *
+ * @param cache Pointer to the flow cache.
+ * @param entry The removed entry.
+ */
+void cache_remove (flow_cache_t cache, flow_entry_t entry);
+
+/*
+ * Function for marking the update of a flow, the flow is moved
+ * to the end of the lru list.
+ *
+ * @param cache Pointer to the flow cache.
+ * @param entry The updated entry.
+ */
+void cache_touch (flow_cache_t cache, flow_entry_t entry);
+
+/*
+ * Function for moving a flow into the lru list of another timeout class.
+ * The function is called for the updated flows only, so the list stays
+ * ordered by the last update.
+ *
+ * @param cache         Pointer to the flow cache.
+ * @param entry         The updated entry.
+ * @param timeout_class The new timeout class.
+ */
+void cache_set_class (flow_cache_t cache, flow_entry_t entry, uint8_t timeout_class);
+
+/*
+ * Function for moving a flow finished by the TCP flags into the list
+ * of closed flows.
+ *
+ * @param cache Pointer to the flow cache.
+ * @param entry The closed entry.
+ */
+void cache_close (flow_cache_t cache, flow_entry_t entry);
+
+/*
+ * Function for computing a timeout shortened by the aggressive aging.
+ *
+ * @param cache           Pointer to the flow cache.
+ * @param timeout_seconds The configured timeout.
+ * @return                The effective timeout, at least one second.
+ */
+uint16_t cache_aged_timeout (flow_cache_t cache, uint16_t timeout_seconds);
+
+/*
+ * Function for exporting the expired flows. The closed flows and the heads
+ * of the age and lru lists are checked, so only the expired flows
+ * are visited. The exported flows are accounted in the statistics
+ * of their timeout class.
+ *
+ * @param netflow_records   Pointer to the netflow recording system.
+ * @param sending_system    Pointer to the sending system.
+ * @param actual_time_stamp The current timestamp of the currently last
+ *                          received packet.
+ * @param options           Pointer to options storage.
+ * @return                  Status of function processing.
+ */
+uint8_t cache_export_expired (struct netflow_recording_system* netflow_records,
+                              struct netflow_sending_system* sending_system,
+                              struct timeval* actual_time_stamp,
+                              options_t options);
+
+/*
+ * Function for exporting the oldest flow from the cache.
+ *
+ * @param netflow_records Pointer to the netflow recording system.
+ * @param sending_system  Pointer to the sending system.
+ * @return                Status of function processing.
+ */
+uint8_t cache_export_oldest (struct netflow_recording_system* netflow_records,
+                             struct netflow_sending_system* sending_system);
+
+/*
+ * Function for exporting all flows stored in the cache by the oldest one.
+ *
+ * @param netflow_records Pointer to the netflow recording system.
+ * @param sending_system  Pointer to the sending system.
+ * @return                Status of function processing.
+ */
+uint8_t cache_export_all (struct netflow_recording_system* netflow_records,
+                          struct netflow_sending_system* sending_system);
+
+#endif // FLOW_CACHE_H
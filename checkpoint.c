@@ -0,0 +1,522 @@
+/**********************************************************/
+/*                                                        */
+/* File: checkpoint.c                                     */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Checkpoint of the flow cache              */
+/*                                                        */
+/**********************************************************/
+
+#include "checkpoint.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "error.h"
+#include "memory.h"
+
+#define CHECKPOINT_PATH_LENGTH (4096)
+
+/*
+ * The helper function for rounding an offset up to the page boundary.
+ *
+ * @param offset The offset.
+ * @return       The aligned offset.
+ */
+static uint64_t checkpoint_align (uint64_t offset)
+{
+    return (offset + CHECKPOINT_ALIGNMENT - 1) & ~((uint64_t) CHECKPOINT_ALIGNMENT - 1);
+}
+
+/*
+ * The helper function for writing the whole buffer at an offset.
+ *
+ * @param fd     The file descriptor.
+ * @param data   The written data.
+ * @param size   The size of the data in bytes.
+ * @param offset The offset in the file.
+ * @return       Status of function processing.
+ */
+static uint8_t checkpoint_pwrite (int fd, const void* data, size_t size, uint64_t offset)
+{
+    const uint8_t* position = (const uint8_t*) data;
+    ssize_t written;
+
+    while (size > 0)
+    {
+        written = pwrite(fd, position, size, (off_t) offset);
+
+        if (written <= 0)
+        {
+            return CHECKPOINT_ERROR;
+        }
+
+        position += written;
+        offset += (uint64_t) written;
+        size -= (size_t) written;
+    }
+
+    return NO_ERROR;
+}
+
+/*
+ * The helper function for filling the state of the recording system.
+ *
+ * @param state           Pointer to the zero filled state.
+ * @param netflow_records Pointer to the netflow recording system.
+ * @param sending_system  Pointer to the sending system.
+ * @param options         Pointer to options storage.
+ */
+static void checkpoint_fill_state (checkpoint_state_t state,
+                                   netflow_recording_system_t netflow_records,
+                                   netflow_sending_system_t sending_system,
+                                   options_t options)
+{
+    memcpy(&(state->first_packet_time), netflow_records->first_packet_time,
+           sizeof(state->first_packet_time));
+    memcpy(&(state->last_packet_time), netflow_records->last_packet_time,
+           sizeof(state->last_packet_time));
+
+    state->cached_flows_number = *(netflow_records->cached_flows_number);
+    state->next_cache_id = netflow_records->next_cache_id;
+    state->flow_sequence_number = netflow_records->flow_sequence_number;
+    state->first_packet_seen = netflow_records->first_packet_seen;
+    state->biflow = options->biflow_set;
+    state->wire_format = options->wire_format_set;
+    state->aggregation_scheme = options->aggregation->scheme;
+    state->active_timeout_seconds = options->active_entries_timeout->timeout_seconds;
+    state->inactive_timeout_seconds = options->inactive_entries_timeout->timeout_seconds;
+    state->timeout_classes_number = options->timeout_classes->classes_number;
+    memcpy(state->timeout_classes, options->timeout_classes->classes,
+           state->timeout_classes_number * sizeof(struct timeout_class));
+    state->tcp_states_set = options->tcp_state_timeouts->is_user_set;
+    state->half_open_seconds = options->tcp_state_timeouts->half_open_seconds;
+    state->fin_wait_seconds = options->tcp_state_timeouts->fin_wait_seconds;
+
+    state->cache = *(netflow_records->cache);
+    state->cache.entries = NULL;
+    state->cache.buckets = NULL;
+    state->cache.old_buckets = NULL;
+
+    state->sampling = *(netflow_records->sampling);
+
+    if (netflow_records->admission != NULL)
+    {
+        state->admission_set = true;
+        state->admission = *(netflow_records->admission);
+    }
+
+    if (sending_system->ipfix != NULL)
+    {
+        state->ipfix_set = true;
+        state->ipfix_sequence_number = sending_system->ipfix->sequence_number;
+        state->ipfix_messages_since_template = sending_system->ipfix->messages_since_template;
+        state->ipfix_template_sent = sending_system->ipfix->template_sent;
+        state->ipfix_template_sent_sec = sending_system->ipfix->template_sent_sec;
+        state->ipfix_message_length = (uint32_t) sending_system->ipfix->message_length;
+        state->ipfix_data_set_offset = (uint32_t) sending_system->ipfix->data_set_offset;
+        state->ipfix_pending_records = sending_system->ipfix->pending_records;
+        state->ipfix_pending_since = sending_system->ipfix->pending_since;
+        memcpy(state->ipfix_message, sending_system->ipfix->message,
+               sending_system->ipfix->message_length);
+    }
+}
+
+/*
+ * Function for writing the state of the recording system into
+ * a checkpoint file. The file is written under a temporary name
+ * and renamed, so the previous checkpoint is replaced only
+ * by a complete one.
+ *
+ * @param netflow_records Pointer to the netflow recording system.
+ * @param sending_system  Pointer to the sending system.
+ * @param options         Pointer to options storage.
+ * @param file_name       The name of the checkpoint file.
+ * @return                Status of function processing.
+ */
+uint8_t checkpoint_write (netflow_recording_system_t netflow_records,
+                          netflow_sending_system_t sending_system,
+                          options_t options,
+                          const char* file_name)
+{
+    flow_cache_t cache = netflow_records->cache;
+    struct checkpoint_header header;
+    checkpoint_state_t state;
+    char temporary[CHECKPOINT_PATH_LENGTH];
+    uint64_t entries_bytes;
+    uint64_t buckets_bytes;
+    uint64_t old_buckets_bytes;
+    uint8_t status = NO_ERROR;
+    int fd;
+
+    if (snprintf(temporary, sizeof(temporary), "%s.tmp", file_name) >= (int) sizeof(temporary))
+    {
+        return CHECKPOINT_ERROR;
+    }
+
+    // The state is large because of the sketch of the admission.
+    state = (checkpoint_state_t) calloc(1, sizeof(struct checkpoint_state));
+
+    if (state == NULL)
+    {
+        return MEMORY_HANDLING_ERROR;
+    }
+
+    checkpoint_fill_state(state, netflow_records, sending_system, options);
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.header_size = sizeof(header);
+    header.byte_order = CHECKPOINT_BYTE_ORDER;
+    header.state_size = sizeof(struct checkpoint_state);
+    header.entry_size = (uint32_t) cache->entry_size;
+    header.used_entries = cache->used_entries;
+    header.buckets_number = cache->bucket_mask + 1;
+    header.old_buckets_number = (cache->old_buckets != NULL) ? cache->old_bucket_mask + 1 : 0;
+
+    // The entry with the CACHE_NIL index is stored too, so the mapped
+    // entries are indexed as in the cache.
+    entries_bytes = ((uint64_t) cache->used_entries + 1) * cache->entry_size;
+    buckets_bytes = (uint64_t) header.buckets_number * sizeof(uint32_t);
+    old_buckets_bytes = (uint64_t) header.old_buckets_number * sizeof(uint32_t);
+
+    header.entries_offset = checkpoint_align(sizeof(header) + sizeof(struct checkpoint_state));
+    header.buckets_offset = checkpoint_align(header.entries_offset + entries_bytes);
+    header.old_buckets_offset = checkpoint_align(header.buckets_offset + buckets_bytes);
+    header.file_size = header.old_buckets_offset + old_buckets_bytes;
+
+    fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd == -1)
+    {
+        free(state);
+
+        return CHECKPOINT_ERROR;
+    }
+
+    // The gaps between the arrays stay as holes of the file.
+    if (ftruncate(fd, (off_t) header.file_size) != 0)
+    {
+        status = CHECKPOINT_ERROR;
+    }
+
+    if (status == NO_ERROR)
+    {
+        status = checkpoint_pwrite(fd, state, sizeof(struct checkpoint_state), sizeof(header));
+    }
+
+    if (status == NO_ERROR)
+    {
+        status = checkpoint_pwrite(fd, cache->entries, entries_bytes, header.entries_offset);
+    }
+
+    if (status == NO_ERROR)
+    {
+        status = checkpoint_pwrite(fd, cache->buckets, buckets_bytes, header.buckets_offset);
+    }
+
+    if (status == NO_ERROR && old_buckets_bytes > 0)
+    {
+        status = checkpoint_pwrite(fd, cache->old_buckets, old_buckets_bytes,
+                                   header.old_buckets_offset);
+    }
+
+    // The magic marks the checkpoint as complete, so the header is written last.
+    if (status == NO_ERROR)
+    {
+        status = checkpoint_pwrite(fd, &header, sizeof(header), 0);
+    }
+
+    if (close(fd) != 0)
+    {
+        status = CHECKPOINT_ERROR;
+    }
+
+    if (status == NO_ERROR && rename(temporary, file_name) != 0)
+    {
+        status = CHECKPOINT_ERROR;
+    }
+
+    if (status != NO_ERROR)
+    {
+        unlink(temporary);
+    }
+
+    free(state);
+
+    return status;
+}
+
+/*
+ * The helper function for checking the header of a mapped checkpoint.
+ *
+ * @param header     Pointer to the mapped header.
+ * @param file_size  The size of the mapped file.
+ * @param entry_size The size of the entries of the allocated cache.
+ * @return           True if the checkpoint is complete and written
+ *                   by a compatible build with the same cache layout.
+ */
+static bool checkpoint_valid (checkpoint_header_t header, uint64_t file_size, size_t entry_size)
+{
+    uint64_t entries_bytes = ((uint64_t) header->used_entries + 1) * entry_size;
+
+    return memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic)) == 0 &&
+           header->version == CHECKPOINT_VERSION &&
+           header->header_size == sizeof(struct checkpoint_header) &&
+           header->byte_order == CHECKPOINT_BYTE_ORDER &&
+           header->state_size == sizeof(struct checkpoint_state) &&
+           header->entry_size == entry_size &&
+           header->file_size <= file_size &&
+           header->buckets_number != 0 &&
+           (header->buckets_number & (header->buckets_number - 1)) == 0 &&
+           (header->old_buckets_number & (header->old_buckets_number - 1)) == 0 &&
+           header->entries_offset >= sizeof(struct checkpoint_header) +
+                                     sizeof(struct checkpoint_state) &&
+           header->entries_offset + entries_bytes <= header->buckets_offset &&
+           header->buckets_offset + (uint64_t) header->buckets_number * sizeof(uint32_t) <=
+           header->old_buckets_offset &&
+           header->old_buckets_offset +
+           (uint64_t) header->old_buckets_number * sizeof(uint32_t) <= header->file_size;
+}
+
+/*
+ * The helper function for comparing the timers and the sampling
+ * of the checkpoint with the options of this run. The cached entries
+ * keep the indexes of their timeout classes and the sampling selected
+ * the cached flows, so the run has to continue with the same settings.
+ *
+ * @param state           Pointer to the stored state.
+ * @param netflow_records Pointer to the netflow recording system.
+ * @param options         Pointer to options storage.
+ * @return                True if the settings are the same, false otherwise.
+ */
+static bool checkpoint_same_settings (checkpoint_state_t state,
+                                      netflow_recording_system_t netflow_records,
+                                      options_t options)
+{
+    timeout_class_t stored;
+    timeout_class_t current;
+
+    if (state->active_timeout_seconds != options->active_entries_timeout->timeout_seconds ||
+        state->inactive_timeout_seconds != options->inactive_entries_timeout->timeout_seconds ||
+        state->timeout_classes_number != options->timeout_classes->classes_number ||
+        state->tcp_states_set != options->tcp_state_timeouts->is_user_set ||
+        (state->tcp_states_set &&
+         (state->half_open_seconds != options->tcp_state_timeouts->half_open_seconds ||
+          state->fin_wait_seconds != options->tcp_state_timeouts->fin_wait_seconds)) ||
+        state->sampling.base_mode != netflow_records->sampling->base_mode ||
+        state->sampling.base_interval != netflow_records->sampling->base_interval)
+    {
+        return false;
+    }
+
+    // The names are not compared, the classes are given by their values.
+    for (uint8_t i = 0; i < state->timeout_classes_number; i++)
+    {
+        stored = &(state->timeout_classes[i]);
+        current = &(options->timeout_classes->classes[i]);
+
+        if (stored->prot != current->prot ||
+            stored->port_set != current->port_set ||
+            (stored->port_set && stored->port != current->port) ||
+            stored->timeout_seconds != current->timeout_seconds)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * The helper function for restoring an array of buckets. The array
+ * of the cache is reused if it has the same size.
+ *
+ * @param buckets        Pointer to the array of the cache or NULL.
+ * @param buckets_size   Pointer to the size of the array in bytes.
+ * @param stored         The stored buckets.
+ * @param buckets_number The number of the stored buckets, 0 for no array.
+ * @return               Status of function processing.
+ */
+static uint8_t checkpoint_restore_buckets (uint32_t** buckets,
+                                           size_t* buckets_size,
+                                           const uint32_t* stored,
+                                           uint32_t buckets_number)
+{
+    size_t size = (size_t) buckets_number * sizeof(uint32_t);
+    bool huge_pages;
+
+    if (*buckets != NULL && *buckets_size != size)
+    {
+        free_cache_buckets(buckets, buckets_size);
+    }
+
+    if (buckets_number == 0)
+    {
+        return NO_ERROR;
+    }
+
+    if (*buckets == NULL &&
+        allocate_cache_buckets(buckets, buckets_size, buckets_number,
+                               false, false, &huge_pages) != EXIT_SUCCESS)
+    {
+        return MEMORY_HANDLING_ERROR;
+    }
+
+    memcpy(*buckets, stored, size);
+
+    return NO_ERROR;
+}
+
+/*
+ * Function for restoring the state of the recording system from
+ * a checkpoint file. The flow cache has to hold at least the stored
+ * flows, the options which change the cached keys have to be the same.
+ *
+ * @param netflow_records Pointer to the initialized netflow recording system.
+ * @param sending_system  Pointer to the sending system.
+ * @param options         Pointer to options storage.
+ * @param file_name       The name of the checkpoint file.
+ * @return                Status of function processing.
+ */
+uint8_t checkpoint_restore (netflow_recording_system_t netflow_records,
+                            netflow_sending_system_t sending_system,
+                            options_t options,
+                            const char* file_name)
+{
+    flow_cache_t cache = netflow_records->cache;
+    struct flow_cache current;
+    struct stat file_stat;
+    checkpoint_header_t header;
+    checkpoint_state_t state;
+    uint8_t* data;
+    uint8_t status;
+    int fd = open(file_name, O_RDONLY);
+
+    if (fd == -1)
+    {
+        return CHECKPOINT_ERROR;
+    }
+
+    if (fstat(fd, &file_stat) != 0 ||
+        (size_t) file_stat.st_size < sizeof(struct checkpoint_header) +
+                                     sizeof(struct checkpoint_state))
+    {
+        close(fd);
+
+        return CHECKPOINT_ERROR;
+    }
+
+    data = (uint8_t*) mmap(NULL, (size_t) file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+    {
+        return CHECKPOINT_ERROR;
+    }
+
+    header = (checkpoint_header_t) data;
+    state = (checkpoint_state_t) (data + header->header_size);
+
+    if (!checkpoint_valid(header, (uint64_t) file_stat.st_size, cache->entry_size) ||
+        header->used_entries > cache->max_entries ||
+        state->biflow != options->biflow_set ||
+        state->wire_format != options->wire_format_set ||
+        state->aggregation_scheme != options->aggregation->scheme ||
+        state->ipfix_set != (sending_system->ipfix != NULL) ||
+        !checkpoint_same_settings(state, netflow_records, options) ||
+        (options->flow_hash_key->is_user_set &&
+         memcmp(state->cache.hash_key, options->flow_hash_key->key,
+                sizeof(state->cache.hash_key)) != 0) ||
+        state->ipfix_message_length > MTU_MAX ||
+        (sending_system->ipfix != NULL &&
+         state->ipfix_message_length > sending_system->ipfix->message_size))
+    {
+        munmap(data, (size_t) file_stat.st_size);
+
+        return CHECKPOINT_ERROR;
+    }
+
+    // The arrays and the limits are kept from the allocated cache,
+    // the rest of the cache is taken from the checkpoint.
+    current = *cache;
+    *cache = state->cache;
+    cache->entries = current.entries;
+    cache->entry_size = current.entry_size;
+    cache->layout = current.layout;
+    cache->entries_size = current.entries_size;
+    cache->buckets = current.buckets;
+    cache->buckets_size = current.buckets_size;
+    cache->old_buckets = current.old_buckets;
+    cache->old_buckets_size = current.old_buckets_size;
+    cache->min_buckets = current.min_buckets;
+    cache->max_buckets = current.max_buckets;
+    cache->max_entries = current.max_entries;
+    cache->huge_pages = current.huge_pages;
+
+    memcpy(cache->entries, data + header->entries_offset,
+           ((size_t) header->used_entries + 1) * cache->entry_size);
+
+    status = checkpoint_restore_buckets(&(cache->buckets),
+                                        &(cache->buckets_size),
+                                        (const uint32_t*) (data + header->buckets_offset),
+                                        header->buckets_number);
+
+    if (status == NO_ERROR)
+    {
+        status = checkpoint_restore_buckets(&(cache->old_buckets),
+                                            &(cache->old_buckets_size),
+                                            (const uint32_t*) (data + header->old_buckets_offset),
+                                            header->old_buckets_number);
+    }
+
+    memcpy(netflow_records->first_packet_time, &(state->first_packet_time),
+           sizeof(state->first_packet_time));
+    memcpy(netflow_records->last_packet_time, &(state->last_packet_time),
+           sizeof(state->last_packet_time));
+
+    *(netflow_records->cached_flows_number) = state->cached_flows_number;
+    netflow_records->next_cache_id = state->next_cache_id;
+    netflow_records->flow_sequence_number = state->flow_sequence_number;
+    netflow_records->first_packet_seen = state->first_packet_seen;
+
+    // Only the selection of the packets is continued, the statistics
+    // and the load shedding start again.
+    netflow_records->sampling->position = state->sampling.position;
+    netflow_records->sampling->selected = state->sampling.selected;
+    netflow_records->sampling->random_state = state->sampling.random_state;
+
+    if (netflow_records->admission != NULL && state->admission_set)
+    {
+        memcpy(netflow_records->admission->sketch, state->admission.sketch,
+               sizeof(netflow_records->admission->sketch));
+        netflow_records->admission->period_start = state->admission.period_start;
+        netflow_records->admission->period_started = state->admission.period_started;
+    }
+
+    if (sending_system->ipfix != NULL && state->ipfix_set)
+    {
+        sending_system->ipfix->sequence_number = state->ipfix_sequence_number;
+        sending_system->ipfix->messages_since_template = state->ipfix_messages_since_template;
+        sending_system->ipfix->template_sent = state->ipfix_template_sent;
+        sending_system->ipfix->template_sent_sec = state->ipfix_template_sent_sec;
+        sending_system->ipfix->message_length = state->ipfix_message_length;
+        sending_system->ipfix->data_set_offset = state->ipfix_data_set_offset;
+        sending_system->ipfix->pending_records = state->ipfix_pending_records;
+        sending_system->ipfix->pending_since = state->ipfix_pending_since;
+        memcpy(sending_system->ipfix->message, state->ipfix_message,
+               state->ipfix_message_length);
+    }
+
+    munmap(data, (size_t) file_stat.st_size);
+
+    return status;
+}
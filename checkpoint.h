@@ -0,0 +1,134 @@
+/**********************************************************/
+/*                                                        */
+/* File: checkpoint.h                                     */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Header file for the checkpoint            */
+/*              of the flow cache                         */
+/*                                                        */
+/**********************************************************/
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+#include "admission.h"
+#include "cache.h"
+#include "ipfix.h"
+#include "netflow_v5.h"
+#include "option.h"
+#include "sampling.h"
+
+#define CHECKPOINT_MAGIC      "FCHK"
+#define CHECKPOINT_VERSION    (2)
+#define CHECKPOINT_BYTE_ORDER (0x01020304) // Written in the byte order of the writer.
+#define CHECKPOINT_ALIGNMENT  (4096)       // The arrays start at page boundaries.
+
+typedef struct checkpoint_header* checkpoint_header_t;
+typedef struct checkpoint_state* checkpoint_state_t;
+
+/*
+ * Structure to store the header of a checkpoint file. The arrays
+ * of the cache follow the state at the page boundaries, so they can be
+ * mapped directly. The header is written last, a checkpoint without
+ * the magic is incomplete.
+ */
+struct checkpoint_header
+{
+    char magic[4];               // CHECKPOINT_MAGIC without the terminating zero.
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t byte_order;         // CHECKPOINT_BYTE_ORDER.
+    uint32_t state_size;         // The size of the structures of this build.
+    uint32_t entry_size;
+    uint32_t used_entries;       // The stored entries without the CACHE_NIL entry.
+    uint32_t buckets_number;
+    uint32_t old_buckets_number; // 0 if no resize is in progress.
+    uint64_t entries_offset;
+    uint64_t buckets_offset;
+    uint64_t old_buckets_offset;
+    uint64_t file_size;
+};
+
+/*
+ * Structure to store the state of the recording system. The structures
+ * are stored as they are in the memory, their pointers are cleared.
+ */
+struct checkpoint_state
+{
+    struct timeval first_packet_time;
+    struct timeval last_packet_time;
+    uint64_t cached_flows_number;
+    uint64_t next_cache_id;
+    uint32_t flow_sequence_number;
+    bool first_packet_seen;
+    // The options which change the cached entries.
+    bool biflow;
+    bool wire_format;
+    uint8_t aggregation_scheme;
+    // The options which set the timers of the cached entries, the entries
+    // keep the indexes of the timeout classes and their TCP states.
+    uint16_t active_timeout_seconds;
+    uint16_t inactive_timeout_seconds;
+    uint8_t timeout_classes_number;
+    struct timeout_class timeout_classes[TIMEOUT_CLASSES_MAX];
+    bool tcp_states_set;
+    uint16_t half_open_seconds;
+    uint16_t fin_wait_seconds;
+    bool admission_set;
+    bool ipfix_set;
+    uint32_t ipfix_sequence_number;
+    uint32_t ipfix_messages_since_template;
+    bool ipfix_template_sent;
+    time_t ipfix_template_sent_sec;
+    // The open IPFIX message is continued by the next run.
+    uint32_t ipfix_message_length;
+    uint32_t ipfix_data_set_offset;
+    uint16_t ipfix_pending_records;
+    struct timeval ipfix_pending_since;
+    uint8_t ipfix_message[MTU_MAX];
+    struct flow_cache cache;
+    struct packet_sampling sampling;
+    struct flow_admission admission;
+};
+
+/*
+ * Function for writing the state of the recording system into
+ * a checkpoint file. The file is written under a temporary name
+ * and renamed, so the previous checkpoint is replaced only
+ * by a complete one.
+ *
+ * @param netflow_records Pointer to the netflow recording system.
+ * @param sending_system  Pointer to the sending system.
+ * @param options         Pointer to options storage.
+ * @param file_name       The name of the checkpoint file.
+ * @return                Status of function processing.
+ */
+uint8_t checkpoint_write (netflow_recording_system_t netflow_records,
+                          netflow_sending_system_t sending_system,
+                          options_t options,
+                          const char* file_name);
+
+/*
+ * Function for restoring the state of the recording system from
+ * a checkpoint file. The flow cache has to hold at least the stored
+ * flows, the options which change the cached keys, the timers, the sampling
+ * and the export format have to be the same.
+ *
+ * @param netflow_records Pointer to the initialized netflow recording system.
+ * @param sending_system  Pointer to the sending system.
+ * @param options         Pointer to options storage.
+ * @param file_name       The name of the checkpoint file.
+ * @return                Status of function processing.
+ */
+uint8_t checkpoint_restore (netflow_recording_system_t netflow_records,
+                            netflow_sending_system_t sending_system,
+                            options_t options,
+                            const char* file_name);
+
+#endif // CHECKPOINT_H
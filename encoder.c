@@ -0,0 +1,168 @@
+/**********************************************************/
+/*                                                        */
+/* File: encoder.c                                        */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Batch encoding of the NetFlow v5 records  */
+/*                                                        */
+/**********************************************************/
+
+#include "encoder.h"
+
+#include <arpa/inet.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ENCODER_X86
+#endif
+
+/*
+ * The scalar swapping of the records, used on the processors without
+ * the byte shuffles. It keeps the values on the big-endian hosts.
+ */
+static void swap_records_scalar (netflow_v5_flow_record_t records, uint16_t records_number)
+{
+    netflow_v5_flow_record_t record;
+
+    for (uint16_t i = 0; i < records_number; i++)
+    {
+        record = &(records[i]);
+
+        record->input = htons(record->input);
+        record->output = htons(record->output);
+        record->packets = htonl(record->packets);
+        record->octets = htonl(record->octets);
+        record->first = htonl(record->first);
+        record->last = htonl(record->last);
+        record->src_port = htons(record->src_port);
+        record->dst_port = htons(record->dst_port);
+        record->src_as = htons(record->src_as);
+        record->dst_as = htons(record->dst_as);
+        record->pad2 = htons(record->pad2);
+    }
+}
+
+#ifdef ENCODER_X86
+
+// The shuffles of the three 16-byte parts of a 48-byte record. The addresses,
+// the next hop and the single bytes keep their positions, the 16-bit
+// and 32-bit fields are reversed.
+#define ENCODER_MASK_0 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 12, 15, 14
+#define ENCODER_MASK_1 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+#define ENCODER_MASK_2 1, 0, 3, 2, 4, 5, 6, 7, 9, 8, 11, 10, 12, 13, 15, 14
+
+/*
+ * The swapping of the records by the SSSE3 byte shuffles,
+ * a record per three shuffles.
+ */
+__attribute__((target("ssse3")))
+static void swap_records_ssse3 (netflow_v5_flow_record_t records, uint16_t records_number)
+{
+    const __m128i mask_0 = _mm_setr_epi8(ENCODER_MASK_0);
+    const __m128i mask_1 = _mm_setr_epi8(ENCODER_MASK_1);
+    const __m128i mask_2 = _mm_setr_epi8(ENCODER_MASK_2);
+    __m128i* part = (__m128i*) records;
+
+    for (uint16_t i = 0; i < records_number; i++, part += 3)
+    {
+        _mm_storeu_si128(part, _mm_shuffle_epi8(_mm_loadu_si128(part), mask_0));
+        _mm_storeu_si128(part + 1, _mm_shuffle_epi8(_mm_loadu_si128(part + 1), mask_1));
+        _mm_storeu_si128(part + 2, _mm_shuffle_epi8(_mm_loadu_si128(part + 2), mask_2));
+    }
+}
+
+/*
+ * The swapping of the records by the AVX2 byte shuffles. The shuffles
+ * work within the 16-byte lanes, so two records are swapped by three
+ * 32-byte shuffles with the masks of their parts.
+ */
+__attribute__((target("avx2")))
+static void swap_records_avx2 (netflow_v5_flow_record_t records, uint16_t records_number)
+{
+    const __m256i mask_01 = _mm256_setr_epi8(ENCODER_MASK_0, ENCODER_MASK_1);
+    const __m256i mask_20 = _mm256_setr_epi8(ENCODER_MASK_2, ENCODER_MASK_0);
+    const __m256i mask_12 = _mm256_setr_epi8(ENCODER_MASK_1, ENCODER_MASK_2);
+    __m256i* part = (__m256i*) records;
+    uint16_t i;
+
+    for (i = 0; i + 2 <= records_number; i += 2, part += 3)
+    {
+        _mm256_storeu_si256(part, _mm256_shuffle_epi8(_mm256_loadu_si256(part), mask_01));
+        _mm256_storeu_si256(part + 1, _mm256_shuffle_epi8(_mm256_loadu_si256(part + 1), mask_20));
+        _mm256_storeu_si256(part + 2, _mm256_shuffle_epi8(_mm256_loadu_si256(part + 2), mask_12));
+    }
+
+    if (i < records_number)
+    {
+        swap_records_ssse3(&(records[i]), 1);
+    }
+}
+
+#endif // ENCODER_X86
+
+/*
+ * Function for initializing the encoder. The byte swapping is selected
+ * once by the instruction sets of the processor, the scalar swapping
+ * is used on the other processors.
+ *
+ * @param encoder Pointer to the encoder.
+ */
+void encoder_init (record_encoder_t encoder)
+{
+    encoder->name = "scalar";
+    encoder->swap = swap_records_scalar;
+    encoder->records_number = 0;
+    encoder->encoding_ns = 0;
+
+#ifdef ENCODER_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        encoder->name = "AVX2";
+        encoder->swap = swap_records_avx2;
+    }
+    else if (__builtin_cpu_supports("ssse3"))
+    {
+        encoder->name = "SSSE3";
+        encoder->swap = swap_records_ssse3;
+    }
+#endif
+}
+
+/*
+ * Function for getting the time of the monotonic clock.
+ *
+ * @return The time in nanoseconds.
+ */
+uint64_t encoder_clock_ns (void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000 + (uint64_t) now.tv_nsec;
+}
+
+/*
+ * Function for finishing the records of a datagram filled
+ * in the host byte order.
+ *
+ * @param encoder        Pointer to the encoder.
+ * @param records        The records of the datagram.
+ * @param records_number The number of records.
+ * @param start_ns       The time the filling of the records started.
+ */
+void encoder_finish (record_encoder_t encoder,
+                     netflow_v5_flow_record_t records,
+                     uint16_t records_number,
+                     uint64_t start_ns)
+{
+    encoder->swap(records, records_number);
+
+    encoder->records_number += records_number;
+    encoder->encoding_ns += encoder_clock_ns() - start_ns;
+}
@@ -0,0 +1,91 @@
+/**********************************************************/
+/*                                                        */
+/* File: encoder.h                                        */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Header file for the batch encoding        */
+/*              of the NetFlow v5 records                 */
+/*                                                        */
+/**********************************************************/
+
+#ifndef FLOW_ENCODER_H
+#define FLOW_ENCODER_H
+
+#include <stdint.h>
+#include <sys/time.h>
+
+#include "netflow_v5.h"
+
+typedef struct record_encoder* record_encoder_t;
+
+/*
+ * Type of the function for converting the records of a datagram
+ * from the host byte order into the network byte order in place.
+ * The addresses are kept, they are stored in the network byte order.
+ *
+ * @param records        The records of the datagram.
+ * @param records_number The number of records.
+ */
+typedef void (*encoder_swap_function_t) (netflow_v5_flow_record_t records,
+                                         uint16_t records_number);
+
+/*
+ * Structure to store the encoder of the NetFlow v5 records.
+ */
+struct record_encoder
+{
+    const char* name;             // The instruction set of the byte swapping.
+    encoder_swap_function_t swap;
+    uint64_t records_number;      // The encoded records.
+    uint64_t encoding_ns;         // The time of the encoding.
+};
+
+/*
+ * Function for initializing the encoder. The byte swapping is selected
+ * once by the instruction sets of the processor, the scalar swapping
+ * is used on the other processors.
+ *
+ * @param encoder Pointer to the encoder.
+ */
+void encoder_init (record_encoder_t encoder);
+
+/*
+ * Function for getting the time of the monotonic clock.
+ *
+ * @return The time in nanoseconds.
+ */
+uint64_t encoder_clock_ns (void);
+
+/*
+ * Function for getting the time of a flow in milliseconds since
+ * the first packet. The first packet time is converted once per batch.
+ *
+ * @param time     The time of the flow.
+ * @param first_us The time of the first packet in microseconds.
+ * @return         The value of the record field in the host byte order.
+ */
+static inline uint32_t encoder_time_ms (const struct timeval* time, int64_t first_us)
+{
+    int64_t offset_us = (int64_t) time->tv_sec * 1000000 + time->tv_usec - first_us;
+
+    // Rounded down like get_timeval_ms for the times before the first packet.
+    return (uint32_t) ((offset_us >= 0) ? offset_us / 1000 : (offset_us - 999) / 1000);
+}
+
+/*
+ * Function for finishing the records of a datagram filled
+ * in the host byte order.
+ *
+ * @param encoder        Pointer to the encoder.
+ * @param records        The records of the datagram.
+ * @param records_number The number of records.
+ * @param start_ns       The time the filling of the records started.
+ */
+void encoder_finish (record_encoder_t encoder,
+                     netflow_v5_flow_record_t records,
+                     uint16_t records_number,
+                     uint64_t start_ns);
+
+#endif // FLOW_ENCODER_H
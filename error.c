@@ -37,6 +37,27 @@ void print_error (uint8_t error, char* program_name)
         "error while handling socket",
         "error while handling pcap",
         "error while sending packet",
+        "sampling mode or interval not valid",
+        "maximum processing lag not in range",
+        "admission threshold not valid",
+        "aging water marks not in range",
+        "timeout class not valid",
+        "TCP state timeout not in range",
+        "unknown aggregation scheme",
+        "invalid routing table file",
+        "unknown export format",
+        "MTU not in range",
+        "error while writing the output file",
+        "error while writing the Arrow file",
+        "Arrow batch size not in range",
+        "error while writing the flow store",
+        "error while handling the checkpoint file",
+        "time window not valid",
+        "the input file cannot be indexed",
+        "invalid packet filter expression",
+        "unsupported link type of the input",
+        "the wire format cache (-W) supports only the NetFlow v5 export to the collector",
+        "hash key not valid, 32 hex digits or a file holding them expected",
         "unknown error"
     };
 
@@ -49,7 +70,20 @@ void print_error (uint8_t error, char* program_name)
 
     if (error == INVALID_OPTION_ERROR ||
         error == ACTIVE_RANGE_ERROR ||
-        error == INACTIVE_RANGE_ERROR)
+        error == INACTIVE_RANGE_ERROR ||
+        error == SAMPLING_ERROR ||
+        error == MAX_LAG_RANGE_ERROR ||
+        error == ADMISSION_ERROR ||
+        error == WATERMARK_RANGE_ERROR ||
+        error == TIMEOUT_CLASS_ERROR ||
+        error == TCP_STATE_RANGE_ERROR ||
+        error == AGGREGATION_ERROR ||
+        error == EXPORT_FORMAT_ERROR ||
+        error == MTU_RANGE_ERROR ||
+        error == BATCH_RANGE_ERROR ||
+        error == TIME_WINDOW_ERROR ||
+        error == WIRE_FORMAT_ERROR ||
+        error == HASH_KEY_ERROR)
     {
         print_help(program_name);
     }
@@ -30,6 +30,27 @@ enum error
     SOCKET_ERROR,
     PCAP_HANDLING_ERROR,
     PACKET_SENDING_ERROR,
+    SAMPLING_ERROR,
+    MAX_LAG_RANGE_ERROR,
+    ADMISSION_ERROR,
+    WATERMARK_RANGE_ERROR,
+    TIMEOUT_CLASS_ERROR,
+    TCP_STATE_RANGE_ERROR,
+    AGGREGATION_ERROR,
+    ROUTING_FILE_ERROR,
+    EXPORT_FORMAT_ERROR,
+    MTU_RANGE_ERROR,
+    SINK_FILE_ERROR,
+    ARROW_FILE_ERROR,
+    BATCH_RANGE_ERROR,
+    STORE_ERROR,
+    CHECKPOINT_ERROR,
+    TIME_WINDOW_ERROR,
+    TIME_INDEX_ERROR,
+    FILTER_ERROR,
+    LINK_TYPE_ERROR,
+    WIRE_FORMAT_ERROR,
+    HASH_KEY_ERROR,
     UNKNOWN_ERROR
 };
 
@@ -16,13 +16,25 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/time.h>
 #include <unistd.h>
 
+#include "admission.h"
+#include "aggregation.h"
+#include "arrow.h"
+#include "cache.h"
+#include "checkpoint.h"
+#include "encoder.h"
 #include "error.h"
+#include "ipfix.h"
 #include "memory.h"
 #include "netflow_v5.h"
 #include "option.h"
 #include "pcap.h"
+#include "routing.h"
+#include "sampling.h"
+#include "sink.h"
+#include "store.h"
 #include "util.h"
 
 #define DEFAULT_PORT 2055
@@ -127,6 +139,51 @@ void disconnect_socket (const int* sock)
     close(*sock);
 }
 
+/*
+ * Function for printing the average residency of the exported flows
+ * in the flow-cache for every timeout class.
+ *
+ * @param cache   Pointer to the flow cache.
+ * @param options Pointer to options storage.
+ */
+void print_class_residency (struct flow_cache* cache, options_t options)
+{
+    flow_class_statistics_t statistics;
+    const char* name;
+
+    printf("Average flow-cache residency:\n");
+
+    for (uint8_t i = 0; i < CACHE_CLASSES; i++)
+    {
+        if (i == CACHE_HALF_OPEN_CLASS || i == CACHE_FIN_WAIT_CLASS)
+        {
+            if (!options->tcp_state_timeouts->is_user_set)
+            {
+                break;
+            }
+
+            name = (i == CACHE_HALF_OPEN_CLASS) ? "tcp half-open" : "tcp fin-wait";
+        }
+        else if (i > options->timeout_classes->classes_number)
+        {
+            continue;
+        }
+        else
+        {
+            name = (i == CACHE_DEFAULT_CLASS) ? "default" :
+                   options->timeout_classes->classes[i - 1].name;
+        }
+
+        statistics = &(cache->class_statistics[i]);
+
+        printf("  %-16s %10lu flows %10.3f s\n",
+               name,
+               statistics->exported_flows,
+               (statistics->exported_flows > 0) ?
+               (double) statistics->residency_ms / statistics->exported_flows / 1000 : 0.0);
+    }
+}
+
 /*
  * Function to handle needed operations before ending of flow program.
  * The needed operations is:
@@ -142,20 +199,199 @@ uint8_t flow_epilogue (netflow_recording_system_t netflow_records,
                        options_t options)
 {
     uint8_t status;
+    uint8_t sink_status;
+    uint8_t arrow_status;
+    uint8_t store_status;
 
-    status = export_all_flows_dispose_tree(netflow_records, sending_system);
+    status = NO_ERROR;
+
+    // The checkpointed flows are exported by the run which restores them.
+    if (netflow_records != NULL && !netflow_records->checkpointed)
+    {
+        status = export_all_flows(netflow_records, sending_system);
+    }
 
-    if (sending_system != NULL && sending_system->socket)
+    if (sending_system != NULL && sending_system->collector_connected)
     {
         disconnect_socket(sending_system->socket);
     }
 
+    if (sending_system != NULL && sending_system->sink != NULL && sending_system->sink->fd != -1)
+    {
+        sink_status = sink_close(netflow_records, sending_system->sink);
+
+        if (status == NO_ERROR)
+        {
+            status = sink_status;
+        }
+    }
+
+    if (sending_system != NULL && sending_system->arrow != NULL && sending_system->arrow->file != NULL)
+    {
+        arrow_status = arrow_close(sending_system->arrow);
+
+        if (status == NO_ERROR)
+        {
+            status = arrow_status;
+        }
+    }
+
+    if (sending_system != NULL && sending_system->store != NULL)
+    {
+        store_status = store_close(sending_system->store);
+
+        if (status == NO_ERROR)
+        {
+            status = store_status;
+        }
+    }
+
     if (netflow_records != NULL)
     {
         printf("\n");
         printf("Exported %lu flows in %lu packets\n",
                *(netflow_records->flows_statistics),
                *(netflow_records->sent_packets_statistics));
+
+        if (sending_system != NULL && sending_system->encoder != NULL &&
+            sending_system->encoder->records_number > 0)
+        {
+            printf("Encoded %lu records (%s), %.0f records/s\n",
+                   sending_system->encoder->records_number,
+                   sending_system->encoder->name,
+                   (sending_system->encoder->encoding_ns > 0) ?
+                   1e9 * sending_system->encoder->records_number /
+                   sending_system->encoder->encoding_ns : 0.0);
+        }
+
+        if (options->packet_sampling->is_user_set ||
+            options->ingest_max_lag->is_user_set)
+        {
+            printf("Sampled %lu of %lu packets\n",
+                   netflow_records->sampling->sampled_packets,
+                   netflow_records->sampling->seen_packets);
+        }
+
+        if (netflow_records->link_type_name != NULL)
+        {
+            // The read rate of the link type, the tagged packets
+            // take the slower path of the parser.
+            printf("Link type %s: %lu IPv4 packets (%lu VLAN, %lu MPLS) of %lu, read %.0f packets/s\n",
+                   netflow_records->link_type_name,
+                   netflow_records->link_statistics.ipv4_packets,
+                   netflow_records->link_statistics.vlan_packets,
+                   netflow_records->link_statistics.mpls_packets,
+                   netflow_records->read_packets - netflow_records->filtered_packets,
+                   (netflow_records->processing_us > 0) ?
+                   1e6 * netflow_records->read_packets / netflow_records->processing_us : 0.0);
+        }
+
+        if (options->packet_filter->is_user_set)
+        {
+            // The rejected packets are not parsed, compare the read rate
+            // with a run without the filter for the gain.
+            printf("Packet filter: rejected %lu of %lu packets (%.1f%%), read %.0f packets/s\n",
+                   netflow_records->filtered_packets,
+                   netflow_records->read_packets,
+                   (netflow_records->read_packets > 0) ?
+                   100.0 * netflow_records->filtered_packets / netflow_records->read_packets : 0.0,
+                   (netflow_records->processing_us > 0) ?
+                   1e6 * netflow_records->read_packets / netflow_records->processing_us : 0.0);
+        }
+
+        if (options->time_window->is_user_set)
+        {
+            printf("Time window: %lu flows of the neighbouring windows not exported\n",
+                   netflow_records->window_dropped_flows);
+        }
+
+        if (netflow_records->checkpointed)
+        {
+            printf("Checkpoint: %u flows kept for the next run\n",
+                   netflow_records->cache->entries_number);
+        }
+
+        if (netflow_records->cache != NULL)
+        {
+            // The used entries are the peak number of the cached flows.
+            printf("Flow cache: peak %u flows\n", netflow_records->cache->used_entries);
+        }
+
+        if (options->aging_watermarks->is_user_set && netflow_records->cache != NULL)
+        {
+            printf("Aggressive aging changed the timeouts %lu times\n",
+                   netflow_records->cache->aging_transitions);
+        }
+
+        if (netflow_records->cache != NULL && netflow_records->cache->lookups_number > 0)
+        {
+            printf("Flow hash: %.2f probes per search, longest %u, %lu alarms\n",
+                   (double) netflow_records->cache->probes_number /
+                   netflow_records->cache->lookups_number,
+                   netflow_records->cache->max_probe_length,
+                   netflow_records->cache->probe_alarms);
+            printf("Front cache: %.1f%% hits\n",
+                   100.0 * netflow_records->cache->front_hits /
+                   netflow_records->cache->lookups_number);
+        }
+
+        if ((options->timeout_classes->is_user_set || options->tcp_state_timeouts->is_user_set) &&
+            netflow_records->cache != NULL)
+        {
+            print_class_residency(netflow_records->cache, options);
+        }
+
+        if (sending_system != NULL && sending_system->sink != NULL)
+        {
+            printf("Output file: %lu records in %lu segments\n",
+                   sending_system->sink->records_number,
+                   sending_system->sink->segments_number);
+        }
+
+        if (sending_system != NULL && sending_system->arrow != NULL)
+        {
+            printf("Arrow file: %lu records in %u batches\n",
+                   sending_system->arrow->records_number,
+                   sending_system->arrow->blocks_number);
+        }
+
+        if (sending_system != NULL && sending_system->store != NULL)
+        {
+            printf("Flow store: %lu records in %u segments, %.1f%% of the record size\n",
+                   sending_system->store->records_number,
+                   sending_system->store->segments_number,
+                   (sending_system->store->raw_bytes > 0) ?
+                   100.0 * sending_system->store->stored_bytes /
+                   sending_system->store->raw_bytes : 100.0);
+        }
+
+        if (sending_system != NULL && sending_system->ipfix != NULL)
+        {
+            printf("IPFIX: %lu templates sent\n", sending_system->ipfix->templates_number);
+        }
+
+        if (netflow_records->routing != NULL)
+        {
+            printf("Routing: %lu lookups, %lu without route\n",
+                   netflow_records->routing->lookups_number,
+                   netflow_records->routing->misses_number);
+        }
+
+        if (netflow_records->admission != NULL)
+        {
+            printf("Admitted %lu new flows, %lu packets aggregated by protocol\n",
+                   netflow_records->admission->admitted_flows,
+                   netflow_records->admission->aggregated_packets);
+        }
+
+        if (options->ingest_max_lag->is_user_set)
+        {
+            printf("Load shedding raised the sampling %lu times and lowered it %lu times "
+                   "(maximum interval: %d)\n",
+                   netflow_records->sampling->raises_number,
+                   netflow_records->sampling->lowers_number,
+                   netflow_records->sampling->max_interval);
+        }
     }
 
     free_allocated_mem(&options, &netflow_records, &sending_system);
@@ -167,12 +403,66 @@ uint8_t run_exporter (netflow_recording_system_t netflow_records,
                       netflow_sending_system_t sending_system,
                       options_t options)
 {
-    bst_init(&(netflow_records->tree));
+    uint8_t status;
+
     *(netflow_records->cached_flows_number) = 0;
     *(netflow_records->flows_statistics) = 0;
     *(netflow_records->sent_packets_statistics) = 0;
 
-    return run_packets_processing(netflow_records, sending_system, options);
+    sampling_init(netflow_records->sampling,
+                  options->packet_sampling->mode,
+                  options->packet_sampling->interval);
+
+    if (netflow_records->admission != NULL)
+    {
+        // The sketch is cleared once per inactive timeout, a flow has to reach
+        // the threshold before it would expire as inactive.
+        admission_init(netflow_records->admission,
+                       options->new_flow_admission->packets,
+                       options->new_flow_admission->octets,
+                       options->inactive_entries_timeout->timeout_seconds);
+    }
+
+    if (options->ingest_max_lag->is_user_set)
+    {
+        sampling_enable_shedding(netflow_records->sampling,
+                                 options->ingest_max_lag->lag_ms);
+    }
+
+    netflow_records->window_from_ms = options->time_window->from_ms;
+    netflow_records->window_to_ms = options->time_window->to_ms;
+
+    if (options->restore_source->is_user_set)
+    {
+        status = checkpoint_restore(netflow_records,
+                                    sending_system,
+                                    options,
+                                    options->restore_source->file_name);
+
+        if (status != NO_ERROR)
+        {
+            return status;
+        }
+    }
+
+    status = run_packets_processing(netflow_records, sending_system, options);
+
+    if (status != NO_ERROR || !options->checkpoint_target->is_user_set)
+    {
+        return status;
+    }
+
+    status = checkpoint_write(netflow_records,
+                              sending_system,
+                              options,
+                              options->checkpoint_target->file_name);
+
+    if (status == NO_ERROR)
+    {
+        netflow_records->checkpointed = true;
+    }
+
+    return status;
 }
 
 /*
@@ -183,6 +473,8 @@ int main (int argc, char* argv[])
     options_t options = NULL;
     netflow_recording_system_t netflow_records = NULL;
     netflow_sending_system_t sending_system = NULL;
+    struct timeval load_start;
+    struct timeval load_end;
     uint8_t status = handle_options(argc, argv, &options);
 
     if (status != NO_ERROR)
@@ -207,6 +499,77 @@ int main (int argc, char* argv[])
     printf("inactive_timer: %d\n", options->inactive_entries_timeout->timeout_seconds);
     printf("cache_size: %d\n", options->cached_entries_number->entries_number);
 
+    if (options->packet_sampling->is_user_set)
+    {
+        printf("sampling: %s 1:%d\n",
+               sampling_mode_name(options->packet_sampling->mode),
+               options->packet_sampling->interval);
+    }
+
+    if (options->ingest_max_lag->is_user_set)
+    {
+        printf("max_lag: %d ms\n", options->ingest_max_lag->lag_ms);
+    }
+
+    if (options->aging_watermarks->is_user_set)
+    {
+        printf("aggressive_aging: %d%% high, %d%% low\n",
+               options->aging_watermarks->high_percent,
+               options->aging_watermarks->low_percent);
+    }
+
+    if (options->timeout_classes->is_user_set)
+    {
+        printf("timeout_classes:");
+
+        for (uint8_t i = 0; i < options->timeout_classes->classes_number; i++)
+        {
+            printf(" %s=%d", options->timeout_classes->classes[i].name,
+                   options->timeout_classes->classes[i].timeout_seconds);
+        }
+
+        printf("\n");
+    }
+
+    if (options->biflow_set)
+    {
+        printf("biflow: yes\n");
+    }
+
+    if (options->wire_format_set)
+    {
+        printf("cache: NetFlow v5 wire format\n");
+    }
+
+    if (options->export_format->format == EXPORT_IPFIX)
+    {
+        printf("export: IPFIX, MTU %d\n", options->export_mtu->mtu);
+    }
+
+    if (options->aggregation->is_user_set)
+    {
+        printf("aggregation: %s\n", aggregation_scheme_name(options->aggregation->scheme));
+    }
+
+    if (options->tcp_state_timeouts->is_user_set)
+    {
+        printf("tcp_state_timers: half-open %d s, fin-wait %d s\n",
+               options->tcp_state_timeouts->half_open_seconds,
+               options->tcp_state_timeouts->fin_wait_seconds);
+    }
+
+    if (options->new_flow_admission->is_user_set)
+    {
+        printf("admission: %d packets", options->new_flow_admission->packets);
+
+        if (options->new_flow_admission->octets != 0)
+        {
+            printf(" or %d bytes", options->new_flow_admission->octets);
+        }
+
+        printf("\n");
+    }
+
     status = allocate_recording_system(&netflow_records);
 
     if (status != NO_ERROR)
@@ -217,7 +580,11 @@ int main (int argc, char* argv[])
         return EXIT_FAILURE;
     }
 
-    status = allocate_sending_system(&sending_system);
+    status = allocate_flow_cache(&(netflow_records->cache),
+                                 options->cached_entries_number->entries_number,
+                                 cache_select_layout(options),
+                                 options->flow_arena_set,
+                                 options->lock_memory_set);
 
     if (status != NO_ERROR)
     {
@@ -227,17 +594,247 @@ int main (int argc, char* argv[])
         return EXIT_FAILURE;
     }
 
-    status = connect_socket(sending_system->socket,
-                            options->netflow_collector_source->source);
+    if (options->flow_hash_key->is_user_set)
+    {
+        cache_set_hash_key(netflow_records->cache, options->flow_hash_key->key);
+    }
+
+    if (options->new_flow_admission->is_user_set)
+    {
+        status = allocate_flow_admission(&(netflow_records->admission));
+
+        if (status != NO_ERROR)
+        {
+            print_error(MEMORY_HANDLING_ERROR, argv[0]);
+            flow_epilogue(netflow_records, sending_system, options);
+
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (options->routing_table_source->is_user_set)
+    {
+        status = allocate_routing_table(&(netflow_records->routing));
+
+        if (status != NO_ERROR)
+        {
+            print_error(MEMORY_HANDLING_ERROR, argv[0]);
+            flow_epilogue(netflow_records, sending_system, options);
+
+            return EXIT_FAILURE;
+        }
+
+        gettimeofday(&load_start, NULL);
+
+        status = routing_load(netflow_records->routing,
+                              options->routing_table_source->file_name);
+
+        if (status != NO_ERROR)
+        {
+            print_error(status, argv[0]);
+            flow_epilogue(netflow_records, sending_system, options);
+
+            return EXIT_FAILURE;
+        }
+
+        gettimeofday(&load_end, NULL);
+
+        // Print info about the routing table.
+        printf("routing_table: %u prefixes, %.1f MiB, loaded in %u ms\n",
+               netflow_records->routing->routes_number - 1,
+               (double) routing_memory_size(netflow_records->routing) / (1024 * 1024),
+               get_timeval_ms(&load_end, &load_start));
+    }
+
+    // Print info about the flow-cache memory.
+    printf("cache_memory: up to %.1f MiB (%zu B per flow)\n",
+           (double) cache_memory_size(options->cached_entries_number->entries_number,
+                                      netflow_records->cache->layout) /
+           (1024 * 1024),
+           netflow_records->cache->entry_size +
+           sizeof(uint32_t) * (netflow_records->cache->max_buckets) /
+           options->cached_entries_number->entries_number);
+
+    if (options->flow_arena_set)
+    {
+        // Print info about the flow-cache arena.
+        printf("cache_arena: %s%s\n",
+               netflow_records->cache->huge_pages ? "huge pages" : "transparent huge pages",
+               options->lock_memory_set ? ", locked" : "");
+    }
+
+    status = allocate_sending_system(&sending_system);
 
     if (status != NO_ERROR)
     {
-        print_error(status, argv[0]);
+        print_error(MEMORY_HANDLING_ERROR, argv[0]);
         flow_epilogue(netflow_records, sending_system, options);
 
         return EXIT_FAILURE;
     }
 
+    if (options->output_file_target->is_user_set)
+    {
+        status = allocate_flow_sink(&(sending_system->sink));
+
+        if (status != NO_ERROR)
+        {
+            print_error(MEMORY_HANDLING_ERROR, argv[0]);
+            flow_epilogue(netflow_records, sending_system, options);
+
+            return EXIT_FAILURE;
+        }
+
+        status = sink_open(sending_system->sink, options->output_file_target->file_name);
+
+        if (status != NO_ERROR)
+        {
+            print_error(status, argv[0]);
+            flow_epilogue(netflow_records, sending_system, options);
+
+            return EXIT_FAILURE;
+        }
+
+        // Print info about the output file.
+        printf("output_file: %s\n", options->output_file_target->file_name);
+    }
+
+    if (options->arrow_file_target->is_user_set)
+    {
+        status = allocate_arrow_writer(&(sending_system->arrow),
+                                       options->arrow_batch_size->rows);
+
+        if (status != NO_ERROR)
+        {
+            print_error(MEMORY_HANDLING_ERROR, argv[0]);
+            flow_epilogue(netflow_records, sending_system, options);
+
+            return EXIT_FAILURE;
+        }
+
+        status = arrow_open(sending_system->arrow, options->arrow_file_target->file_name);
+
+        if (status != NO_ERROR)
+        {
+            print_error(status, argv[0]);
+            flow_epilogue(netflow_records, sending_system, options);
+
+            return EXIT_FAILURE;
+        }
+
+        // Print info about the Arrow file.
+        printf("arrow_file: %s (%u rows per batch, %.1f MiB of columns)\n",
+               options->arrow_file_target->file_name,
+               options->arrow_batch_size->rows,
+               (double) arrow_row_size() * options->arrow_batch_size->rows / (1024 * 1024));
+    }
+
+    if (options->flow_store_target->is_user_set)
+    {
+        status = allocate_flow_store(&(sending_system->store));
+
+        if (status != NO_ERROR)
+        {
+            print_error(MEMORY_HANDLING_ERROR, argv[0]);
+            flow_epilogue(netflow_records, sending_system, options);
+
+            return EXIT_FAILURE;
+        }
+
+        status = store_open(sending_system->store,
+                            options->flow_store_target->directory,
+                            options->store_compression_set);
+
+        if (status != NO_ERROR)
+        {
+            print_error(status, argv[0]);
+            flow_epilogue(netflow_records, sending_system, options);
+
+            return EXIT_FAILURE;
+        }
+
+        // Print info about the flow store.
+        printf("flow_store: %s (segment %u%s)\n",
+               options->flow_store_target->directory,
+               sending_system->store->segment_number,
+               options->store_compression_set ? ", compressed" : "");
+    }
+
+    if (options->packet_filter->is_user_set)
+    {
+        printf("filter: %s\n", options->packet_filter->expression);
+    }
+
+    if (options->restore_source->is_user_set)
+    {
+        printf("restore: %s\n", options->restore_source->file_name);
+    }
+
+    if (options->time_window->is_user_set)
+    {
+        printf("time_window: %lu.%03lu - ",
+               options->time_window->from_ms / 1000, options->time_window->from_ms % 1000);
+
+        if (options->time_window->to_set)
+        {
+            printf("%lu.%03lu", options->time_window->to_ms / 1000,
+                   options->time_window->to_ms % 1000);
+        }
+        else
+        {
+            printf("end");
+        }
+
+        printf(" (warm-up %u s)\n", options->time_window->warmup_seconds);
+    }
+
+    // The key itself is not printed, the collisions could be computed by it.
+    if (options->flow_hash_key->is_user_set)
+    {
+        printf("hash_key: set by user\n");
+    }
+
+    if (options->checkpoint_target->is_user_set)
+    {
+        printf("checkpoint: %s\n", options->checkpoint_target->file_name);
+    }
+
+    // With the output files, the collector is used only if it is set.
+    if ((!options->output_file_target->is_user_set &&
+         !options->arrow_file_target->is_user_set &&
+         !options->flow_store_target->is_user_set) ||
+        options->netflow_collector_source->is_user_set)
+    {
+        if (options->export_format->format == EXPORT_IPFIX)
+        {
+            status = allocate_ipfix_exporter(&(sending_system->ipfix),
+                                             options->export_mtu->mtu);
+
+            if (status != NO_ERROR)
+            {
+                print_error(MEMORY_HANDLING_ERROR, argv[0]);
+                flow_epilogue(netflow_records, sending_system, options);
+
+                return EXIT_FAILURE;
+            }
+
+            ipfix_init(sending_system->ipfix);
+        }
+
+        status = connect_socket(sending_system->socket,
+                                options->netflow_collector_source->source);
+
+        if (status != NO_ERROR)
+        {
+            print_error(status, argv[0]);
+            flow_epilogue(netflow_records, sending_system, options);
+
+            return EXIT_FAILURE;
+        }
+
+        sending_system->collector_connected = true;
+    }
+
     status = run_exporter(netflow_records, sending_system, options);
 
     if (status != NO_ERROR)
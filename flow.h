@@ -35,6 +35,15 @@ uint8_t connect_socket (int* sock, char* source);
  */
 void disconnect_socket (const int* sock);
 
+/*
+ * Function for printing the average residency of the exported flows
+ * in the flow-cache for every timeout class.
+ *
+ * @param cache   Pointer to the flow cache.
+ * @param options Pointer to options storage.
+ */
+void print_class_residency (struct flow_cache* cache, options_t options);
+
 /*
  * Function to handle needed operations before ending of flow program.
  * The needed operations is:
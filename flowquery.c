@@ -0,0 +1,329 @@
+/**********************************************************/
+/*                                                        */
+/* File: flowquery.c                                      */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Query tool of the flow store              */
+/*                                                        */
+/**********************************************************/
+
+#include "flowquery.h"
+
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "error.h"
+#include "timeindex.h"
+
+#define QUERY_PATH_LENGTH (4096)
+#define QUERY_TIME_LENGTH (32)
+
+/*
+ * Function for printing help.
+ *
+ * @param program_name Name of program.
+ */
+void print_query_help (char* program_name)
+{
+    fprintf(stderr,
+            "Usage: %s -d <store> [-f <from>] [-t <to>] [-a <address>] [-p <port>]\n"
+            "\n"
+            "  -d <store>      The directory of the flow store (written by flow -S).\n"
+            "  -f <from>       Print the flows which end at or after the time.\n"
+            "  -t <to>         Print the flows which start at or before the time.\n"
+            "  -a <address>    Print the flows from or to the IPv4 address.\n"
+            "  -p <port>       Print the flows from or to the port.\n"
+            "\n"
+            "The time is \"YYYY-MM-DD HH:MM:SS[.mmm]\" in UTC or seconds since the epoch.\n",
+            program_name);
+}
+
+/*
+ * Function for checking whether a record matches the filter.
+ *
+ * @param filter Pointer to the filter.
+ * @param record The record.
+ * @return       True if the record matches.
+ */
+bool record_matches (query_filter_t filter, sink_record_t record)
+{
+    if (record->last_ms < filter->from_ms || record->first_ms > filter->to_ms)
+    {
+        return false;
+    }
+
+    if (filter->address_set &&
+        record->src_addr != filter->addr && record->dst_addr != filter->addr)
+    {
+        return false;
+    }
+
+    if (filter->port_set &&
+        record->src_port != filter->port && record->dst_port != filter->port)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * The helper function for formatting a time.
+ *
+ * @param time   The milliseconds since the epoch.
+ * @param output Output parameter for QUERY_TIME_LENGTH characters.
+ */
+static void format_time (uint64_t time, char* output)
+{
+    time_t seconds = (time_t) (time / 1000);
+    struct tm date;
+    size_t length;
+
+    gmtime_r(&seconds, &date);
+    length = strftime(output, QUERY_TIME_LENGTH, "%Y-%m-%d %H:%M:%S", &date);
+    snprintf(output + length, QUERY_TIME_LENGTH - length, ".%03u", (unsigned int) (time % 1000));
+}
+
+/*
+ * Function for printing a record as a line of text.
+ *
+ * @param record The record.
+ */
+void print_record (sink_record_t record)
+{
+    char first[QUERY_TIME_LENGTH];
+    char last[QUERY_TIME_LENGTH];
+    char src_addr[INET_ADDRSTRLEN];
+    char dst_addr[INET_ADDRSTRLEN];
+
+    format_time(record->first_ms, first);
+    format_time(record->last_ms, last);
+    inet_ntop(AF_INET, &(record->src_addr), src_addr, sizeof(src_addr));
+    inet_ntop(AF_INET, &(record->dst_addr), dst_addr, sizeof(dst_addr));
+
+    printf("%s  %s  %3u  %15s:%-5u -> %15s:%-5u  %8lu  %10lu  0x%02x\n",
+           first, last, record->prot,
+           src_addr, record->src_port,
+           dst_addr, record->dst_port,
+           record->packets, record->octets, record->tcp_flags);
+}
+
+/*
+ * Function for querying a segment. Only the blocks whose index entries
+ * may match the filter are read.
+ *
+ * @param segment    Pointer to the mapped segment.
+ * @param filter     Pointer to the filter.
+ * @param records    Storage for STORE_BLOCK_RECORDS records.
+ * @param statistics Pointer to the statistics of the query.
+ */
+void query_segment (store_segment_t segment,
+                    query_filter_t filter,
+                    sink_record_t records,
+                    query_statistics_t statistics)
+{
+    store_index_entry_t entry;
+    uint32_t records_number;
+
+    statistics->blocks_number += segment->header->blocks_number;
+
+    if (segment->header->records_number == 0 ||
+        segment->header->last_ms < filter->from_ms ||
+        segment->header->first_ms > filter->to_ms)
+    {
+        return;
+    }
+
+    for (uint32_t i = 0; i < segment->header->blocks_number; i++)
+    {
+        entry = &(segment->index[i]);
+
+        if (entry->last_ms < filter->from_ms || entry->first_ms > filter->to_ms ||
+            (filter->address_set && !store_block_has_address(entry, filter->addr)) ||
+            (filter->port_set && !store_block_has_port(entry, filter->port)))
+        {
+            continue;
+        }
+
+        statistics->read_blocks++;
+        records_number = store_read_block(segment, i, records);
+
+        if (records_number == 0)
+        {
+            statistics->corrupted_blocks++;
+            continue;
+        }
+
+        for (uint32_t j = 0; j < records_number; j++)
+        {
+            if (record_matches(filter, &(records[j])))
+            {
+                print_record(&(records[j]));
+                statistics->matched_records++;
+            }
+        }
+    }
+}
+
+/*
+ * The helper function for selecting the segment files.
+ *
+ * @param entry The directory entry.
+ * @return      Nonzero if the entry is a segment file.
+ */
+static int is_segment (const struct dirent* entry)
+{
+    unsigned int number;
+
+    return sscanf(entry->d_name, "flows-%u.seg", &number) == 1;
+}
+
+int main (int argc, char* argv[])
+{
+    struct query_filter filter = { 0, UINT64_MAX, false, 0, false, 0 };
+    struct query_statistics statistics;
+    struct store_segment segment;
+    struct dirent** names;
+    sink_record_t records;
+    char* directory = NULL;
+    char path[QUERY_PATH_LENGTH];
+    struct in_addr addr;
+    char* end;
+    unsigned long port;
+    int names_number;
+    int option;
+
+    opterr = 0;
+
+    while ((option = getopt(argc, argv, ":hd:f:t:a:p:")) != -1)
+    {
+        switch (option)
+        {
+            case 'h':
+                print_query_help(argv[0]);
+                return EXIT_SUCCESS;
+            case 'd':
+                directory = optarg;
+
+                break;
+            case 'f':
+                if (!parse_time_ms(optarg, &(filter.from_ms)))
+                {
+                    fprintf(stderr, "Error: invalid time %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+
+                break;
+            case 't':
+                if (!parse_time_ms(optarg, &(filter.to_ms)))
+                {
+                    fprintf(stderr, "Error: invalid time %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+
+                break;
+            case 'a':
+                if (inet_pton(AF_INET, optarg, &addr) != 1)
+                {
+                    fprintf(stderr, "Error: invalid address %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+
+                filter.address_set = true;
+                filter.addr = addr.s_addr;
+
+                break;
+            case 'p':
+                port = strtoul(optarg, &end, 10);
+
+                if (*optarg == '\0' || *end != '\0' || port > UINT16_MAX)
+                {
+                    fprintf(stderr, "Error: invalid port %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+
+                filter.port_set = true;
+                filter.port = (uint16_t) port;
+
+                break;
+            default:
+                print_query_help(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (directory == NULL)
+    {
+        print_query_help(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // The segment names are numbered, so the order is the writing order.
+    names_number = scandir(directory, &names, is_segment, alphasort);
+
+    if (names_number < 0)
+    {
+        fprintf(stderr, "Error: cannot read the flow store %s\n", directory);
+        return EXIT_FAILURE;
+    }
+
+    records = (sink_record_t) malloc(STORE_BLOCK_RECORDS * sizeof(struct sink_record));
+
+    if (records == NULL)
+    {
+        fprintf(stderr, "Error: error while handling memory\n");
+
+        for (int i = 0; i < names_number; i++)
+        {
+            free(names[i]);
+        }
+
+        free(names);
+
+        return EXIT_FAILURE;
+    }
+
+    memset(&statistics, 0, sizeof(statistics));
+
+    for (int i = 0; i < names_number; i++)
+    {
+        snprintf(path, sizeof(path), "%s/%s", directory, names[i]->d_name);
+
+        if (store_segment_open(&segment, path) == NO_ERROR)
+        {
+            query_segment(&segment, &filter, records, &statistics);
+            store_segment_close(&segment);
+
+            statistics.segments_number++;
+        }
+        else
+        {
+            fprintf(stderr, "Warning: skipping the incomplete segment %s\n", path);
+        }
+
+        free(names[i]);
+    }
+
+    free(names);
+    free(records);
+
+    fprintf(stderr, "%lu flows, %u of %u blocks read in %u segments\n",
+            statistics.matched_records,
+            statistics.read_blocks,
+            statistics.blocks_number,
+            statistics.segments_number);
+
+    if (statistics.corrupted_blocks > 0)
+    {
+        fprintf(stderr, "Warning: %u corrupted blocks\n", statistics.corrupted_blocks);
+    }
+
+    return EXIT_SUCCESS;
+}
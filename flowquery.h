@@ -0,0 +1,88 @@
+/**********************************************************/
+/*                                                        */
+/* File: flowquery.h                                      */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Header file for the flow store query tool */
+/*                                                        */
+/**********************************************************/
+
+#ifndef FLOWQUERY_H
+#define FLOWQUERY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sink.h"
+#include "store.h"
+
+typedef struct query_filter* query_filter_t;
+typedef struct query_statistics* query_statistics_t;
+
+/*
+ * Structure to store the filter of the query. A record matches if its
+ * time range overlaps the queried one and one of its addresses and ports
+ * is the queried one.
+ */
+struct query_filter
+{
+    uint64_t from_ms;
+    uint64_t to_ms;
+    bool address_set;
+    uint32_t addr;   // In the network byte order.
+    bool port_set;
+    uint16_t port;
+};
+
+/*
+ * Structure to store the statistics of the query.
+ */
+struct query_statistics
+{
+    uint64_t matched_records;
+    uint32_t segments_number;
+    uint32_t blocks_number;
+    uint32_t read_blocks;
+    uint32_t corrupted_blocks;
+};
+
+/*
+ * Function for printing help.
+ *
+ * @param program_name Name of program.
+ */
+void print_query_help (char* program_name);
+
+/*
+ * Function for checking whether a record matches the filter.
+ *
+ * @param filter Pointer to the filter.
+ * @param record The record.
+ * @return       True if the record matches.
+ */
+bool record_matches (query_filter_t filter, sink_record_t record);
+
+/*
+ * Function for printing a record as a line of text.
+ *
+ * @param record The record.
+ */
+void print_record (sink_record_t record);
+
+/*
+ * Function for querying a segment. Only the blocks whose index entries
+ * may match the filter are read.
+ *
+ * @param segment    Pointer to the mapped segment.
+ * @param filter     Pointer to the filter.
+ * @param records    Storage for STORE_BLOCK_RECORDS records.
+ * @param statistics Pointer to the statistics of the query.
+ */
+void query_segment (store_segment_t segment,
+                    query_filter_t filter,
+                    sink_record_t records,
+                    query_statistics_t statistics);
+
+#endif // FLOWQUERY_H
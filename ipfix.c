@@ -0,0 +1,363 @@
+/**********************************************************/
+/*                                                        */
+/* File: ipfix.c                                          */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: IPFIX export of the flows                 */
+/*                                                        */
+/**********************************************************/
+
+#include "ipfix.h"
+
+#include <arpa/inet.h>
+#include <endian.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include "error.h"
+#include "util.h"
+
+/*
+ * The template of the data records, the pairs of the information element
+ * id and the field length. The order is the order of the fields
+ * in the records.
+ */
+static const uint16_t ipfix_template[IPFIX_FIELDS_NUMBER][2] =
+{
+    { 8, 4 },   // sourceIPv4Address
+    { 12, 4 },  // destinationIPv4Address
+    { 15, 4 },  // ipNextHopIPv4Address
+    { 2, 8 },   // packetDeltaCount
+    { 1, 8 },   // octetDeltaCount
+    { 152, 8 }, // flowStartMilliseconds
+    { 153, 8 }, // flowEndMilliseconds
+    { 7, 2 },   // sourceTransportPort
+    { 11, 2 },  // destinationTransportPort
+    { 6, 1 },   // tcpControlBits
+    { 4, 1 },   // protocolIdentifier
+    { 5, 1 },   // ipClassOfService
+    { 9, 1 },   // sourceIPv4PrefixLength
+    { 13, 1 },  // destinationIPv4PrefixLength
+    { 16, 4 },  // bgpSourceAsNumber
+    { 17, 4 }   // bgpDestinationAsNumber
+};
+
+/*
+ * Function for parsing the name of an export format.
+ *
+ * @param name The name of the format ("v5" or "ipfix").
+ * @return     The format or EXPORT_FORMATS_NUMBER if the name is unknown.
+ */
+uint8_t export_parse_format (const char* name)
+{
+    if (strcmp(name, "v5") == 0)
+    {
+        return EXPORT_NETFLOW_V5;
+    }
+
+    if (strcmp(name, "ipfix") == 0)
+    {
+        return EXPORT_IPFIX;
+    }
+
+    return EXPORT_FORMATS_NUMBER;
+}
+
+/*
+ * Function for the IPFIX exporter initialization.
+ *
+ * @param exporter Pointer to the exporter.
+ */
+void ipfix_init (ipfix_exporter_t exporter)
+{
+    exporter->message_length = 0;
+    exporter->data_set_offset = 0;
+    exporter->pending_records = 0;
+    exporter->sequence_number = 0;
+    exporter->messages_since_template = 0;
+    exporter->template_sent_sec = 0;
+    exporter->template_sent = false;
+    exporter->templates_number = 0;
+}
+
+/*
+ * The helper functions for writing the fields in the network byte order.
+ * The fields of the records are not aligned.
+ */
+static uint8_t* put_8 (uint8_t* position, uint8_t value)
+{
+    *position = value;
+
+    return position + sizeof(value);
+}
+
+static uint8_t* put_16 (uint8_t* position, uint16_t value)
+{
+    value = htons(value);
+    memcpy(position, &value, sizeof(value));
+
+    return position + sizeof(value);
+}
+
+static uint8_t* put_32 (uint8_t* position, uint32_t value)
+{
+    value = htonl(value);
+    memcpy(position, &value, sizeof(value));
+
+    return position + sizeof(value);
+}
+
+static uint8_t* put_64 (uint8_t* position, uint64_t value)
+{
+    value = htobe64(value);
+    memcpy(position, &value, sizeof(value));
+
+    return position + sizeof(value);
+}
+
+/*
+ * The helper function for converting a time stamp into the milliseconds
+ * since the epoch.
+ *
+ * @param time The time stamp.
+ * @return     The milliseconds since the epoch.
+ */
+static uint64_t epoch_ms (const struct timeval* time)
+{
+    return (uint64_t) time->tv_sec * 1000 + (uint64_t) time->tv_usec / 1000;
+}
+
+/*
+ * The helper function for opening a new message. The template set
+ * is included for the first message and for the refresh.
+ *
+ * @param exporter Pointer to the exporter.
+ * @param now      The current packet time.
+ */
+static void ipfix_open_message (ipfix_exporter_t exporter, const struct timeval* now)
+{
+    uint8_t* position = exporter->message + IPFIX_HEADER_SIZE;
+
+    if (!exporter->template_sent ||
+        exporter->messages_since_template >= IPFIX_REFRESH_MESSAGES ||
+        now->tv_sec - exporter->template_sent_sec >= IPFIX_REFRESH_SECONDS)
+    {
+        position = put_16(position, IPFIX_TEMPLATE_SET_ID);
+        position = put_16(position, IPFIX_TEMPLATE_SIZE);
+        position = put_16(position, IPFIX_TEMPLATE_ID);
+        position = put_16(position, IPFIX_FIELDS_NUMBER);
+
+        for (uint8_t i = 0; i < IPFIX_FIELDS_NUMBER; i++)
+        {
+            position = put_16(position, ipfix_template[i][0]);
+            position = put_16(position, ipfix_template[i][1]);
+        }
+
+        exporter->template_sent = true;
+        exporter->template_sent_sec = now->tv_sec;
+        exporter->messages_since_template = 0;
+        exporter->templates_number++;
+    }
+
+    // The length of the data set is set when the message is sent.
+    exporter->data_set_offset = (size_t) (position - exporter->message);
+    exporter->message_length = exporter->data_set_offset + IPFIX_SET_HEADER_SIZE;
+    exporter->pending_records = 0;
+
+    memcpy(&(exporter->pending_since), now, sizeof(exporter->pending_since));
+}
+
+/*
+ * The helper function for sending the open message.
+ *
+ * @param netflow_records Pointer to the netflow recording system.
+ * @param sending_system  Pointer to the sending system.
+ * @return                Status of function processing.
+ */
+static uint8_t ipfix_send_message (netflow_recording_system_t netflow_records,
+                                   netflow_sending_system_t sending_system)
+{
+    ipfix_exporter_t exporter = sending_system->ipfix;
+    uint8_t* position = exporter->message;
+    ssize_t return_code;
+
+    position = put_16(position, IPFIX_VERSION);
+    position = put_16(position, (uint16_t) exporter->message_length);
+    position = put_32(position, (uint32_t) netflow_records->last_packet_time->tv_sec);
+    position = put_32(position, exporter->sequence_number);
+    put_32(position, 0); // The observation domain.
+
+    position = exporter->message + exporter->data_set_offset;
+    position = put_16(position, IPFIX_TEMPLATE_ID);
+    put_16(position, (uint16_t) (exporter->message_length - exporter->data_set_offset));
+
+    return_code = send(*(sending_system->socket), exporter->message, exporter->message_length, 0);
+
+    if (return_code == -1 || (size_t)return_code != exporter->message_length)
+    {
+        // Send failed.
+        return PACKET_SENDING_ERROR;
+    }
+
+    exporter->sequence_number += exporter->pending_records;
+    exporter->messages_since_template++;
+
+    // Update statistics.
+    *(netflow_records->flows_statistics) += (uint64_t)exporter->pending_records;
+    *(netflow_records->sent_packets_statistics) += 1;
+
+    exporter->message_length = 0;
+    exporter->pending_records = 0;
+
+    return NO_ERROR;
+}
+
+/*
+ * The helper function for appending a record of one direction of a flow.
+ *
+ * @param exporter Pointer to the exporter.
+ * @param flow     The exported flow.
+ * @param reverse  The reverse direction of the biflow is appended.
+ */
+static void ipfix_put_record (ipfix_exporter_t exporter, flow_node_t flow, bool reverse)
+{
+    uint8_t* position = exporter->message + exporter->message_length;
+    flow_reverse_t reverse_flow = reverse ? flow_reverse_direction(flow) : NULL;
+
+    if (reverse_flow != NULL)
+    {
+        memcpy(position, &(flow->dst_addr), sizeof(flow->dst_addr));
+        memcpy(position + 4, &(flow->src_addr), sizeof(flow->src_addr));
+        memcpy(position + 8, &(reverse_flow->nexthop), sizeof(reverse_flow->nexthop));
+        position = put_64(position + 12, reverse_flow->packets);
+        position = put_64(position, reverse_flow->octets);
+        position = put_64(position, epoch_ms(&(reverse_flow->first)));
+        position = put_64(position, epoch_ms(&(reverse_flow->last)));
+        position = put_16(position, flow->dst_port);
+        position = put_16(position, flow->src_port);
+        position = put_8(position, reverse_flow->tcp_flags);
+        position = put_8(position, flow->prot);
+        position = put_8(position, flow->tos);
+        position = put_8(position, flow->dst_mask);
+        position = put_8(position, flow->src_mask);
+        position = put_32(position, flow->dst_as);
+        put_32(position, flow->src_as);
+    }
+    else
+    {
+        memcpy(position, &(flow->src_addr), sizeof(flow->src_addr));
+        memcpy(position + 4, &(flow->dst_addr), sizeof(flow->dst_addr));
+        memcpy(position + 8, &(flow->nexthop), sizeof(flow->nexthop));
+        position = put_64(position + 12, flow->packets);
+        position = put_64(position, flow->octets);
+        position = put_64(position, epoch_ms(&(flow->first)));
+        position = put_64(position, epoch_ms(&(flow->last)));
+        position = put_16(position, flow->src_port);
+        position = put_16(position, flow->dst_port);
+        position = put_8(position, flow->tcp_flags);
+        position = put_8(position, flow->prot);
+        position = put_8(position, flow->tos);
+        position = put_8(position, flow->src_mask);
+        position = put_8(position, flow->dst_mask);
+        position = put_32(position, flow->src_as);
+        put_32(position, flow->dst_as);
+    }
+
+    exporter->message_length += IPFIX_RECORD_SIZE;
+    exporter->pending_records++;
+}
+
+/*
+ * Function for appending flows to the IPFIX message. The full messages
+ * are sent, the rest waits for the next flows or the flush.
+ *
+ * @param netflow_records Pointer to the netflow recording system.
+ * @param sending_system  Pointer to the sending system.
+ * @param flows           An array of flows to export.
+ * @param flows_number    The number of flows in the array of flows to export.
+ * @return                Status of function processing.
+ */
+uint8_t ipfix_export_flows (netflow_recording_system_t netflow_records,
+                            netflow_sending_system_t sending_system,
+                            flow_node_t* flows,
+                            const uint16_t flows_number)
+{
+    uint8_t status = NO_ERROR;
+    ipfix_exporter_t exporter = sending_system->ipfix;
+
+    for (uint16_t i = 0; i < flows_number && status == NO_ERROR; i++)
+    {
+        // The initiator direction, then the reverse direction of a biflow.
+        for (uint8_t direction = 0; direction < 2 && status == NO_ERROR; direction++)
+        {
+            if (direction == 1 && flow_reverse_direction(flows[i]) == NULL)
+            {
+                break;
+            }
+
+            if (exporter->message_length > 0 &&
+                exporter->message_length + IPFIX_RECORD_SIZE > exporter->message_size)
+            {
+                status = ipfix_send_message(netflow_records, sending_system);
+
+                // The full message was not sent, it has no room for the record.
+                if (status != NO_ERROR)
+                {
+                    break;
+                }
+            }
+
+            if (exporter->message_length == 0)
+            {
+                ipfix_open_message(exporter, netflow_records->last_packet_time);
+            }
+
+            ipfix_put_record(exporter, flows[i], direction == 1);
+        }
+    }
+
+    if (status != NO_ERROR)
+    {
+        return status;
+    }
+
+    // Update the cached flows number.
+    *(netflow_records->cached_flows_number) -= (uint64_t)flows_number;
+
+    return NO_ERROR;
+}
+
+/*
+ * Function for sending the open IPFIX message.
+ *
+ * @param netflow_records Pointer to the netflow recording system.
+ * @param sending_system  Pointer to the sending system.
+ * @param force           The message is sent even if its records
+ *                        may still wait.
+ * @return                Status of function processing.
+ */
+uint8_t ipfix_flush (netflow_recording_system_t netflow_records,
+                     netflow_sending_system_t sending_system,
+                     bool force)
+{
+    ipfix_exporter_t exporter = sending_system->ipfix;
+
+    if (exporter->pending_records == 0)
+    {
+        return NO_ERROR;
+    }
+
+    if (!force &&
+        get_timeval_ms(netflow_records->last_packet_time,
+                       &(exporter->pending_since)) < IPFIX_FLUSH_MS)
+    {
+        return NO_ERROR;
+    }
+
+    return ipfix_send_message(netflow_records, sending_system);
+}
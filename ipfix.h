@@ -0,0 +1,123 @@
+/**********************************************************/
+/*                                                        */
+/* File: ipfix.h                                          */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Header file for the IPFIX export          */
+/*                                                        */
+/**********************************************************/
+
+#ifndef FLOW_IPFIX_H
+#define FLOW_IPFIX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+#include "netflow_v5.h"
+
+#define IPFIX_VERSION          (10)
+#define IPFIX_TEMPLATE_SET_ID  (2)
+#define IPFIX_TEMPLATE_ID      (256) // The data set id is the template id.
+#define IPFIX_HEADER_SIZE      (16)
+#define IPFIX_SET_HEADER_SIZE  (4)
+#define IPFIX_FIELDS_NUMBER    (16)
+#define IPFIX_TEMPLATE_SIZE    (IPFIX_SET_HEADER_SIZE + 4 + IPFIX_FIELDS_NUMBER * 4)
+#define IPFIX_RECORD_SIZE      (61)
+
+#define IPFIX_UDP_OVERHEAD     (28)   // The IPv4 and UDP headers.
+#define IPFIX_REFRESH_MESSAGES (1024) // Messages between the templates.
+#define IPFIX_REFRESH_SECONDS  (60)   // Seconds between the templates.
+#define IPFIX_FLUSH_MS         (1000) // The longest delay of a record.
+
+/*
+ * Enumeration of the export formats.
+ */
+enum export_format
+{
+    EXPORT_NETFLOW_V5,
+    EXPORT_IPFIX,
+    EXPORT_FORMATS_NUMBER
+};
+
+/*
+ * Enumeration of the limits of the MTU.
+ */
+enum mtu_limits
+{
+    MTU_MIN = 576,
+    MTU_DEFAULT = 1500,
+    MTU_MAX = 9216
+};
+
+typedef struct ipfix_exporter* ipfix_exporter_t;
+
+/*
+ * Structure to store the IPFIX exporter. The records are appended
+ * to a message as large as the MTU allows and the message is sent when
+ * it is full or when its first record waits IPFIX_FLUSH_MS of the packet
+ * time. Over UDP the template is repeated every IPFIX_REFRESH_MESSAGES
+ * messages and every IPFIX_REFRESH_SECONDS seconds.
+ */
+struct ipfix_exporter
+{
+    uint8_t* message;
+    size_t message_size;          // The largest message in bytes.
+    size_t message_length;        // The used bytes, 0 if no message is open.
+    size_t data_set_offset;       // The offset of the data set header.
+    uint16_t pending_records;     // The records in the open message.
+    struct timeval pending_since; // The packet time of the first record.
+    uint32_t sequence_number;     // The data records sent before the message.
+    uint32_t messages_since_template;
+    time_t template_sent_sec;
+    bool template_sent;
+    uint64_t templates_number;
+};
+
+/*
+ * Function for parsing the name of an export format.
+ *
+ * @param name The name of the format ("v5" or "ipfix").
+ * @return     The format or EXPORT_FORMATS_NUMBER if the name is unknown.
+ */
+uint8_t export_parse_format (const char* name);
+
+/*
+ * Function for the IPFIX exporter initialization.
+ *
+ * @param exporter Pointer to the exporter.
+ */
+void ipfix_init (ipfix_exporter_t exporter);
+
+/*
+ * Function for appending flows to the IPFIX message. The full messages
+ * are sent, the rest waits for the next flows or the flush.
+ *
+ * @param netflow_records Pointer to the netflow recording system.
+ * @param sending_system  Pointer to the sending system.
+ * @param flows           An array of flows to export.
+ * @param flows_number    The number of flows in the array of flows to export.
+ * @return                Status of function processing.
+ */
+uint8_t ipfix_export_flows (netflow_recording_system_t netflow_records,
+                            netflow_sending_system_t sending_system,
+                            flow_node_t* flows,
+                            const uint16_t flows_number);
+
+/*
+ * Function for sending the open IPFIX message.
+ *
+ * @param netflow_records Pointer to the netflow recording system.
+ * @param sending_system  Pointer to the sending system.
+ * @param force           The message is sent even if its records
+ *                        may still wait.
+ * @return                Status of function processing.
+ */
+uint8_t ipfix_flush (netflow_recording_system_t netflow_records,
+                     netflow_sending_system_t sending_system,
+                     bool force);
+
+#endif // FLOW_IPFIX_H
@@ -0,0 +1,276 @@
+/**********************************************************/
+/*                                                        */
+/* File: linktype.c                                       */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Link layer parsers                        */
+/*                                                        */
+/**********************************************************/
+
+#include "linktype.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define SIZE_ETHERNET    (14) // Offset of Ethernet header to L3 protocol.
+#define SIZE_SLL         (16) // Linux cooked capture header.
+#define SIZE_SLL2        (20) // Linux cooked capture v2 header.
+#define SIZE_NULL        (4)  // BSD loopback header.
+#define SIZE_VLAN_TAG    (4)
+#define SIZE_MPLS_LABEL  (4)
+#define SIZE_IPV4_MIN    (20)
+
+#define ETHERTYPE_OFFSET      (12) // The EtherType of the Ethernet header.
+#define SLL_PROTOCOL_OFFSET   (14) // The EtherType of the cooked capture header.
+#define SLL2_PROTOCOL_OFFSET  (0)  // The EtherType of the cooked capture v2 header.
+
+#define LINK_ETHERTYPE_IPV4      (0x0800)
+#define LINK_ETHERTYPE_VLAN      (0x8100) // 802.1Q
+#define LINK_ETHERTYPE_QINQ      (0x88a8) // 802.1ad
+#define LINK_ETHERTYPE_QINQ_OLD  (0x9100) // The pre-standard QinQ.
+#define LINK_ETHERTYPE_MPLS      (0x8847)
+#define LINK_ETHERTYPE_MPLS_MC   (0x8848)
+
+#define MPLS_BOTTOM_OF_STACK (0x01) // In the third byte of a label.
+#define NULL_FAMILY_INET     (2)    // AF_INET of the BSD loopback header.
+
+/*
+ * The helper function for reading a 16-bit field in network byte order.
+ *
+ * @param field Pointer to the field.
+ * @return      The value in host byte order.
+ */
+static inline uint16_t read_uint16 (const u_char* field)
+{
+    return (uint16_t) (field[0] << 8 | field[1]);
+}
+
+/*
+ * The helper function for checking the IPv4 header at an offset.
+ *
+ * @param packet     Packet body data.
+ * @param length     The captured length of the packet.
+ * @param offset     The offset of the header.
+ * @param statistics Pointer to the statistics of the parsing.
+ * @return           The offset or LINK_NOT_IPV4.
+ */
+static inline uint32_t check_ipv4 (const u_char* packet,
+                                   uint32_t length,
+                                   uint32_t offset,
+                                   link_statistics_t statistics)
+{
+    if (offset + SIZE_IPV4_MIN > length || (packet[offset] >> 4) != 4)
+    {
+        return LINK_NOT_IPV4;
+    }
+
+    statistics->ipv4_packets++;
+
+    return offset;
+}
+
+/*
+ * The helper function for decoding the MPLS label stack. The payload
+ * type is not stored in the stack, so the IPv4 header is recognized
+ * by its version.
+ *
+ * @param packet     Packet body data.
+ * @param length     The captured length of the packet.
+ * @param offset     The offset of the first label.
+ * @param statistics Pointer to the statistics of the parsing.
+ * @return           The offset of the IPv4 header or LINK_NOT_IPV4.
+ */
+static uint32_t parse_mpls (const u_char* packet,
+                            uint32_t length,
+                            uint32_t offset,
+                            link_statistics_t statistics)
+{
+    statistics->mpls_packets++;
+
+    while (offset + SIZE_MPLS_LABEL <= length)
+    {
+        offset += SIZE_MPLS_LABEL;
+
+        if (packet[offset - 2] & MPLS_BOTTOM_OF_STACK)
+        {
+            return check_ipv4(packet, length, offset, statistics);
+        }
+    }
+
+    return LINK_NOT_IPV4;
+}
+
+/*
+ * The helper function for decoding the payload of an EtherType,
+ * including the stacked VLAN tags and the MPLS label stack.
+ *
+ * @param packet     Packet body data.
+ * @param length     The captured length of the packet.
+ * @param type       The EtherType of the payload.
+ * @param offset     The offset of the payload.
+ * @param statistics Pointer to the statistics of the parsing.
+ * @return           The offset of the IPv4 header or LINK_NOT_IPV4.
+ */
+static uint32_t parse_ethertype (const u_char* packet,
+                                 uint32_t length,
+                                 uint16_t type,
+                                 uint32_t offset,
+                                 link_statistics_t statistics)
+{
+    bool tagged = false;
+
+    for (;;)
+    {
+        switch (type)
+        {
+            case LINK_ETHERTYPE_IPV4:
+                return check_ipv4(packet, length, offset, statistics);
+            case LINK_ETHERTYPE_VLAN:
+            case LINK_ETHERTYPE_QINQ:
+            case LINK_ETHERTYPE_QINQ_OLD:
+                // The tag holds the TCI and the EtherType of the next header.
+                if (offset + SIZE_VLAN_TAG > length)
+                {
+                    return LINK_NOT_IPV4;
+                }
+
+                if (!tagged)
+                {
+                    statistics->vlan_packets++;
+                    tagged = true;
+                }
+
+                type = read_uint16(packet + offset + 2);
+                offset += SIZE_VLAN_TAG;
+                break;
+            case LINK_ETHERTYPE_MPLS:
+            case LINK_ETHERTYPE_MPLS_MC:
+                return parse_mpls(packet, length, offset, statistics);
+            default:
+                return LINK_NOT_IPV4;
+        }
+    }
+}
+
+/*
+ * The parser of the Ethernet frames. The untagged IPv4 frames
+ * are handled without the decoding of the tags.
+ */
+static uint32_t parse_ethernet (const u_char* packet,
+                                uint32_t length,
+                                link_statistics_t statistics)
+{
+    if (length < SIZE_ETHERNET)
+    {
+        return LINK_NOT_IPV4;
+    }
+
+    if (read_uint16(packet + ETHERTYPE_OFFSET) == LINK_ETHERTYPE_IPV4)
+    {
+        return check_ipv4(packet, length, SIZE_ETHERNET, statistics);
+    }
+
+    return parse_ethertype(packet, length, read_uint16(packet + ETHERTYPE_OFFSET),
+                           SIZE_ETHERNET, statistics);
+}
+
+/*
+ * The parser of the Linux cooked capture (the "any" device).
+ */
+static uint32_t parse_linux_sll (const u_char* packet,
+                                 uint32_t length,
+                                 link_statistics_t statistics)
+{
+    if (length < SIZE_SLL)
+    {
+        return LINK_NOT_IPV4;
+    }
+
+    return parse_ethertype(packet, length, read_uint16(packet + SLL_PROTOCOL_OFFSET),
+                           SIZE_SLL, statistics);
+}
+
+/*
+ * The parser of the Linux cooked capture v2.
+ */
+static uint32_t parse_linux_sll2 (const u_char* packet,
+                                  uint32_t length,
+                                  link_statistics_t statistics)
+{
+    if (length < SIZE_SLL2)
+    {
+        return LINK_NOT_IPV4;
+    }
+
+    return parse_ethertype(packet, length, read_uint16(packet + SLL2_PROTOCOL_OFFSET),
+                           SIZE_SLL2, statistics);
+}
+
+/*
+ * The parser of the raw IP packets.
+ */
+static uint32_t parse_raw (const u_char* packet,
+                           uint32_t length,
+                           link_statistics_t statistics)
+{
+    return check_ipv4(packet, length, 0, statistics);
+}
+
+/*
+ * The parser of the BSD loopback. The family is written in the byte
+ * order of the capturing host for DLT_NULL and in the network byte order
+ * for DLT_LOOP, so both orders are accepted.
+ */
+static uint32_t parse_null (const u_char* packet,
+                            uint32_t length,
+                            link_statistics_t statistics)
+{
+    if (length < SIZE_NULL ||
+        !((packet[0] == NULL_FAMILY_INET && packet[3] == 0) ||
+          (packet[0] == 0 && packet[3] == NULL_FAMILY_INET)) ||
+        packet[1] != 0 || packet[2] != 0)
+    {
+        return LINK_NOT_IPV4;
+    }
+
+    return check_ipv4(packet, length, SIZE_NULL, statistics);
+}
+
+/*
+ * The parsers of the supported link types.
+ */
+static struct link_parser link_parsers[] =
+{
+    { DLT_EN10MB,     "EN10MB",     parse_ethernet },
+    { DLT_LINUX_SLL,  "LINUX_SLL",  parse_linux_sll },
+    { DLT_LINUX_SLL2, "LINUX_SLL2", parse_linux_sll2 },
+    { DLT_RAW,        "RAW",        parse_raw },
+    { DLT_IPV4,       "IPV4",       parse_raw },
+    { DLT_NULL,       "NULL",       parse_null },
+    { DLT_LOOP,       "LOOP",       parse_null },
+};
+
+/*
+ * Function for selecting the parser of a link type. The parser is
+ * selected once for the input, so the packets are not branched
+ * by the link type.
+ *
+ * @param link_type The link type of the input (pcap_datalink).
+ * @return          Pointer to the parser or NULL for an unsupported link type.
+ */
+link_parser_t link_parser_select (int link_type)
+{
+    size_t i;
+
+    for (i = 0; i < sizeof(link_parsers) / sizeof(link_parsers[0]); i++)
+    {
+        if (link_parsers[i].link_type == link_type)
+        {
+            return &(link_parsers[i]);
+        }
+    }
+
+    return NULL;
+}
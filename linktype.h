@@ -0,0 +1,70 @@
+/**********************************************************/
+/*                                                        */
+/* File: linktype.h                                       */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Header file for the link layer parsers    */
+/*                                                        */
+/**********************************************************/
+
+#ifndef FLOW_LINKTYPE_H
+#define FLOW_LINKTYPE_H
+
+#include <pcap.h>
+#include <stdint.h>
+
+// The Linux cooked capture v2 is missing in the older libpcap headers.
+#ifndef DLT_LINUX_SLL2
+#define DLT_LINUX_SLL2 (276)
+#endif
+
+#define LINK_NOT_IPV4 (UINT32_MAX) // The packet does not carry IPv4.
+
+typedef struct link_statistics* link_statistics_t;
+typedef struct link_parser* link_parser_t;
+
+/*
+ * Structure to store the statistics of the link layer parsing.
+ */
+struct link_statistics
+{
+    uint64_t ipv4_packets;  // The packets passed to the flow processing.
+    uint64_t vlan_packets;  // The packets with 802.1Q or 802.1ad tags.
+    uint64_t mpls_packets;  // The packets with a MPLS label stack.
+};
+
+/*
+ * Type of the function for finding the IPv4 header of a packet.
+ *
+ * @param packet     Packet body data.
+ * @param length     The captured length of the packet.
+ * @param statistics Pointer to the statistics of the parsing.
+ * @return           The offset of the IPv4 header or LINK_NOT_IPV4.
+ */
+typedef uint32_t (*link_parse_function_t) (const u_char* packet,
+                                           uint32_t length,
+                                           link_statistics_t statistics);
+
+/*
+ * Structure to store the parser of a link type.
+ */
+struct link_parser
+{
+    int link_type;               // The DLT_ value of pcap_datalink.
+    const char* name;
+    link_parse_function_t parse;
+};
+
+/*
+ * Function for selecting the parser of a link type. The parser is
+ * selected once for the input, so the packets are not branched
+ * by the link type.
+ *
+ * @param link_type The link type of the input (pcap_datalink).
+ * @return          Pointer to the parser or NULL for an unsupported link type.
+ */
+link_parser_t link_parser_select (int link_type);
+
+#endif // FLOW_LINKTYPE_H
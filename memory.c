@@ -13,9 +13,97 @@
 
 #include <stdbool.h>
 #include <stdlib.h>
-
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "admission.h"
+#include "arrow.h"
+#include "cache.h"
+#include "encoder.h"
+#include "ipfix.h"
 #include "option.h"
 #include "netflow_v5.h"
+#include "routing.h"
+#include "sampling.h"
+#include "sink.h"
+#include "store.h"
+
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024) // Size of a huge page.
+
+/*
+ * The helper function for mapping an anonymous memory region. The region
+ * is either faulted lazily when touched or it is preallocated as an arena.
+ * The arena is backed by huge pages if possible, otherwise transparent huge
+ * pages are requested. The arena is prefaulted and optionally locked
+ * in memory.
+ *
+ * @param size        Pointer to the size of the region, the size of an arena
+ *                    is rounded up to the whole huge pages.
+ * @param arena       The information about if preallocate the region.
+ * @param lock_memory The information about if lock the arena in memory.
+ * @param huge_pages  Output parameter that contains the information
+ *                    about if the region is backed by huge pages.
+ * @return            The mapped region or NULL.
+ */
+static void* map_memory (size_t* size, bool arena, bool lock_memory, bool* huge_pages)
+{
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    void* region = MAP_FAILED;
+
+    *huge_pages = false;
+
+    if (arena)
+    {
+        *size = (*size + HUGE_PAGE_SIZE - 1) & ~((size_t) HUGE_PAGE_SIZE - 1);
+
+#ifdef MAP_HUGETLB
+        // The explicit huge pages are populated by the mapping.
+        region = mmap(NULL, *size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE,
+                      -1, 0);
+
+        *huge_pages = (region != MAP_FAILED);
+#endif
+    }
+
+    if (region == MAP_FAILED)
+    {
+        // The anonymous mapping is zero filled. Without the arena no swap
+        // space is reserved, the pages are provided when touched.
+        region = mmap(NULL, *size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | (arena ? 0 : MAP_NORESERVE),
+                      -1, 0);
+
+        if (region == MAP_FAILED)
+        {
+            return NULL;
+        }
+
+        if (arena)
+        {
+#ifdef MADV_HUGEPAGE
+            // Not fatal, the transparent huge pages can be disabled.
+            madvise(region, *size, MADV_HUGEPAGE);
+#endif
+
+            // Prefault the whole arena, so no page fault occurs during capture.
+            for (size_t offset = 0; offset < *size; offset += page_size)
+            {
+                ((volatile uint8_t*) region)[offset] = 0;
+            }
+        }
+    }
+
+    if (arena && lock_memory && mlock(region, *size) != 0)
+    {
+        munmap(region, *size);
+
+        return NULL;
+    }
+
+    return region;
+}
 
 /*
  * The function figures out if the pointer points
@@ -66,24 +154,124 @@ uint8_t allocate_options (options_t* options)
             (inactive_timeout_t) malloc(sizeof(struct inactive_timeout));
     (*options)->cached_entries_number =
             (cached_entries_t) malloc(sizeof(struct cached_entries));
+    (*options)->cache_memory_budget =
+            (memory_budget_t) malloc(sizeof(struct memory_budget));
+    (*options)->packet_sampling =
+            (sampling_rate_t) malloc(sizeof(struct sampling_rate));
+    (*options)->ingest_max_lag =
+            (max_lag_t) malloc(sizeof(struct max_lag));
+    (*options)->new_flow_admission =
+            (admission_threshold_t) malloc(sizeof(struct admission_threshold));
+    (*options)->aging_watermarks =
+            (aging_watermarks_t) malloc(sizeof(struct aging_watermarks));
+    (*options)->timeout_classes =
+            (timeout_classes_t) malloc(sizeof(struct timeout_classes));
+    (*options)->tcp_state_timeouts =
+            (tcp_state_timeouts_t) malloc(sizeof(struct tcp_state_timeouts));
+    (*options)->aggregation =
+            (aggregation_t) malloc(sizeof(struct aggregation));
+    (*options)->routing_table_source =
+            (routing_file_t) malloc(sizeof(struct routing_file));
+    (*options)->export_format =
+            (export_format_option_t) malloc(sizeof(struct export_format_option));
+    (*options)->export_mtu =
+            (export_mtu_t) malloc(sizeof(struct export_mtu));
+    (*options)->output_file_target =
+            (output_file_t) malloc(sizeof(struct output_file));
+    (*options)->arrow_file_target =
+            (arrow_file_t) malloc(sizeof(struct arrow_file));
+    (*options)->arrow_batch_size =
+            (arrow_batch_size_t) malloc(sizeof(struct arrow_batch_size));
+    (*options)->flow_store_target =
+            (store_directory_t) malloc(sizeof(struct store_directory));
+    (*options)->checkpoint_target =
+            (checkpoint_file_t) malloc(sizeof(struct checkpoint_file));
+    (*options)->restore_source =
+            (checkpoint_file_t) malloc(sizeof(struct checkpoint_file));
+    (*options)->time_window =
+            (time_window_t) malloc(sizeof(struct time_window));
+    (*options)->packet_filter =
+            (packet_filter_t) malloc(sizeof(struct packet_filter));
+    (*options)->flow_hash_key =
+            (flow_hash_key_t) malloc(sizeof(struct flow_hash_key));
 
     if (!is_allocated((*options)->analyzed_input_source) ||
         !is_allocated((*options)->netflow_collector_source) ||
         !is_allocated((*options)->active_entries_timeout) ||
         !is_allocated((*options)->inactive_entries_timeout) ||
-        !is_allocated((*options)->cached_entries_number))
+        !is_allocated((*options)->cached_entries_number) ||
+        !is_allocated((*options)->cache_memory_budget) ||
+        !is_allocated((*options)->packet_sampling) ||
+        !is_allocated((*options)->ingest_max_lag) ||
+        !is_allocated((*options)->new_flow_admission) ||
+        !is_allocated((*options)->aging_watermarks) ||
+        !is_allocated((*options)->timeout_classes) ||
+        !is_allocated((*options)->tcp_state_timeouts) ||
+        !is_allocated((*options)->aggregation) ||
+        !is_allocated((*options)->routing_table_source) ||
+        !is_allocated((*options)->export_format) ||
+        !is_allocated((*options)->export_mtu) ||
+        !is_allocated((*options)->output_file_target) ||
+        !is_allocated((*options)->arrow_file_target) ||
+        !is_allocated((*options)->arrow_batch_size) ||
+        !is_allocated((*options)->flow_store_target) ||
+        !is_allocated((*options)->checkpoint_target) ||
+        !is_allocated((*options)->restore_source) ||
+        !is_allocated((*options)->time_window) ||
+        !is_allocated((*options)->packet_filter) ||
+        !is_allocated((*options)->flow_hash_key))
     {
         free((*options)->analyzed_input_source);
         free((*options)->netflow_collector_source);
         free((*options)->active_entries_timeout);
         free((*options)->inactive_entries_timeout);
         free((*options)->cached_entries_number);
+        free((*options)->cache_memory_budget);
+        free((*options)->packet_sampling);
+        free((*options)->ingest_max_lag);
+        free((*options)->new_flow_admission);
+        free((*options)->aging_watermarks);
+        free((*options)->timeout_classes);
+        free((*options)->tcp_state_timeouts);
+        free((*options)->aggregation);
+        free((*options)->routing_table_source);
+        free((*options)->export_format);
+        free((*options)->export_mtu);
+        free((*options)->output_file_target);
+        free((*options)->arrow_file_target);
+        free((*options)->arrow_batch_size);
+        free((*options)->flow_store_target);
+        free((*options)->checkpoint_target);
+        free((*options)->restore_source);
+        free((*options)->time_window);
+        free((*options)->packet_filter);
+        free((*options)->flow_hash_key);
 
         (*options)->analyzed_input_source = NULL;
         (*options)->netflow_collector_source = NULL;
         (*options)->active_entries_timeout = NULL;
         (*options)->inactive_entries_timeout = NULL;
         (*options)->cached_entries_number = NULL;
+        (*options)->cache_memory_budget = NULL;
+        (*options)->packet_sampling = NULL;
+        (*options)->ingest_max_lag = NULL;
+        (*options)->new_flow_admission = NULL;
+        (*options)->aging_watermarks = NULL;
+        (*options)->timeout_classes = NULL;
+        (*options)->tcp_state_timeouts = NULL;
+        (*options)->aggregation = NULL;
+        (*options)->routing_table_source = NULL;
+        (*options)->export_format = NULL;
+        (*options)->export_mtu = NULL;
+        (*options)->output_file_target = NULL;
+        (*options)->arrow_file_target = NULL;
+        (*options)->arrow_batch_size = NULL;
+        (*options)->flow_store_target = NULL;
+        (*options)->checkpoint_target = NULL;
+        (*options)->restore_source = NULL;
+        (*options)->time_window = NULL;
+        (*options)->packet_filter = NULL;
+        (*options)->flow_hash_key = NULL;
 
         free(*options);
         *options = NULL;
@@ -147,7 +335,23 @@ uint8_t allocate_recording_system (netflow_recording_system_t* netflow_records)
         return EXIT_FAILURE;
     }
 
-    (*netflow_records)->tree = NULL;
+    (*netflow_records)->cache = NULL;
+    (*netflow_records)->sampling = NULL;
+    (*netflow_records)->admission = NULL;
+    (*netflow_records)->routing = NULL;
+    (*netflow_records)->first_packet_seen = false;
+    (*netflow_records)->next_cache_id = 0;
+    (*netflow_records)->flow_sequence_number = 0;
+    (*netflow_records)->checkpointed = false;
+    (*netflow_records)->window_from_ms = 0;
+    (*netflow_records)->window_to_ms = UINT64_MAX;
+    (*netflow_records)->window_dropped_flows = 0;
+    (*netflow_records)->read_packets = 0;
+    (*netflow_records)->filtered_packets = 0;
+    (*netflow_records)->processing_us = 0;
+    (*netflow_records)->link_type_name = NULL;
+    memset(&((*netflow_records)->link_statistics), 0,
+           sizeof((*netflow_records)->link_statistics));
 
     (*netflow_records)->first_packet_time =
             (struct timeval*) malloc(sizeof(struct timeval));
@@ -189,6 +393,14 @@ uint8_t allocate_recording_system (netflow_recording_system_t* netflow_records)
         return EXIT_FAILURE;
     }
 
+    (*netflow_records)->sampling =
+            (packet_sampling_t) malloc(sizeof(struct packet_sampling));
+
+    if (!is_allocated((*netflow_records)->sampling))
+    {
+        return EXIT_FAILURE;
+    }
+
     return EXIT_SUCCESS;
 }
 
@@ -208,28 +420,67 @@ uint8_t allocate_sending_system (netflow_sending_system_t* sending_system)
         return EXIT_FAILURE;
     }
 
+    (*sending_system)->packet_buffer = NULL;
+    (*sending_system)->encoder = NULL;
+    (*sending_system)->ipfix = NULL;
+    (*sending_system)->sink = NULL;
+    (*sending_system)->arrow = NULL;
+    (*sending_system)->store = NULL;
+    (*sending_system)->collector_connected = false;
+
     if (allocate_socket(&((*sending_system)->socket)) != EXIT_SUCCESS)
     {
         return EXIT_FAILURE;
     }
 
+    (*sending_system)->packet_buffer = (uint8_t*) malloc(MAX_PACKET_SIZE);
+
+    if (!is_allocated((*sending_system)->packet_buffer))
+    {
+        return EXIT_FAILURE;
+    }
+
+    (*sending_system)->encoder = (record_encoder_t) malloc(sizeof(struct record_encoder));
+
+    if (!is_allocated((*sending_system)->encoder))
+    {
+        return EXIT_FAILURE;
+    }
+
+    encoder_init((*sending_system)->encoder);
+
     return EXIT_SUCCESS;
 }
 
 /*
- * Function for allocating the flow key whose value is stored in a node
- * in a tree.
+ * Function for allocating an array of buckets of the flow cache.
  *
- * @param flow_key Pointer to pointer to the storage of flow key.
- * @return         Status of function processing.
+ * @param buckets        Pointer to pointer to the storage of the buckets.
+ * @param buckets_size   Output parameter that contains the size
+ *                       of the array in bytes.
+ * @param buckets_number The number of buckets.
+ * @param arena          The information about if preallocate the array
+ *                       as a prefaulted arena.
+ * @param lock_memory    The information about if lock the arena in memory.
+ * @param huge_pages     Output parameter that contains the information
+ *                       about if the array is backed by huge pages.
+ * @return               Status of function processing.
  */
-uint8_t allocate_netflow_key (netflow_v5_key_t* flow_key)
+uint8_t allocate_cache_buckets (uint32_t** buckets,
+                                size_t* buckets_size,
+                                uint32_t buckets_number,
+                                bool arena,
+                                bool lock_memory,
+                                bool* huge_pages)
 {
-    *flow_key =
-            (netflow_v5_key_t) malloc(sizeof(struct netflow_v5_key));
+    // The mapped memory is zero filled, so all buckets are empty.
+    *buckets_size = (size_t) buckets_number * sizeof(uint32_t);
+    *buckets = (uint32_t*) map_memory(buckets_size, arena, lock_memory, huge_pages);
 
-    if (!is_allocated(flow_key))
+    if (!is_allocated(*buckets))
     {
+        *buckets_size = 0;
+
         return EXIT_FAILURE;
     }
 
@@ -237,34 +488,96 @@ uint8_t allocate_netflow_key (netflow_v5_key_t* flow_key)
 }
 
 /*
- * Function for allocating the flow record whose value is stored in a node
- * in a tree.
+ * Function for allocating the flow cache. The array of entries is mapped
+ * at once for the maximum number of flows, but without the arena it occupies
+ * the memory only when touched by the cached flows. The hash table starts
+ * small and grows with the number of cached flows. With the arena,
+ * the hash table is preallocated for the maximum number of flows.
  *
- * @param flow_record Pointer to pointer to the storage of flow record.
- * @return            Status of function processing.
+ * @param cache          Pointer to pointer to the storage of the flow cache.
+ * @param entries_number The maximum number of cached flows.
+ * @param layout         The cache layout of the entries.
+ * @param arena          The information about if preallocate the cache
+ *                       as a prefaulted arena.
+ * @param lock_memory    The information about if lock the arena in memory.
+ * @return               Status of function processing.
  */
-uint8_t allocate_flow_node (flow_node_t* flow_record)
+uint8_t allocate_flow_cache (flow_cache_t* cache,
+                             uint32_t entries_number,
+                             uint8_t layout,
+                             bool arena,
+                             bool lock_memory)
 {
-    *flow_record =
-            (flow_node_t) malloc(sizeof(struct flow_node));
+    bool entries_huge_pages;
+    bool buckets_huge_pages;
+    uint32_t max_buckets = cache_buckets_number(entries_number);
+    uint32_t min_buckets = arena ? max_buckets : CACHE_MIN_BUCKETS;
 
-    if (!is_allocated(*flow_record))
+    if (min_buckets > max_buckets)
+    {
+        min_buckets = max_buckets;
+    }
+
+    *cache = (flow_cache_t) calloc(1, sizeof(struct flow_cache));
+
+    if (!is_allocated(*cache))
     {
         return EXIT_FAILURE;
     }
 
-    (*flow_record)->first =
-            (struct timeval*) malloc(sizeof(struct timeval));
+    (*cache)->layout = layout;
+    (*cache)->entry_size = cache_entry_size(layout);
 
-    if (!is_allocated((*flow_record)->first))
+    // The entry with the CACHE_NIL index is never used.
+    (*cache)->entries_size = ((size_t) entries_number + 1) * (*cache)->entry_size;
+    (*cache)->entries = (uint8_t*) map_memory(&((*cache)->entries_size),
+                                              arena,
+                                              lock_memory,
+                                              &entries_huge_pages);
+
+    if (!is_allocated((*cache)->entries))
     {
+        (*cache)->entries_size = 0;
+
         return EXIT_FAILURE;
     }
 
-    (*flow_record)->last =
-            (struct timeval*) malloc(sizeof(struct timeval));
+    if (allocate_cache_buckets(&((*cache)->buckets),
+                               &((*cache)->buckets_size),
+                               min_buckets,
+                               arena,
+                               lock_memory,
+                               &buckets_huge_pages) != EXIT_SUCCESS)
+    {
+        return EXIT_FAILURE;
+    }
 
-    if (!is_allocated((*flow_record)->last))
+    // The mapped memory is zero filled, so all lists are empty.
+    (*cache)->bucket_mask = min_buckets - 1;
+    (*cache)->old_buckets = NULL;
+    (*cache)->min_buckets = min_buckets;
+    (*cache)->max_buckets = max_buckets;
+    (*cache)->max_entries = entries_number;
+    (*cache)->used_entries = 0;
+    (*cache)->free_entries = CACHE_NIL;
+    (*cache)->huge_pages = entries_huge_pages && buckets_huge_pages;
+
+    cache_seed_hash(*cache);
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Function for allocating the admission of new flows.
+ *
+ * @param admission Pointer to pointer to the storage of the admission.
+ * @return          Status of function processing.
+ */
+uint8_t allocate_flow_admission (flow_admission_t* admission)
+{
+    *admission = (flow_admission_t) malloc(sizeof(struct flow_admission));
+
+    if (!is_allocated(*admission))
     {
         return EXIT_FAILURE;
     }
@@ -273,21 +586,168 @@ uint8_t allocate_flow_node (flow_node_t* flow_record)
 }
 
 /*
- * Function for allocating the tree node.
+ * Function for allocating the routing table. The tbl24 is mapped
+ * without the reserved memory and it is zero filled, so no address
+ * has a route.
  *
- * @param tree Pointer to pointer to the storage of a tree node.
+ * @param table Pointer to pointer to the storage of the routing table.
+ * @return      Status of function processing.
+ */
+uint8_t allocate_routing_table (routing_table_t* table)
+{
+    bool huge_pages;
+
+    *table = (routing_table_t) calloc(1, sizeof(struct routing_table));
+
+    if (!is_allocated(*table))
+    {
+        return EXIT_FAILURE;
+    }
+
+    (*table)->tbl24_size = (size_t) ROUTING_TBL24_SIZE * sizeof(uint32_t);
+    (*table)->tbl24 = (uint32_t*) map_memory(&((*table)->tbl24_size), false, false, &huge_pages);
+
+    if (!is_allocated((*table)->tbl24))
+    {
+        (*table)->tbl24_size = 0;
+
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Function for allocating the IPFIX exporter with the message buffer
+ * for the MTU.
+ *
+ * @param exporter Pointer to pointer to the storage of the exporter.
+ * @param mtu      The MTU of the export path.
+ * @return         Status of function processing.
+ */
+uint8_t allocate_ipfix_exporter (ipfix_exporter_t* exporter, uint16_t mtu)
+{
+    *exporter = (ipfix_exporter_t) malloc(sizeof(struct ipfix_exporter));
+
+    if (!is_allocated(*exporter))
+    {
+        return EXIT_FAILURE;
+    }
+
+    (*exporter)->message_size = (size_t) mtu - IPFIX_UDP_OVERHEAD;
+    (*exporter)->message = (uint8_t*) malloc((*exporter)->message_size);
+
+    if (!is_allocated((*exporter)->message))
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Function for allocating the flow file sink.
+ *
+ * @param sink Pointer to pointer to the storage of the sink.
  * @return     Status of function processing.
  */
-uint8_t allocate_tree_node (bst_node_t* tree_node)
+uint8_t allocate_flow_sink (flow_sink_t* sink)
+{
+    *sink = (flow_sink_t) malloc(sizeof(struct flow_sink));
+
+    if (!is_allocated(*sink))
+    {
+        return EXIT_FAILURE;
+    }
+
+    (*sink)->fd = -1;
+    (*sink)->segment = NULL;
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Function for allocating the Arrow IPC file writer with the columns
+ * of a record batch.
+ *
+ * @param writer     Pointer to pointer to the storage of the writer.
+ * @param batch_rows The number of rows of a record batch.
+ * @return           Status of function processing.
+ */
+uint8_t allocate_arrow_writer (arrow_writer_t* writer, uint32_t batch_rows)
+{
+    *writer = (arrow_writer_t) malloc(sizeof(struct arrow_writer));
+
+    if (!is_allocated(*writer))
+    {
+        return EXIT_FAILURE;
+    }
+
+    (*writer)->file = NULL;
+    (*writer)->batch_rows = batch_rows;
+    (*writer)->builder.data = NULL;
+    (*writer)->builder.length = 0;
+    (*writer)->builder.capacity = 0;
+    (*writer)->blocks = NULL;
+    (*writer)->blocks_number = 0;
+    (*writer)->blocks_capacity = 0;
+    (*writer)->records_number = 0;
+
+    for (uint8_t i = 0; i < ARROW_COLUMNS_NUMBER; i++)
+    {
+        (*writer)->columns[i] = (uint8_t*) malloc((size_t) batch_rows * arrow_column_width(i));
+    }
+
+    for (uint8_t i = 0; i < ARROW_COLUMNS_NUMBER; i++)
+    {
+        if (!is_allocated((*writer)->columns[i]))
+        {
+            free_arrow_writer(writer);
+
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Function for allocating the flow store writer with its block
+ * and segment index.
+ *
+ * @param store Pointer to pointer to the storage of the store.
+ * @return      Status of function processing.
+ */
+uint8_t allocate_flow_store (flow_store_t* store)
 {
-    *tree_node =
-            (bst_node_t) malloc(sizeof(struct bst_node));
+    *store = (flow_store_t) malloc(sizeof(struct flow_store));
 
-    if (!is_allocated(*tree_node))
+    if (!is_allocated(*store))
     {
         return EXIT_FAILURE;
     }
 
+    (*store)->fd = -1;
+    (*store)->block_records = 0;
+    (*store)->records_number = 0;
+    (*store)->raw_bytes = 0;
+    (*store)->stored_bytes = 0;
+    (*store)->segments_number = 0;
+    (*store)->block = (struct sink_record*) malloc(STORE_BLOCK_RECORDS *
+                                                   sizeof(struct sink_record));
+    (*store)->encoded = (uint8_t*) malloc(STORE_BLOCK_RECORDS * STORE_RECORD_MAX);
+    (*store)->index = (struct store_index_entry*) malloc(STORE_SEGMENT_BLOCKS *
+                                                         sizeof(struct store_index_entry));
+
+    if (!is_allocated((*store)->block) ||
+        !is_allocated((*store)->encoded) ||
+        !is_allocated((*store)->index))
+    {
+        free_flow_store(store);
+
+        return EXIT_FAILURE;
+    }
+
     return EXIT_SUCCESS;
 }
 
@@ -319,17 +779,106 @@ void free_options_mem (options_t* options)
             (*options)->analyzed_input_source->file_name = NULL;
         }
 
+        if (is_allocated((*options)->routing_table_source) &&
+            is_allocated((*options)->routing_table_source->file_name))
+        {
+            free((*options)->routing_table_source->file_name);
+            (*options)->routing_table_source->file_name = NULL;
+        }
+
+        if (is_allocated((*options)->output_file_target) &&
+            is_allocated((*options)->output_file_target->file_name))
+        {
+            free((*options)->output_file_target->file_name);
+            (*options)->output_file_target->file_name = NULL;
+        }
+
+        if (is_allocated((*options)->arrow_file_target) &&
+            is_allocated((*options)->arrow_file_target->file_name))
+        {
+            free((*options)->arrow_file_target->file_name);
+            (*options)->arrow_file_target->file_name = NULL;
+        }
+
+        if (is_allocated((*options)->flow_store_target) &&
+            is_allocated((*options)->flow_store_target->directory))
+        {
+            free((*options)->flow_store_target->directory);
+            (*options)->flow_store_target->directory = NULL;
+        }
+
+        if (is_allocated((*options)->checkpoint_target) &&
+            is_allocated((*options)->checkpoint_target->file_name))
+        {
+            free((*options)->checkpoint_target->file_name);
+            (*options)->checkpoint_target->file_name = NULL;
+        }
+
+        if (is_allocated((*options)->restore_source) &&
+            is_allocated((*options)->restore_source->file_name))
+        {
+            free((*options)->restore_source->file_name);
+            (*options)->restore_source->file_name = NULL;
+        }
+
+        if (is_allocated((*options)->packet_filter) &&
+            is_allocated((*options)->packet_filter->expression))
+        {
+            free((*options)->packet_filter->expression);
+            (*options)->packet_filter->expression = NULL;
+        }
+
         free((*options)->analyzed_input_source);
         free((*options)->netflow_collector_source);
         free((*options)->active_entries_timeout);
         free((*options)->inactive_entries_timeout);
         free((*options)->cached_entries_number);
+        free((*options)->cache_memory_budget);
+        free((*options)->packet_sampling);
+        free((*options)->ingest_max_lag);
+        free((*options)->new_flow_admission);
+        free((*options)->aging_watermarks);
+        free((*options)->timeout_classes);
+        free((*options)->tcp_state_timeouts);
+        free((*options)->aggregation);
+        free((*options)->routing_table_source);
+        free((*options)->export_format);
+        free((*options)->export_mtu);
+        free((*options)->output_file_target);
+        free((*options)->arrow_file_target);
+        free((*options)->arrow_batch_size);
+        free((*options)->flow_store_target);
+        free((*options)->checkpoint_target);
+        free((*options)->restore_source);
+        free((*options)->time_window);
+        free((*options)->packet_filter);
+        free((*options)->flow_hash_key);
 
         (*options)->analyzed_input_source = NULL;
         (*options)->netflow_collector_source = NULL;
         (*options)->active_entries_timeout = NULL;
         (*options)->inactive_entries_timeout = NULL;
         (*options)->cached_entries_number = NULL;
+        (*options)->cache_memory_budget = NULL;
+        (*options)->packet_sampling = NULL;
+        (*options)->ingest_max_lag = NULL;
+        (*options)->new_flow_admission = NULL;
+        (*options)->aging_watermarks = NULL;
+        (*options)->timeout_classes = NULL;
+        (*options)->tcp_state_timeouts = NULL;
+        (*options)->aggregation = NULL;
+        (*options)->routing_table_source = NULL;
+        (*options)->export_format = NULL;
+        (*options)->export_mtu = NULL;
+        (*options)->output_file_target = NULL;
+        (*options)->arrow_file_target = NULL;
+        (*options)->arrow_batch_size = NULL;
+        (*options)->flow_store_target = NULL;
+        (*options)->checkpoint_target = NULL;
+        (*options)->restore_source = NULL;
+        (*options)->time_window = NULL;
+        (*options)->packet_filter = NULL;
+        (*options)->flow_hash_key = NULL;
 
         free(*options);
         *options = NULL;
@@ -337,125 +886,108 @@ void free_options_mem (options_t* options)
 }
 
 /*
- * Function for freeing memory which was allocated for the netflow key.
+ * Function for freeing memory which was allocated for the string.
  *
- * @param flow_key Pointer to pointer to the storage of netflow key.
+ * @param string Pointer to pointer to the storage of string.
  */
-void free_netflow_key (netflow_v5_key_t* flow_key)
+void free_string (char** string)
 {
-    if (is_allocated(*flow_key))
+    if (is_allocated(*string))
     {
-        free(*flow_key);
-        *flow_key = NULL;
+        free(*string);
+        *string = NULL;
     }
 }
 
 /*
- * Function for freeing memory which was allocated for the flow node.
+ * Function for freeing memory which was allocated for the socket.
  *
- * @param flow_record Pointer to pointer to the storage of flow record.
+ * @param string Pointer to pointer to the storage of socket.
  */
-void free_flow_node (flow_node_t* flow_record)
+void free_socket (int** socket)
 {
-    if (is_allocated(*flow_record))
+    if (is_allocated(*socket))
     {
-        if (is_allocated((*flow_record)->first))
-        {
-            free((*flow_record)->first);
-            (*flow_record)->first = NULL;
-        }
-
-        if (is_allocated((*flow_record)->last))
-        {
-            free((*flow_record)->last);
-            (*flow_record)->last = NULL;
-        }
-
-        free(*flow_record);
-        *flow_record = NULL;
+        free(*socket);
+        *socket = NULL;
     }
 }
 
 /*
- * Function for freeing memory which was allocated for the tree node.
+ * Function for freeing memory which was allocated for an array of buckets
+ * of the flow cache.
  *
- * @param flow_record Pointer to pointer to the storage of tree node.
+ * @param buckets      Pointer to pointer to the storage of the buckets.
+ * @param buckets_size Pointer to the size of the array in bytes.
  */
-void free_tree_node (bst_node_t* tree_node)
+void free_cache_buckets (uint32_t** buckets, size_t* buckets_size)
 {
-    if (is_allocated(*tree_node))
+    if (is_allocated(*buckets))
     {
-        if (is_allocated((*tree_node)->key))
-        {
-            free_netflow_key(&((*tree_node)->key));
-        }
-
-        if (is_allocated((*tree_node)->value))
-        {
-            free_flow_node(&((*tree_node)->value));
-        }
-
-        free(*tree_node);
-        *tree_node = NULL;
+        munmap(*buckets, *buckets_size);
+        *buckets = NULL;
+        *buckets_size = 0;
     }
 }
 
 /*
- * Function for freeing memory which was allocated for the tree node.
- * The difference is that this function does not free the allocated memory
- * for the key and flow value stored in the tree node.
+ * Function for freeing memory which was allocated for the flow cache.
  *
- * @param flow_record Pointer to pointer to the storage of tree node.
+ * @param cache Pointer to pointer to the storage of the flow cache.
  */
-void free_tree_node_keep_data (bst_node_t* tree_node)
+void free_flow_cache (flow_cache_t* cache)
 {
-    if (is_allocated(*tree_node))
+    if (is_allocated(*cache))
     {
-        free(*tree_node);
-        *tree_node = NULL;
-    }
-}
+        if (is_allocated((*cache)->entries))
+        {
+            munmap((*cache)->entries, (*cache)->entries_size);
+            (*cache)->entries = NULL;
+        }
 
-/*
- * Function for freeing memory for flow node values which were stored
- * in an array.
- *
- * @param flows        An array containing flow node values.
- * @param flows_number The number of flow node values in the array.
- */
-void free_flow_values_array (flow_node_t* flows, uint16_t flows_number)
-{
-    for (uint16_t i = 0; i < flows_number; i++)
-    {
-        free_flow_node(&(flows[i]));
+        free_cache_buckets(&((*cache)->buckets), &((*cache)->buckets_size));
+        free_cache_buckets(&((*cache)->old_buckets), &((*cache)->old_buckets_size));
+
+        free(*cache);
+        *cache = NULL;
     }
 }
 
 /*
- * Function for freeing memory which was allocated for the string.
+ * Function for freeing memory which was allocated for the admission
+ * of new flows.
  *
- * @param string Pointer to pointer to the storage of string.
+ * @param admission Pointer to pointer to the storage of the admission.
  */
-void free_string (char** string)
+void free_flow_admission (flow_admission_t* admission)
 {
-    if (is_allocated(*string))
+    if (is_allocated(*admission))
     {
-        free(*string);
-        *string = NULL;
+        free(*admission);
+        *admission = NULL;
     }
 }
 
 /*
- * Function for freeing memory which was allocated for the socket.
+ * Function for freeing memory which was allocated for the routing table.
  *
- * @param string Pointer to pointer to the storage of socket.
+ * @param table Pointer to pointer to the storage of the routing table.
  */
-void free_socket (int** socket)
+void free_routing_table (routing_table_t* table)
 {
-    if (is_allocated(*socket))
+    if (is_allocated(*table))
     {
-        free(*socket);
-        *socket = NULL;
+        if (is_allocated((*table)->tbl24))
+        {
+            munmap((*table)->tbl24, (*table)->tbl24_size);
+            (*table)->tbl24 = NULL;
+        }
+
+        free((*table)->tbl8);
+        free((*table)->routes);
+
+        free(*table);
+        *table = NULL;
     }
 }
 
@@ -470,6 +1002,10 @@ void free_recording_system (netflow_recording_system_t* netflow_records)
 {
     if (is_allocated(*netflow_records))
     {
+        free_flow_cache(&((*netflow_records)->cache));
+        free_flow_admission(&((*netflow_records)->admission));
+        free_routing_table(&((*netflow_records)->routing));
+
         if (is_allocated((*netflow_records)->first_packet_time))
         {
             free((*netflow_records)->first_packet_time);
@@ -500,11 +1036,88 @@ void free_recording_system (netflow_recording_system_t* netflow_records)
             (*netflow_records)->sent_packets_statistics = NULL;
         }
 
+        if (is_allocated((*netflow_records)->sampling))
+        {
+            free((*netflow_records)->sampling);
+            (*netflow_records)->sampling = NULL;
+        }
+
         free(*netflow_records);
         *netflow_records = NULL;
     }
 }
 
+/*
+ * Function for freeing memory which was allocated for the IPFIX exporter.
+ *
+ * @param exporter Pointer to pointer to the storage of the exporter.
+ */
+void free_ipfix_exporter (ipfix_exporter_t* exporter)
+{
+    if (is_allocated(*exporter))
+    {
+        free((*exporter)->message);
+
+        free(*exporter);
+        *exporter = NULL;
+    }
+}
+
+/*
+ * Function for freeing memory which was allocated for the flow file sink.
+ * The file has to be closed by sink_close().
+ *
+ * @param sink Pointer to pointer to the storage of the sink.
+ */
+void free_flow_sink (flow_sink_t* sink)
+{
+    if (is_allocated(*sink))
+    {
+        free(*sink);
+        *sink = NULL;
+    }
+}
+
+/*
+ * Function for freeing memory which was allocated for the Arrow IPC file
+ * writer. The file has to be closed by arrow_close().
+ *
+ * @param writer Pointer to pointer to the storage of the writer.
+ */
+void free_arrow_writer (arrow_writer_t* writer)
+{
+    if (is_allocated(*writer))
+    {
+        for (uint8_t i = 0; i < ARROW_COLUMNS_NUMBER; i++)
+        {
+            free((*writer)->columns[i]);
+        }
+
+        free((*writer)->builder.data);
+        free((*writer)->blocks);
+        free(*writer);
+        *writer = NULL;
+    }
+}
+
+/*
+ * Function for freeing memory which was allocated for the flow store
+ * writer. The store has to be closed by store_close().
+ *
+ * @param store Pointer to pointer to the storage of the store.
+ */
+void free_flow_store (flow_store_t* store)
+{
+    if (is_allocated(*store))
+    {
+        free((*store)->block);
+        free((*store)->encoded);
+        free((*store)->index);
+        free(*store);
+        *store = NULL;
+    }
+}
+
 /*
  * Function for freeing memory which was allocated for the sending system.
  *
@@ -520,6 +1133,23 @@ void free_sending_system (netflow_sending_system_t* sending_system)
             free_socket(&((*sending_system)->socket));
         }
 
+        if (is_allocated((*sending_system)->packet_buffer))
+        {
+            free((*sending_system)->packet_buffer);
+            (*sending_system)->packet_buffer = NULL;
+        }
+
+        if (is_allocated((*sending_system)->encoder))
+        {
+            free((*sending_system)->encoder);
+            (*sending_system)->encoder = NULL;
+        }
+
+        free_ipfix_exporter(&((*sending_system)->ipfix));
+        free_flow_sink(&((*sending_system)->sink));
+        free_arrow_writer(&((*sending_system)->arrow));
+        free_flow_store(&((*sending_system)->store));
+
         free(*sending_system);
         *sending_system = NULL;
     }
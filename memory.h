@@ -16,8 +16,15 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#include "admission.h"
+#include "arrow.h"
+#include "cache.h"
+#include "ipfix.h"
 #include "option.h"
 #include "netflow_v5.h"
+#include "routing.h"
+#include "sink.h"
+#include "store.h"
 
 /*
  * The function figures out if the pointer points
@@ -71,77 +78,109 @@ uint8_t allocate_recording_system (netflow_recording_system_t* netflow_records);
 uint8_t allocate_sending_system (netflow_sending_system_t* sending_system);
 
 /*
- * Function for allocating the flow key whose value is stored in a node
- * in a tree.
+ * Function for allocating an array of buckets of the flow cache.
  *
- * @param flow_key Pointer to pointer to the storage of flow key.
- * @return         Status of function processing.
+ * @param buckets        Pointer to pointer to the storage of the buckets.
+ * @param buckets_size   Output parameter that contains the size
+ *                       of the array in bytes.
+ * @param buckets_number The number of buckets.
+ * @param arena          The information about if preallocate the array
+ *                       as a prefaulted arena.
+ * @param lock_memory    The information about if lock the arena in memory.
+ * @param huge_pages     Output parameter that contains the information
+ *                       about if the array is backed by huge pages.
+ * @return               Status of function processing.
  */
-uint8_t allocate_netflow_key (netflow_v5_key_t* flow_key);
+uint8_t allocate_cache_buckets (uint32_t** buckets,
+                                size_t* buckets_size,
+                                uint32_t buckets_number,
+                                bool arena,
+                                bool lock_memory,
+                                bool* huge_pages);
 
 /*
- * Function for allocating the flow record whose value is stored in a node
- * in a tree.
+ * Function for allocating the flow cache. The array of entries is mapped
+ * at once for the maximum number of flows, but without the arena it occupies
+ * the memory only when touched by the cached flows. The hash table starts
+ * small and grows with the number of cached flows. With the arena,
+ * the hash table is preallocated for the maximum number of flows.
  *
- * @param flow_record Pointer to pointer to the storage of flow record.
- * @return            Status of function processing.
+ * @param cache          Pointer to pointer to the storage of the flow cache.
+ * @param entries_number The maximum number of cached flows.
+ * @param layout         The cache layout of the entries.
+ * @param arena          The information about if preallocate the cache
+ *                       as a prefaulted arena.
+ * @param lock_memory    The information about if lock the arena in memory.
+ * @return               Status of function processing.
  */
-uint8_t allocate_flow_node (flow_node_t* flow_record);
+uint8_t allocate_flow_cache (flow_cache_t* cache,
+                             uint32_t entries_number,
+                             uint8_t layout,
+                             bool arena,
+                             bool lock_memory);
 
 /*
- * Function for allocating the tree node.
+ * Function for allocating the admission of new flows.
  *
- * @param tree Pointer to pointer to the storage of a tree node.
- * @return     Status of function processing.
+ * @param admission Pointer to pointer to the storage of the admission.
+ * @return          Status of function processing.
  */
-uint8_t allocate_tree_node (bst_node_t* tree);
+uint8_t allocate_flow_admission (flow_admission_t* admission);
 
 /*
- * Function for freeing memory which was allocated for the options structure
- * and the substructures.
+ * Function for allocating the routing table. The tbl24 is mapped
+ * without the reserved memory and it is zero filled, so no address
+ * has a route.
  *
- * @param options Pointer to pointer to options storage.
+ * @param table Pointer to pointer to the storage of the routing table.
+ * @return      Status of function processing.
  */
-void free_options_mem (options_t* options);
+uint8_t allocate_routing_table (routing_table_t* table);
 
 /*
- * Function for freeing memory which was allocated for the netflow key.
+ * Function for allocating the IPFIX exporter with the message buffer
+ * for the MTU.
  *
- * @param flow_key Pointer to pointer to the storage of netflow key.
+ * @param exporter Pointer to pointer to the storage of the exporter.
+ * @param mtu      The MTU of the export path.
+ * @return         Status of function processing.
  */
-void free_netflow_key (netflow_v5_key_t* flow_key);
+uint8_t allocate_ipfix_exporter (ipfix_exporter_t* exporter, uint16_t mtu);
 
 /*
- * Function for freeing memory which was allocated for the flow node value.
+ * Function for allocating the flow file sink.
  *
- * @param flow_record Pointer to pointer to the storage of flow record.
+ * @param sink Pointer to pointer to the storage of the sink.
+ * @return     Status of function processing.
  */
-void free_flow_node (flow_node_t* flow_record);
+uint8_t allocate_flow_sink (flow_sink_t* sink);
 
 /*
- * Function for freeing memory which was allocated for the tree node.
+ * Function for allocating the Arrow IPC file writer with the columns
+ * of a record batch.
  *
- * @param flow_record Pointer to pointer to the storage of tree node.
+ * @param writer     Pointer to pointer to the storage of the writer.
+ * @param batch_rows The number of rows of a record batch.
+ * @return           Status of function processing.
  */
-void free_tree_node (bst_node_t* tree_node);
+uint8_t allocate_arrow_writer (arrow_writer_t* writer, uint32_t batch_rows);
 
 /*
- * Function for freeing memory which was allocated for the tree node.
- * The difference is that this function does not free the allocated memory
- * for the key and flow value stored in the tree node.
+ * Function for allocating the flow store writer with its block
+ * and segment index.
  *
- * @param flow_record Pointer to pointer to the storage of tree node.
+ * @param store Pointer to pointer to the storage of the store.
+ * @return      Status of function processing.
  */
-void free_tree_node_keep_data (bst_node_t* tree_node);
+uint8_t allocate_flow_store (flow_store_t* store);
 
 /*
- * Function for freeing memory for flow node values which were stored
- * in an array.
+ * Function for freeing memory which was allocated for the options structure
+ * and the substructures.
  *
- * @param flows        An array containing flow node values.
- * @param flows_number The number of flow node values in the array.
+ * @param options Pointer to pointer to options storage.
  */
-void free_flow_values_array (flow_node_t* flows, uint16_t flows_number);
+void free_options_mem (options_t* options);
 
 /*
  * Function for freeing memory which was allocated for the string.
@@ -157,6 +196,68 @@ void free_string (char** string);
  */
 void free_socket (int** socket);
 
+/*
+ * Function for freeing memory which was allocated for an array of buckets
+ * of the flow cache.
+ *
+ * @param buckets      Pointer to pointer to the storage of the buckets.
+ * @param buckets_size Pointer to the size of the array in bytes.
+ */
+void free_cache_buckets (uint32_t** buckets, size_t* buckets_size);
+
+/*
+ * Function for freeing memory which was allocated for the flow cache.
+ *
+ * @param cache Pointer to pointer to the storage of the flow cache.
+ */
+void free_flow_cache (flow_cache_t* cache);
+
+/*
+ * Function for freeing memory which was allocated for the admission
+ * of new flows.
+ *
+ * @param admission Pointer to pointer to the storage of the admission.
+ */
+void free_flow_admission (flow_admission_t* admission);
+
+/*
+ * Function for freeing memory which was allocated for the routing table.
+ *
+ * @param table Pointer to pointer to the storage of the routing table.
+ */
+void free_routing_table (routing_table_t* table);
+
+/*
+ * Function for freeing memory which was allocated for the IPFIX exporter.
+ *
+ * @param exporter Pointer to pointer to the storage of the exporter.
+ */
+void free_ipfix_exporter (ipfix_exporter_t* exporter);
+
+/*
+ * Function for freeing memory which was allocated for the flow file sink.
+ * The file has to be closed by sink_close().
+ *
+ * @param sink Pointer to pointer to the storage of the sink.
+ */
+void free_flow_sink (flow_sink_t* sink);
+
+/*
+ * Function for freeing memory which was allocated for the Arrow IPC file
+ * writer. The file has to be closed by arrow_close().
+ *
+ * @param writer Pointer to pointer to the storage of the writer.
+ */
+void free_arrow_writer (arrow_writer_t* writer);
+
+/*
+ * Function for freeing memory which was allocated for the flow store
+ * writer. The store has to be closed by store_close().
+ *
+ * @param store Pointer to pointer to the storage of the store.
+ */
+void free_flow_store (flow_store_t* store);
+
 /*
  * Function for freeing memory which was allocated for the netflow
  * recording system.
@@ -17,6 +17,8 @@
 #include <pcap.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <netinet/ip.h>
 #include <netinet/ip_icmp.h>
@@ -25,12 +27,19 @@
 #include <netinet/udp.h>
 #undef __FAVOR_BSD // For Merlin server.
 
+#include "admission.h"
+#include "aggregation.h"
+#include "arrow.h"
+#include "cache.h"
+#include "encoder.h"
 #include "error.h"
-#include "memory.h"
-#include "tree.h"
+#include "ipfix.h"
+#include "routing.h"
+#include "sampling.h"
+#include "sink.h"
+#include "store.h"
 #include "util.h"
 
-#define SIZE_ETHERNET (14)  // Offset of Ethernet header to L3 protocol.
 
 /*
  * Function for comparing flows by their keys.
@@ -92,84 +101,383 @@ int compare_flows (netflow_v5_key_t first_flow, netflow_v5_key_t second_flow)
 }
 
 /*
- * Function for exporting flows to collector.
+ * Function for getting the time of the last packet of a flow
+ * in any direction.
  *
- * @param netflow_records Pointer to pointer to the netflow recording system.
- * @param sending_system  Pointer to pointer to the sending system.
- * @param flows           An array of flows to export.
- * @param flows_number    The number of flows in the array of flows to export.
+ * @param flow Pointer to the flow.
+ * @return     The time stamp of the last packet.
+ */
+const struct timeval* flow_last_seen (flow_node_t flow)
+{
+    flow_reverse_t reverse_flow = flow_reverse_direction(flow);
+
+    if (reverse_flow != NULL && timercmp(&(reverse_flow->last), &(flow->last), >))
+    {
+        return &(reverse_flow->last);
+    }
+
+    return &(flow->last);
+}
+
+/*
+ * The helper function for fitting a 64-bit counter into the 32-bit field
+ * of the NetFlow v5 record. The counter saturates instead of wrapping.
+ *
+ * @param counter The flow counter.
+ * @return        The value of the record field.
+ */
+static uint32_t v5_counter (uint64_t counter)
+{
+    return (counter > UINT32_MAX) ? UINT32_MAX : (uint32_t) counter;
+}
+
+/*
+ * The helper function for fitting a 4-byte AS number into the 2-byte field
+ * of the NetFlow v5 record (RFC 6793).
+ *
+ * @param as The AS number.
+ * @return   The value of the record field.
+ */
+static uint16_t v5_as (uint32_t as)
+{
+    return (as > UINT16_MAX) ? ROUTING_AS_TRANS : (uint16_t) as;
+}
+
+/*
+ * The helper function for filling a NetFlow record of one direction
+ * of a flow. The record is filled in the host byte order, the records
+ * of a datagram are converted together by the encoder.
+ *
+ * @param flow_record The filled record.
+ * @param flow        The exported flow.
+ * @param first_us    The time of the first packet in microseconds.
+ * @param reverse     The reverse direction of the biflow is filled.
+ */
+static void fill_flow_record (netflow_v5_flow_record_t flow_record,
+                              flow_node_t flow,
+                              int64_t first_us,
+                              bool reverse)
+{
+    flow_reverse_t reverse_flow = reverse ? flow_reverse_direction(flow) : NULL;
+
+    if (reverse_flow != NULL)
+    {
+        flow_record->src_addr = flow->dst_addr;
+        flow_record->dst_addr = flow->src_addr;
+        flow_record->packets = v5_counter(reverse_flow->packets);
+        flow_record->octets = v5_counter(reverse_flow->octets);
+
+        flow_record->first = encoder_time_ms(&(reverse_flow->first), first_us);
+        flow_record->last = encoder_time_ms(&(reverse_flow->last), first_us);
+
+        flow_record->src_port = flow->dst_port;
+        flow_record->dst_port = flow->src_port;
+        flow_record->tcp_flags = reverse_flow->tcp_flags;
+        flow_record->src_mask = flow->dst_mask;
+        flow_record->dst_mask = flow->src_mask;
+        flow_record->src_as = v5_as(flow->dst_as);
+        flow_record->dst_as = v5_as(flow->src_as);
+        flow_record->nexthop = reverse_flow->nexthop;
+    }
+    else
+    {
+        flow_record->src_addr = flow->src_addr;
+        flow_record->dst_addr = flow->dst_addr;
+        flow_record->packets = v5_counter(flow->packets);
+        flow_record->octets = v5_counter(flow->octets);
+
+        flow_record->first = encoder_time_ms(&(flow->first), first_us);
+        flow_record->last = encoder_time_ms(&(flow->last), first_us);
+
+        flow_record->src_port = flow->src_port;
+        flow_record->dst_port = flow->dst_port;
+        flow_record->tcp_flags = flow->tcp_flags;
+        flow_record->src_mask = flow->src_mask;
+        flow_record->dst_mask = flow->dst_mask;
+        flow_record->src_as = v5_as(flow->src_as);
+        flow_record->dst_as = v5_as(flow->dst_as);
+        flow_record->nexthop = flow->nexthop;
+    }
+
+    flow_record->prot = flow->prot;
+    flow_record->tos = flow->tos;
+
+    // The buffer is reused, so the unknown values are explicitly
+    // set to zero instead of clearing the whole datagram.
+    flow_record->input = 0;
+    flow_record->output = 0;
+    flow_record->pad1 = 0;
+    flow_record->pad2 = 0;
+}
+
+/*
+ * The helper function for updating the record of the wire format cache
+ * by a packet. The counters are kept in the network byte order
+ * and they saturate like the counters of the other records.
+ *
+ * @param record               The record of the flow.
+ * @param packet_layer_3_bytes The number of Layer 3 bytes in the packet.
+ * @param packet_tcp_flags     TCP flags of the packet.
+ * @param last_ms              The time of the packet since the first packet.
+ */
+static void update_wire_record (netflow_v5_flow_record_t record,
+                                const uint16_t packet_layer_3_bytes,
+                                const uint8_t packet_tcp_flags,
+                                const uint32_t last_ms)
+{
+    uint32_t packets = ntohl(record->packets);
+    uint32_t octets = ntohl(record->octets);
+
+    record->packets = htonl((packets < UINT32_MAX) ? packets + 1 : packets);
+    record->octets = htonl((octets <= UINT32_MAX - packet_layer_3_bytes) ?
+                           octets + packet_layer_3_bytes : UINT32_MAX);
+    record->tcp_flags |= packet_tcp_flags;
+    record->last = htonl(last_ms);
+}
+
+/*
+ * The helper function for sending the records of a datagram. The records
+ * are either filled in the datagram buffer or gathered from the cache
+ * entries of the wire format cache.
+ *
+ * @param netflow_records Pointer to the netflow recording system.
+ * @param sending_system  Pointer to the sending system.
+ * @param records         The gathered records or NULL.
+ * @param records_number  The number of records.
  * @return                Status of function processing.
  */
-uint8_t export_flows (netflow_recording_system_t netflow_records,
-                      netflow_sending_system_t sending_system,
-                      flow_node_t* flows,
-                      const uint16_t flows_number)
+static uint8_t send_flow_records (netflow_recording_system_t netflow_records,
+                                  netflow_sending_system_t sending_system,
+                                  netflow_v5_flow_record_t* records,
+                                  const uint16_t records_number)
 {
-    static uint32_t flow_sequence_number = 0;
     const uint16_t version = 5;
     const size_t packet_size = (size_t) (sizeof(struct netflow_v5_header) +
-            flows_number * sizeof(struct netflow_v5_flow_record));
-    size_t offset;
+            records_number * sizeof(struct netflow_v5_flow_record));
     ssize_t return_code;
-    uint8_t packet[packet_size];
+    // Preallocated datagram buffer reused for every export.
+    uint8_t* packet = sending_system->packet_buffer;
     netflow_v5_header_t header;
-    netflow_v5_flow_record_t flow_record;
-
-    memset (&packet, '\0', sizeof(packet));
+    struct iovec parts[MAX_FLOWS_NUMBER + 1];
+    struct msghdr message;
 
     header = (netflow_v5_header_t) packet;
 
     header->version = htons(version);
-    header->count = htons(flows_number);
+    header->count = htons(records_number);
     header->sysuptime_ms = htonl(get_timeval_ms(netflow_records->last_packet_time,
                                                 netflow_records->first_packet_time));
     header->unix_secs = htonl(netflow_records->last_packet_time->tv_sec);
     header->unix_nsecs = htonl(netflow_records->last_packet_time->tv_usec * 1000);
-    header->flow_sequence = htonl(flow_sequence_number);
-    // header->engine_type, header->engine_id and header->sampling_interval
-    // are left zero.
+    header->flow_sequence = htonl(netflow_records->flow_sequence_number);
+    header->engine_type = 0;
+    header->engine_id = 0;
+    // The sampling mode and interval let the collector scale the counters.
+    header->sampling_interval = htons(sampling_header_value(netflow_records->sampling));
 
-    for (uint16_t i = 0; i < flows_number; i++)
+    // Send packet
+    if (records == NULL)
     {
-        offset = sizeof(*header) + i * sizeof(*flow_record);
-
-        flow_record = (netflow_v5_flow_record_t) (packet + offset);
+        return_code = send(*(sending_system->socket), packet, packet_size, 0);
+    }
+    else
+    {
+        // The header is followed by the records in the cache entries.
+        parts[0].iov_base = packet;
+        parts[0].iov_len = sizeof(struct netflow_v5_header);
 
-        flow_record->src_addr = flows[i]->src_addr;
-        flow_record->dst_addr = flows[i]->dst_addr;
-        flow_record->packets = htonl(flows[i]->packets);
-        flow_record->octets = htonl(flows[i]->octets);
+        for (uint16_t i = 0; i < records_number; i++)
+        {
+            parts[i + 1].iov_base = records[i];
+            parts[i + 1].iov_len = sizeof(struct netflow_v5_flow_record);
+        }
 
-        flow_record->first = htonl(get_timeval_ms(flows[i]->first,
-                                                  netflow_records->first_packet_time));
-        flow_record->last = htonl(get_timeval_ms(flows[i]->last,
-                                                 netflow_records->first_packet_time));
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = parts;
+        message.msg_iovlen = records_number + 1;
 
-        flow_record->src_port = htons(flows[i]->src_port);
-        flow_record->dst_port = htons(flows[i]->dst_port);
-        flow_record->tcp_flags = flows[i]->tcp_flags;
-        flow_record->prot = flows[i]->prot;
-        flow_record->tos = flows[i]->tos;
-        // The rest of values are left zero.
+        return_code = sendmsg(*(sending_system->socket), &message, 0);
     }
 
-    // Send packet
-    return_code = send(*(sending_system->socket), packet, packet_size, 0);
-
     if (return_code == -1 || (size_t)return_code != packet_size)
     {
         // Send failed.
         return PACKET_SENDING_ERROR;
     }
 
-    flow_sequence_number += flows_number;
+    netflow_records->flow_sequence_number += records_number;
+
+    // Update statistics.
+    *(netflow_records->flows_statistics) += (uint64_t)records_number;
+    *(netflow_records->sent_packets_statistics) += 1;
+
+    return NO_ERROR;
+}
+
+/*
+ * Function for exporting flows to collector. A biflow is exported
+ * as two records, one per direction, so the flows of a batch may be sent
+ * in more datagrams. With the IPFIX export, the records are packed
+ * by the IPFIX exporter. The flows are written to the flow file,
+ * the Arrow file and the flow store first, their records are counted
+ * only without the collector.
+ *
+ * @param netflow_records Pointer to pointer to the netflow recording system.
+ * @param sending_system  Pointer to pointer to the sending system.
+ * @param flows           An array of flows to export.
+ * @param flows_number    The number of flows in the array of flows to export.
+ * @return                Status of function processing.
+ */
+uint8_t export_flows (netflow_recording_system_t netflow_records,
+                      netflow_sending_system_t sending_system,
+                      flow_node_t* flows,
+                      const uint16_t flows_number)
+{
+    uint8_t status = NO_ERROR;
+    uint16_t records_number = 0;
+    uint64_t file_records = 0;
+    netflow_v5_flow_record_t flow_record;
+    int64_t first_us;
+    uint64_t start_ns;
+
+    if (sending_system->sink != NULL)
+    {
+        file_records = sending_system->sink->records_number;
+        status = sink_write_flows(sending_system->sink, flows, flows_number);
+        file_records = sending_system->sink->records_number - file_records;
+
+        if (status != NO_ERROR)
+        {
+            return status;
+        }
+    }
+
+    if (sending_system->arrow != NULL)
+    {
+        file_records = sending_system->arrow->records_number;
+        status = arrow_write_flows(sending_system->arrow, flows, flows_number);
+        file_records = sending_system->arrow->records_number - file_records;
+
+        if (status != NO_ERROR)
+        {
+            return status;
+        }
+    }
+
+    if (sending_system->store != NULL)
+    {
+        file_records = sending_system->store->records_number;
+        status = store_write_flows(sending_system->store, flows, flows_number);
+        file_records = sending_system->store->records_number - file_records;
+
+        if (status != NO_ERROR)
+        {
+            return status;
+        }
+    }
+
+    if (!sending_system->collector_connected)
+    {
+        // Update statistics.
+        *(netflow_records->flows_statistics) += file_records;
+        // Update the cached flows number.
+        *(netflow_records->cached_flows_number) -= (uint64_t)flows_number;
+
+        return NO_ERROR;
+    }
+
+    if (sending_system->ipfix != NULL)
+    {
+        return ipfix_export_flows(netflow_records, sending_system, flows, flows_number);
+    }
+
+    flow_record = (netflow_v5_flow_record_t) (sending_system->packet_buffer +
+                                              sizeof(struct netflow_v5_header));
+
+    // The time of the first packet is converted once for the batch.
+    first_us = (int64_t) netflow_records->first_packet_time->tv_sec * 1000000 +
+               netflow_records->first_packet_time->tv_usec;
+    start_ns = encoder_clock_ns();
+
+    for (uint16_t i = 0; i < flows_number && status == NO_ERROR; i++)
+    {
+        // The initiator direction, then the reverse direction of a biflow.
+        for (uint8_t direction = 0; direction < 2 && status == NO_ERROR; direction++)
+        {
+            if (direction == 1 && flow_reverse_direction(flows[i]) == NULL)
+            {
+                break;
+            }
+
+            if (records_number == MAX_FLOWS_NUMBER)
+            {
+                encoder_finish(sending_system->encoder, flow_record, records_number, start_ns);
+                status = send_flow_records(netflow_records, sending_system, NULL, records_number);
+                records_number = 0;
+                start_ns = encoder_clock_ns();
+            }
+
+            fill_flow_record(&(flow_record[records_number]),
+                             flows[i],
+                             first_us,
+                             direction == 1);
+            records_number++;
+        }
+    }
+
+    if (status == NO_ERROR)
+    {
+        encoder_finish(sending_system->encoder, flow_record, records_number, start_ns);
+        status = send_flow_records(netflow_records, sending_system, NULL, records_number);
+    }
+
+    if (status != NO_ERROR)
+    {
+        return status;
+    }
 
     // Update the cached flows number.
     *(netflow_records->cached_flows_number) -= (uint64_t)flows_number;
 
-    // Update statistics.
-    *(netflow_records->flows_statistics) += (uint64_t)flows_number;
-    *(netflow_records->sent_packets_statistics) += 1;
+    return NO_ERROR;
+}
+
+/*
+ * Function for exporting the records of the wire format cache to collector.
+ * The records are sent from the cache entries without any conversion.
+ *
+ * @param netflow_records Pointer to pointer to the netflow recording system.
+ * @param sending_system  Pointer to pointer to the sending system.
+ * @param records         An array of records to export.
+ * @param records_number  The number of records in the array.
+ * @return                Status of function processing.
+ */
+uint8_t export_wire_records (netflow_recording_system_t netflow_records,
+                             netflow_sending_system_t sending_system,
+                             netflow_v5_flow_record_t* records,
+                             const uint16_t records_number)
+{
+    uint8_t status = NO_ERROR;
+    uint16_t datagram_records;
+    uint16_t sent_records = 0;
+
+    do
+    {
+        datagram_records = (records_number - sent_records < MAX_FLOWS_NUMBER) ?
+                           records_number - sent_records : MAX_FLOWS_NUMBER;
+
+        status = send_flow_records(netflow_records, sending_system,
+                                   records + sent_records, datagram_records);
+        sent_records += datagram_records;
+    } while (status == NO_ERROR && sent_records < records_number);
+
+    if (status != NO_ERROR)
+    {
+        return status;
+    }
+
+    // Update the cached flows number.
+    *(netflow_records->cached_flows_number) -= (uint64_t)records_number;
 
     return NO_ERROR;
 }
@@ -188,54 +496,170 @@ uint8_t export_expired_flows (netflow_recording_system_t netflow_records,
                               struct timeval* packet_time_stamp,
                               options_t options)
 {
-    uint8_t status;
-    bst_node_t expired_flows_tree;
-
-    bst_init(&expired_flows_tree);
-
-    // Add expired flows into the expired flows tree.
-    status = bst_find_expired(&(netflow_records->tree),
-                              &expired_flows_tree,
-                              packet_time_stamp,
-                              options);
-
-    if (status != NO_ERROR)
-    {
-        return status;
-    }
+    uint8_t status = cache_export_expired(netflow_records,
+                                          sending_system,
+                                          packet_time_stamp,
+                                          options);
 
-    // Export all flows from the expired flows tree by the oldest one.
-    status = bst_export_all(netflow_records, sending_system, &expired_flows_tree);
-
-    if (status != NO_ERROR)
+    // The IPFIX records wait in the message at most IPFIX_FLUSH_MS.
+    if (status == NO_ERROR && sending_system->ipfix != NULL)
     {
-        bst_dispose(&(netflow_records->tree));
+        status = ipfix_flush(netflow_records, sending_system, false);
     }
 
     return status;
 }
 
 /*
- * Function for exporting all active cached flows and disposing of a tree.
+ * Function for exporting all active cached flows.
  *
  * @param netflow_records   Pointer to pointer to the netflow recording system.
  * @param sending_system    Pointer to pointer to the sending system.
  * @return                  Status of function processing.
  */
-uint8_t export_all_flows_dispose_tree (netflow_recording_system_t netflow_records,
-                                       netflow_sending_system_t sending_system)
+uint8_t export_all_flows (netflow_recording_system_t netflow_records,
+                          netflow_sending_system_t sending_system)
 {
     uint8_t status = NO_ERROR;
-    bst_node_t* tree = &(netflow_records->tree);
 
-    if (tree != NULL)
+    if (netflow_records->cache != NULL)
     {
-        status = bst_export_all(netflow_records , sending_system, tree);
+        status = cache_export_all(netflow_records, sending_system);
+    }
+
+    if (status == NO_ERROR && sending_system != NULL && sending_system->ipfix != NULL)
+    {
+        status = ipfix_flush(netflow_records, sending_system, true);
     }
 
     return status;
 }
 
+/*
+ * The helper function for filling the AS numbers, masks and next hops
+ * of a new flow by the longest prefix match. The masks of the aggregation
+ * scheme are kept.
+ *
+ * @param routing      Pointer to the routing table.
+ * @param flow         The new flow.
+ * @param reverse_flow The reverse direction state of a biflow or NULL.
+ */
+static void route_flow (routing_table_t routing, flow_node_t flow, flow_reverse_t reverse_flow)
+{
+    route_t src_route = routing_lookup(routing, flow->src_addr);
+    route_t dst_route = routing_lookup(routing, flow->dst_addr);
+
+    if (src_route != NULL)
+    {
+        flow->src_as = src_route->as;
+
+        if (reverse_flow != NULL)
+        {
+            reverse_flow->nexthop = src_route->nexthop;
+        }
+
+        if (flow->src_mask == 0)
+        {
+            flow->src_mask = src_route->mask;
+        }
+    }
+
+    if (dst_route != NULL)
+    {
+        flow->dst_as = dst_route->as;
+        flow->nexthop = dst_route->nexthop;
+
+        if (flow->dst_mask == 0)
+        {
+            flow->dst_mask = dst_route->mask;
+        }
+    }
+}
+
+/*
+ * The helper function for computing the next TCP state of a flow.
+ *
+ * @param state     The current TCP state.
+ * @param tcp_flags TCP flags of the current packet.
+ * @return          The next TCP state.
+ */
+static uint8_t tcp_next_state (uint8_t state, uint8_t tcp_flags)
+{
+    if (state == TCP_STATE_CLOSED || (tcp_flags & TH_RST))
+    {
+        return TCP_STATE_CLOSED;
+    }
+
+    if (state == TCP_STATE_FIN_WAIT || (tcp_flags & TH_FIN))
+    {
+        return TCP_STATE_FIN_WAIT;
+    }
+
+    if (state == TCP_STATE_ESTABLISHED)
+    {
+        return TCP_STATE_ESTABLISHED;
+    }
+
+    if (tcp_flags & TH_SYN)
+    {
+        return (tcp_flags & TH_ACK) ? TCP_STATE_SYN_ACK : TCP_STATE_SYN;
+    }
+
+    // The first ACK after the handshake, or a flow seen in the middle.
+    if (tcp_flags & TH_ACK)
+    {
+        return TCP_STATE_ESTABLISHED;
+    }
+
+    return state;
+}
+
+/*
+ * The helper function for tracking the TCP state of a flow. The flow
+ * is moved to the timeout class of its state. The reset flow is exported
+ * by the next expiry check, the flow with FIN waits for the last ACKs
+ * for the FIN-wait timeout.
+ *
+ * @param cache     Pointer to the flow cache.
+ * @param entry     The updated entry.
+ * @param tcp_flags TCP flags of the current packet.
+ * @param options   Pointer to options storage.
+ */
+static void tcp_track_state (flow_cache_t cache,
+                             flow_entry_t entry,
+                             uint8_t tcp_flags,
+                             options_t options)
+{
+    uint8_t state = tcp_next_state(entry->tcp_state, tcp_flags);
+
+    if (state == entry->tcp_state)
+    {
+        return;
+    }
+
+    entry->tcp_state = state;
+
+    switch (state)
+    {
+        case TCP_STATE_SYN:
+        case TCP_STATE_SYN_ACK:
+            cache_set_class(cache, entry, CACHE_HALF_OPEN_CLASS);
+            break;
+        case TCP_STATE_ESTABLISHED:
+            cache_set_class(cache, entry, cache_timeout_class(options->timeout_classes,
+                                                              &(entry->key)));
+            break;
+        case TCP_STATE_FIN_WAIT:
+            cache_set_class(cache, entry, CACHE_FIN_WAIT_CLASS);
+            break;
+        case TCP_STATE_CLOSED:
+            cache_close(cache, entry);
+            break;
+        default:
+            break;
+    }
+}
+
 /*
  * Function for handling the new packet. The function finds the flow
  * with the same parameters as the packet or creates a new one.
@@ -247,6 +671,8 @@ uint8_t export_all_flows_dispose_tree (netflow_recording_system_t netflow_record
  * @param packet_time_stamp    Current packet time stamp.
  * @param packet_layer_3_bytes The number of Layer 3 bytes in the packet.
  * @param packet_tcp_flags     TCP flags of the current packet.
+ * @param reverse              The packet is in the reverse direction
+ *                             of the canonical key.
  * @param options              Pointer to options storage.
  * @return                     Status of function processing.
  */
@@ -256,108 +682,289 @@ uint8_t find_flow (netflow_recording_system_t netflow_records,
                    const struct timeval* packet_time_stamp,
                    const uint16_t packet_layer_3_bytes,
                    const uint8_t packet_tcp_flags,
+                   const bool reverse,
                    options_t options)
 {
     static const uint64_t id_mask = UINT64_MAX >> 1;
-    static uint64_t cache_id = 0;
     uint8_t status = NO_ERROR;
+    flow_cache_t cache = netflow_records->cache;
     flow_node_t flow = NULL;
-    bst_node_t* flows_tree = &(netflow_records->tree);
+    flow_reverse_t reverse_flow = NULL;
+    wire_flow_t wire_flow = NULL;
+    struct flow_node wire_node;
+    flow_entry_t entry;
+    uint32_t hash;
+    struct netflow_v5_key mice_key;
+    bool mice = false;
+    bool initiator;
+    uint8_t tcp_flags;
+    uint8_t reverse_tcp_flags;
+    // The times of the wire format records are relative to the first packet.
+    int64_t first_us = (int64_t) netflow_records->first_packet_time->tv_sec * 1000000 +
+                       netflow_records->first_packet_time->tv_usec;
+
+    // The key is reduced to the fields of the aggregation scheme,
+    // so the aggregated flows share one cache entry.
+    aggregate_key(packet_key, options->aggregation->scheme);
+
+    hash = cache_hash(cache, packet_key);
+    entry = cache_search(cache, packet_key, hash);
+
+    // The flows not selected by the flow sampling are never cached. Only
+    // the new flows are selected, so a cached flow keeps all its packets
+    // when the load shedding changes the interval.
+    if (entry == NULL && !sampling_keep_flow(netflow_records->sampling, hash))
+    {
+        return NO_ERROR;
+    }
+
+    // A new flow is cached only when it is admitted. The packets of the other
+    // flows are aggregated into the summary flow of their protocol, so scans
+    // and floods do not evict the cached flows.
+    if (entry == NULL &&
+        netflow_records->admission != NULL &&
+        !admission_admit(netflow_records->admission,
+                         hash,
+                         packet_time_stamp,
+                         packet_layer_3_bytes))
+    {
+        memset(&mice_key, 0, sizeof(mice_key));
+        mice_key.prot = packet_key->prot;
+
+        packet_key = &mice_key;
+        mice = true;
+
+        hash = cache_hash(cache, packet_key);
+        entry = cache_search(cache, packet_key, hash);
+    }
 
-    if (!bst_search(*flows_tree, packet_key, &flow))
+    if (entry == NULL)
     {
         // Matching flow does not exist.
         // A new flow will be created and inserted.
-        flow_node_t new_flow = NULL;
-        netflow_v5_key_t new_key = NULL;
-
-        status = allocate_netflow_key(&new_key);
+        *(netflow_records->cached_flows_number) += 1;
 
-        if (status != EXIT_SUCCESS)
+        if (*(netflow_records->cached_flows_number) >
+        options->cached_entries_number->entries_number)
         {
-            return MEMORY_HANDLING_ERROR;
+            status = cache_export_oldest(netflow_records, sending_system);
+
+            if (status != NO_ERROR)
+            {
+                return status;
+            }
         }
 
-        status = allocate_flow_node(&new_flow);
+        entry = cache_insert(cache,
+                             packet_key,
+                             hash,
+                             cache_timeout_class(options->timeout_classes, packet_key));
 
-        if (status != EXIT_SUCCESS)
+        if (entry == NULL)
         {
             return MEMORY_HANDLING_ERROR;
         }
 
-        // Set flow key values.
-        new_key->src_addr = packet_key->src_addr;
-        new_key->dst_addr = packet_key->dst_addr;
+        // The wire format flow is built aside, only its record is cached.
+        if (cache->layout == CACHE_LAYOUT_WIRE)
+        {
+            flow = &wire_node;
+        }
+        else
+        {
+            flow = cache_flow(entry);
+        }
 
-        new_key->src_port = packet_key->src_port;
-        new_key->dst_port = packet_key->dst_port;
+        // Set flow record values. The sender of the first packet
+        // is the initiator of a biflow.
+        if (reverse)
+        {
+            flow->src_addr = packet_key->dst_addr;
+            flow->dst_addr = packet_key->src_addr;
 
-        new_key->prot = packet_key->prot;
-        new_key->tos = packet_key->tos;
+            flow->src_port = packet_key->dst_port;
+            flow->dst_port = packet_key->src_port;
+        }
+        else
+        {
+            flow->src_addr = packet_key->src_addr;
+            flow->dst_addr = packet_key->dst_addr;
 
-        // Unknown set as zero.
-        new_key->input = 0;
+            flow->src_port = packet_key->src_port;
+            flow->dst_port = packet_key->dst_port;
+        }
+
+        flow->prot = packet_key->prot;
 
-        // Set flow record values.
-        new_flow->src_addr = packet_key->src_addr;
-        new_flow->dst_addr = packet_key->dst_addr;
+        flow->tos = packet_key->tos;
 
-        new_flow->src_port = packet_key->src_port;
-        new_flow->dst_port = packet_key->dst_port;
+        aggregation_masks(options->aggregation->scheme, &(flow->src_mask), &(flow->dst_mask));
 
-        new_flow->prot = packet_key->prot;
+        flow->src_as = 0;
+        flow->dst_as = 0;
+        flow->nexthop = 0;
+        flow->biflow = options->biflow_set;
+
+        if (flow->biflow)
+        {
+            // The reverse direction is counted from its first packet.
+            reverse_flow = flow_reverse_of(flow);
+            memset(reverse_flow, 0, sizeof(*reverse_flow));
+        }
 
-        new_flow->tos = packet_key->tos;
+        // The routing is looked up once per flow, not per packet.
+        if (netflow_records->routing != NULL)
+        {
+            route_flow(netflow_records->routing, flow, reverse_flow);
+        }
 
-        new_flow->tcp_flags = packet_tcp_flags;
+        flow->tcp_flags = packet_tcp_flags;
 
         // Set other specific values.
-        new_flow->packets = 1;
-        new_flow->octets = packet_layer_3_bytes;
+        flow->packets = 1;
+        flow->octets = packet_layer_3_bytes;
 
-        memcpy(new_flow->first, packet_time_stamp, sizeof(*(new_flow->first)));
-        memcpy(new_flow->last, packet_time_stamp, sizeof(*(new_flow->last)));
+        memcpy(&(flow->first), packet_time_stamp, sizeof(flow->first));
+        memcpy(&(flow->last), packet_time_stamp, sizeof(flow->last));
 
-        *(netflow_records->cached_flows_number) += 1;
+        flow->cache_id = netflow_records->next_cache_id;
 
-        if (*(netflow_records->cached_flows_number) >
-        options->cached_entries_number->entries_number)
+        if (cache->layout == CACHE_LAYOUT_WIRE)
         {
-            status = bst_export_oldest(netflow_records, sending_system, flows_tree);
+            wire_flow = cache_wire(entry);
+
+            fill_flow_record(&(wire_flow->record), flow, first_us, false);
+            sending_system->encoder->swap(&(wire_flow->record), 1);
+
+            memcpy(&(wire_flow->first), packet_time_stamp, sizeof(wire_flow->first));
+            memcpy(&(wire_flow->last), packet_time_stamp, sizeof(wire_flow->last));
         }
 
-        if (status == NO_ERROR)
-        {
-            new_flow->cache_id = cache_id;
+        // Update the next id value.
+        netflow_records->next_cache_id = (netflow_records->next_cache_id + 1) & id_mask;
+    }
+    else if (cache->layout == CACHE_LAYOUT_WIRE)
+    {
+        // Matching flow does was found. The wire format flows
+        // have no reverse direction, the record is updated in place.
+        wire_flow = cache_wire(entry);
+
+        update_wire_record(&(wire_flow->record),
+                           packet_layer_3_bytes,
+                           packet_tcp_flags,
+                           encoder_time_ms(packet_time_stamp, first_us));
+
+        memcpy(&(wire_flow->last), packet_time_stamp, sizeof(wire_flow->last));
+
+        cache_touch(cache, entry);
+    }
+    else
+    {
+        // Matching flow does was found.
+        // Update flow record.
+        flow = cache_flow(entry);
 
-            // Add flow into the flows tree.
-            status = bst_insert(flows_tree, new_key, new_flow);
+        // The packet goes from the initiator, if it is sent from the source
+        // of the flow. The key of a reverse packet is swapped.
+        initiator = (reverse ? packet_key->dst_addr : packet_key->src_addr) == flow->src_addr &&
+                    (reverse ? packet_key->dst_port : packet_key->src_port) == flow->src_port;
 
-            // Update the next id value.
-            cache_id = (cache_id + 1) & id_mask;
+        if (initiator)
+        {
+            flow->packets += 1;
+            flow->octets += packet_layer_3_bytes;
+            flow->tcp_flags |= packet_tcp_flags;
+
+            memcpy(&(flow->last), packet_time_stamp, sizeof(flow->last));
         }
         else
         {
-            free_netflow_key(&new_key);
-            free_flow_node(&new_flow);
+            // Only the biflows have the packets of the other direction.
+            reverse_flow = flow_reverse_of(flow);
+
+            if (reverse_flow->packets == 0)
+            {
+                memcpy(&(reverse_flow->first), packet_time_stamp, sizeof(reverse_flow->first));
+            }
 
-            bst_dispose(flows_tree);
+            reverse_flow->packets += 1;
+            reverse_flow->octets += packet_layer_3_bytes;
+            reverse_flow->tcp_flags |= packet_tcp_flags;
+
+            memcpy(&(reverse_flow->last), packet_time_stamp, sizeof(reverse_flow->last));
         }
+
+        cache_touch(cache, entry);
+    }
+
+    // The summary flow of the mice and the aggregated flows
+    // are expired only by the timers.
+    if (mice || options->aggregation->scheme != AGGREGATION_NONE)
+    {
+        return status;
+    }
+
+    if (wire_flow != NULL)
+    {
+        tcp_flags = wire_flow->record.tcp_flags;
+        reverse_tcp_flags = 0;
     }
     else
     {
-        // Matching flow does was found.
-        // Update flow record.
-        flow->packets += 1;
-        flow->octets += packet_layer_3_bytes;
-        flow->tcp_flags |= packet_tcp_flags;
+        tcp_flags = flow->tcp_flags;
+        reverse_flow = flow_reverse_direction(flow);
+        reverse_tcp_flags = (reverse_flow != NULL) ? reverse_flow->tcp_flags : 0;
+    }
 
-        memcpy(flow->last, packet_time_stamp, sizeof(*(flow->last)));
+    if (options->tcp_state_timeouts->is_user_set)
+    {
+        if (entry->key.prot == IPPROTO_TCP)
+        {
+            tcp_track_state(cache, entry, packet_tcp_flags, options);
+        }
+    }
+    else if (((tcp_flags | reverse_tcp_flags) & TH_RST) ||
+             ((tcp_flags & TH_FIN) &&
+              (!options->biflow_set || (reverse_tcp_flags & TH_FIN))))
+    {
+        // The finished TCP flow is exported by the next expiry check.
+        // A biflow is finished by the FIN of both directions.
+        cache_close(cache, entry);
     }
 
     return status;
 }
 
+/*
+ * The helper function for the canonical key of a biflow. The lower address
+ * (and the lower port for the same addresses) is the source, so both
+ * directions of a conversation have the same key.
+ *
+ * @param key Pointer to the key of a packet.
+ * @return    True if the addresses and ports of the key were swapped.
+ */
+static bool canonicalize_key (netflow_v5_key_t key)
+{
+    uint32_t addr;
+    uint16_t port;
+
+    if (ntohl(key->src_addr) < ntohl(key->dst_addr) ||
+        (key->src_addr == key->dst_addr && key->src_port <= key->dst_port))
+    {
+        return false;
+    }
+
+    addr = key->src_addr;
+    key->src_addr = key->dst_addr;
+    key->dst_addr = addr;
+
+    port = key->src_port;
+    key->src_port = key->dst_port;
+    key->dst_port = port;
+
+    return true;
+}
+
 /*
  * Function for handling and processing packet data including calls of functions
  * responsible for managing flows.
@@ -375,6 +982,7 @@ uint8_t find_flow (netflow_recording_system_t netflow_records,
  * @param sending_system    Pointer to pointer to the sending system.
  * @param header            Packet header data.
  * @param packet            Packet body data.
+ * @param layer_3_offset    The offset of the IPv4 header in the packet.
  * @param options           Pointer to options storage.
  * @return                  Status of function processing.
  */
@@ -382,28 +990,32 @@ uint8_t process_packet (netflow_recording_system_t netflow_records,
                         netflow_sending_system_t sending_system,
                         const struct pcap_pkthdr* header,
                         const u_char* packet,
+                        const uint32_t layer_3_offset,
                         options_t options)
 {
-    static bool first_packet = true;
     struct ip* my_ip = NULL;
     const struct tcphdr* my_tcp = NULL; // Pointer to the beginning of TCP header.
     const struct udphdr* my_udp = NULL; // Pointer to the beginning of UDP header.
     const struct icmp* my_icmp = NULL;
-    netflow_v5_key_t packet_key = NULL;
+    // The lookup key lives on the stack, it is copied only when a new flow
+    // is created.
+    struct netflow_v5_key packet_key_storage;
+    netflow_v5_key_t packet_key = &packet_key_storage;
     u_int size_ip = 0;
     uint8_t tcp_flags = 0;
     uint8_t status = NO_ERROR;
-    uint16_t packet_layer_3_bytes = header->len - SIZE_ETHERNET;
+    bool reverse = false;
+    uint16_t packet_layer_3_bytes = header->len - layer_3_offset;
     // Time stamp of an actual received packet
     struct timeval packet_time_stamp = header->ts;
 
-    if (first_packet)
+    if (!netflow_records->first_packet_seen)
     {
         memcpy(netflow_records->first_packet_time,
                &packet_time_stamp,
                sizeof(*(netflow_records->first_packet_time)));
 
-        first_packet = false;
+        netflow_records->first_packet_seen = true;
     }
 
     memcpy(netflow_records->last_packet_time,
@@ -422,15 +1034,15 @@ uint8_t process_packet (netflow_recording_system_t netflow_records,
         return status;
     }
 
-    status = allocate_netflow_key(&packet_key);
-
-    if (status != NO_ERROR)
+    // The packets not selected by the packet sampling are not parsed at all,
+    // the timers are still driven by their time stamps.
+    if (!sampling_keep_packet(netflow_records->sampling))
     {
-        return MEMORY_HANDLING_ERROR;
+        return NO_ERROR;
     }
 
-    my_ip = (struct ip*) (packet+SIZE_ETHERNET); // Skip Ethernet header.
-    size_ip = my_ip->ip_hl*4;                    // Length of IP header.
+    my_ip = (struct ip*) (packet + layer_3_offset); // Skip the link layer headers.
+    size_ip = my_ip->ip_hl*4;                       // Length of IP header.
 
     packet_key->input = 0;
     packet_key->tos = my_ip->ip_tos;
@@ -444,7 +1056,7 @@ uint8_t process_packet (netflow_recording_system_t netflow_records,
 
     switch (my_ip->ip_p){
         case IPPROTO_ICMP: // ICMP protocol (ICMPv4)
-            my_icmp = (struct icmp *) (packet + SIZE_ETHERNET + size_ip);
+            my_icmp = (struct icmp *) (packet + layer_3_offset + size_ip);
 
             packet_key->src_port = 0;
 
@@ -464,45 +1076,56 @@ uint8_t process_packet (netflow_recording_system_t netflow_records,
                                &packet_time_stamp,
                                packet_layer_3_bytes,
                                tcp_flags,
+                               reverse,
                                options);
             break;
         case IPPROTO_TCP: // TCP protocol
             // Pointer to the TCP header.
-            my_tcp = (struct tcphdr *) (packet + SIZE_ETHERNET + size_ip);
+            my_tcp = (struct tcphdr *) (packet + layer_3_offset + size_ip);
 
             packet_key->src_port = ntohs(my_tcp->th_sport);
             packet_key->dst_port = ntohs(my_tcp->th_dport);
 
             tcp_flags = my_tcp->th_flags;
 
+            if (options->biflow_set)
+            {
+                reverse = canonicalize_key(packet_key);
+            }
+
             status = find_flow(netflow_records,
                                sending_system,
                                packet_key,
                                &packet_time_stamp,
                                packet_layer_3_bytes,
                                tcp_flags,
+                               reverse,
                                options);
             break;
         case IPPROTO_UDP: // UDP protocol
             // Pointer to the UDP header.
-            my_udp = (struct udphdr *) (packet+SIZE_ETHERNET+size_ip);
+            my_udp = (struct udphdr *) (packet + layer_3_offset + size_ip);
 
             packet_key->src_port = ntohs(my_udp->uh_sport);
             packet_key->dst_port = ntohs(my_udp->uh_dport);
 
+            if (options->biflow_set)
+            {
+                reverse = canonicalize_key(packet_key);
+            }
+
             status = find_flow(netflow_records,
                                sending_system,
                                packet_key,
                                &packet_time_stamp,
                                packet_layer_3_bytes,
                                tcp_flags,
+                               reverse,
                                options);
             break;
         default:
             break;
     }
 
-    free_netflow_key(&packet_key);
-
     return status;
 }
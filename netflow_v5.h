@@ -13,11 +13,12 @@
 #define FLOW_NETFLOW_V5_H
 
 #include <pcap.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 
+#include "linktype.h"
 #include "option.h"
-#include "tree.h"
 
 #define MAX_FLOWS_NUMBER 30
 
@@ -25,10 +26,20 @@ typedef struct netflow_v5_header* netflow_v5_header_t;
 typedef struct netflow_v5_flow_record* netflow_v5_flow_record_t;
 typedef struct netflow_v5_key* netflow_v5_key_t;
 typedef struct flow_node* flow_node_t;
+typedef struct flow_reverse* flow_reverse_t;
+typedef struct wire_flow* wire_flow_t;
 typedef struct netflow_recording_system* netflow_recording_system_t;
 typedef struct netflow_sending_system* netflow_sending_system_t;
 
-struct bst_node; // Forward declaration
+struct flow_cache; // Forward declaration
+struct packet_sampling; // Forward declaration
+struct flow_admission; // Forward declaration
+struct routing_table; // Forward declaration
+struct ipfix_exporter; // Forward declaration
+struct flow_sink; // Forward declaration
+struct arrow_writer; // Forward declaration
+struct flow_store; // Forward declaration
+struct record_encoder; // Forward declaration
 
 /*
  * Structure to store a NetFlow header.
@@ -73,6 +84,12 @@ struct netflow_v5_flow_record
     uint16_t pad2;
 };
 
+/*
+ * The size of the largest exported datagram.
+ */
+#define MAX_PACKET_SIZE (sizeof(struct netflow_v5_header) + \
+                         MAX_FLOWS_NUMBER * sizeof(struct netflow_v5_flow_record))
+
 /*
  * Structure to store NetFlow key.
  */
@@ -88,35 +105,85 @@ struct netflow_v5_key
 };
 
 /*
- * Structure to store exported NetFlow records in format for a tree.
+ * Structure to store exported NetFlow records in format for the flow cache.
  */
 struct flow_node
 {
     uint32_t src_addr;
     uint32_t dst_addr;
-    uint32_t packets;
-    uint32_t octets;
-    struct timeval* first;
-    struct timeval* last;
+    uint64_t packets;
+    uint64_t octets;
+    struct timeval first;
+    struct timeval last;
     uint16_t src_port;
     uint16_t dst_port;
     uint8_t tcp_flags;
     uint8_t prot;
     uint8_t tos;
+    uint8_t src_mask;
+    uint8_t dst_mask;
+    bool biflow;               // The reverse direction follows the flow.
+    uint32_t src_as;
+    uint32_t dst_as;
+    uint32_t nexthop;          // The next hop to the destination.
     uint64_t cache_id;
 };
 
+/*
+ * Structure to store the reverse direction of a biflow, the addresses
+ * and ports of the flow are of the initiator. It follows the flow
+ * in the cache entries of the biflow mode (-b) only, so the other modes
+ * do not pay for it.
+ */
+struct flow_reverse
+{
+    uint64_t packets;  // Zero until the first reverse packet.
+    uint64_t octets;
+    struct timeval first;
+    struct timeval last;
+    uint32_t nexthop;  // The next hop to the source.
+    uint8_t tcp_flags;
+};
+
+/*
+ * Structure to store a flow of the wire format cache (-W). The record
+ * is kept as it is sent, the times of the first and the last packet
+ * are kept for the expiry.
+ */
+struct wire_flow
+{
+    struct timeval first;
+    struct timeval last;
+    struct netflow_v5_flow_record record;
+};
+
 /*
  * Structure to store the NetFlow recording system for the program.
  */
 struct netflow_recording_system
 {
-    struct bst_node* tree;
+    struct flow_cache* cache;
+    struct packet_sampling* sampling;
+    struct flow_admission* admission; // NULL if all new flows are cached.
+    struct routing_table* routing;    // NULL if no routing table is loaded.
     struct timeval* first_packet_time;
     struct timeval* last_packet_time;
     uint64_t* cached_flows_number;
     uint64_t* flows_statistics;
     uint64_t* sent_packets_statistics;
+    bool first_packet_seen;        // The first packet time is set.
+    uint64_t next_cache_id;        // The cache id of the next new flow.
+    uint32_t flow_sequence_number; // The records sent before the next datagram.
+    bool checkpointed;             // The cached flows are kept by the checkpoint.
+    // Only the flows which start in the time window are exported.
+    uint64_t window_from_ms;
+    uint64_t window_to_ms;
+    uint64_t window_dropped_flows; // The flows of the neighbouring windows.
+    uint64_t read_packets;         // The packets read from the input.
+    uint64_t filtered_packets;     // The packets rejected by the packet filter.
+    uint64_t processing_us;        // The wall time of reading the input.
+    const char* link_type_name;    // The link type of the input.
+    struct link_statistics link_statistics;
 };
 
 /*
@@ -125,6 +192,13 @@ struct netflow_recording_system
 struct netflow_sending_system
 {
     int* socket;
+    uint8_t* packet_buffer;
+    struct record_encoder* encoder; // The encoder of the NetFlow v5 records.
+    struct ipfix_exporter* ipfix; // NULL for the NetFlow v5 export.
+    struct flow_sink* sink;       // NULL if the flows are not written to a file.
+    struct arrow_writer* arrow;   // NULL if the flows are not written to an Arrow file.
+    struct flow_store* store;     // NULL if the flows are not written to a flow store.
+    bool collector_connected;     // False if the flows are only written to a file.
 };
 
 /*
@@ -139,7 +213,47 @@ struct netflow_sending_system
 int compare_flows (netflow_v5_key_t first_flow, netflow_v5_key_t second_flow);
 
 /*
- * Function for exporting flows to collector.
+ * Function for getting the time of the last packet of a flow
+ * in any direction.
+ *
+ * @param flow Pointer to the flow.
+ * @return     The time stamp of the last packet.
+ */
+const struct timeval* flow_last_seen (flow_node_t flow);
+
+/*
+ * Function for getting the reverse direction state of a biflow,
+ * which follows the flow in the cache entry.
+ *
+ * @param flow Pointer to the flow of the biflow mode.
+ * @return     The reverse direction state.
+ */
+static inline flow_reverse_t flow_reverse_of (flow_node_t flow)
+{
+    return (flow_reverse_t) (flow + 1);
+}
+
+/*
+ * Function for getting the reverse direction of a biflow.
+ *
+ * @param flow Pointer to the flow.
+ * @return     The reverse direction or NULL if no reverse packet was seen.
+ */
+static inline flow_reverse_t flow_reverse_direction (flow_node_t flow)
+{
+    if (!flow->biflow || flow_reverse_of(flow)->packets == 0)
+    {
+        return NULL;
+    }
+
+    return flow_reverse_of(flow);
+}
+
+/*
+ * Function for exporting flows to collector. A biflow is exported
+ * as two records, one per direction, so the flows of a batch may be sent
+ * in more datagrams. With the IPFIX export, the records are packed
+ * by the IPFIX exporter. The flows are written to the flow file first.
  *
  * @param netflow_records Pointer to pointer to the netflow recording system.
  * @param sending_system  Pointer to pointer to the sending system.
@@ -152,6 +266,21 @@ uint8_t export_flows (netflow_recording_system_t netflow_records,
                       flow_node_t* flows,
                       const uint16_t flows_number);
 
+/*
+ * Function for exporting the records of the wire format cache to collector.
+ * The records are sent from the cache entries without any conversion.
+ *
+ * @param netflow_records Pointer to pointer to the netflow recording system.
+ * @param sending_system  Pointer to pointer to the sending system.
+ * @param records         An array of records to export.
+ * @param records_number  The number of records in the array.
+ * @return                Status of function processing.
+ */
+uint8_t export_wire_records (netflow_recording_system_t netflow_records,
+                             netflow_sending_system_t sending_system,
+                             netflow_v5_flow_record_t* records,
+                             const uint16_t records_number);
+
 /*
  * Function for exporting expired flows to collector.
  *
@@ -167,18 +296,20 @@ uint8_t export_expired_flows (netflow_recording_system_t netflow_records,
                               options_t options);
 
 /*
- * Function for exporting all active cached flows and disposing of a tree.
+ * Function for exporting all active cached flows.
  *
  * @param netflow_records   Pointer to pointer to the netflow recording system.
  * @param sending_system    Pointer to pointer to the sending system.
  * @return                  Status of function processing.
  */
-uint8_t export_all_flows_dispose_tree (netflow_recording_system_t netflow_records,
-                                       netflow_sending_system_t sending_system);
+uint8_t export_all_flows (netflow_recording_system_t netflow_records,
+                          netflow_sending_system_t sending_system);
 
 /*
  * Function for handling the new packet. The function finds the flow
  * with the same parameters as the packet or creates a new one.
+ * In the biflow mode, the key is canonical and the reverse flag tells
+ * that the packet goes from the higher address to the lower one.
  *
  * @param netflow_records      Pointer to pointer to the netflow recording
  *                             system.
@@ -187,6 +318,8 @@ uint8_t export_all_flows_dispose_tree (netflow_recording_system_t netflow_record
  * @param packet_time_stamp    Current packet time stamp.
  * @param packet_layer_3_bytes The number of Layer 3 bytes in the packet.
  * @param packet_tcp_flags     TCP flags of the current packet.
+ * @param reverse              The packet is in the reverse direction
+ *                             of the canonical key.
  * @param options              Pointer to options storage.
  * @return                     Status of function processing.
  */
@@ -196,6 +329,7 @@ uint8_t find_flow (netflow_recording_system_t netflow_records,
                    const struct timeval* packet_time_stamp,
                    const uint16_t packet_layer_3_bytes,
                    const uint8_t packet_tcp_flags,
+                   const bool reverse,
                    options_t options);
 
 /*
@@ -206,6 +340,7 @@ uint8_t find_flow (netflow_recording_system_t netflow_records,
  * @param sending_system    Pointer to pointer to the sending system.
  * @param header            Packet header data.
  * @param packet            Packet body data.
+ * @param layer_3_offset    The offset of the IPv4 header in the packet.
  * @param options           Pointer to options storage.
  * @return                  Status of function processing.
  */
@@ -213,6 +348,7 @@ uint8_t process_packet (netflow_recording_system_t netflow_records,
                         netflow_sending_system_t sending_system,
                         const struct pcap_pkthdr* header,
                         const u_char* packet,
+                        const uint32_t layer_3_offset,
                         options_t options);
 
 #endif // FLOW_NETFLOW_V5_H
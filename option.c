@@ -11,13 +11,22 @@
 
 #include "option.h"
 
+#include <ctype.h>
+#include <getopt.h>
+#include <netinet/in.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+#include "aggregation.h"
+#include "arrow.h"
+#include "cache.h"
+#include "ipfix.h"
 #include "error.h"
 #include "memory.h"
+#include "sampling.h"
+#include "timeindex.h"
 #include "util.h"
 
 #define SET   true
@@ -41,6 +50,11 @@ uint8_t init_options (options_t* options)
 
     // Set default values of the variables of the structures.
     (*options)->help_set = UNSET;
+    (*options)->flow_arena_set = UNSET;
+    (*options)->lock_memory_set = UNSET;
+    (*options)->biflow_set = UNSET;
+    (*options)->store_compression_set = UNSET;
+    (*options)->wire_format_set = UNSET;
 
     (*options)->analyzed_input_source->is_user_set = UNSET;
     (*options)->analyzed_input_source->file_name = NULL;
@@ -57,89 +71,956 @@ uint8_t init_options (options_t* options)
     (*options)->cached_entries_number->is_user_set = UNSET;
     (*options)->cached_entries_number->entries_number = ENTRIES_NUMBER_MIN;
 
+    (*options)->cache_memory_budget->is_user_set = UNSET;
+    (*options)->cache_memory_budget->budget_bytes = 0;
+
+    (*options)->packet_sampling->is_user_set = UNSET;
+    (*options)->packet_sampling->mode = SAMPLING_NONE;
+    (*options)->packet_sampling->interval = 1;
+
+    (*options)->ingest_max_lag->is_user_set = UNSET;
+    (*options)->ingest_max_lag->lag_ms = 0;
+
+    (*options)->new_flow_admission->is_user_set = UNSET;
+    (*options)->new_flow_admission->packets = 1;
+    (*options)->new_flow_admission->octets = 0;
+
+    (*options)->aging_watermarks->is_user_set = UNSET;
+    (*options)->aging_watermarks->high_percent = 100;
+    (*options)->aging_watermarks->low_percent = 100;
+
+    (*options)->timeout_classes->is_user_set = UNSET;
+    (*options)->timeout_classes->classes_number = 0;
+
+    (*options)->tcp_state_timeouts->is_user_set = UNSET;
+    (*options)->tcp_state_timeouts->half_open_seconds = 0;
+    (*options)->tcp_state_timeouts->fin_wait_seconds = 0;
+
+    (*options)->aggregation->is_user_set = UNSET;
+    (*options)->aggregation->scheme = AGGREGATION_NONE;
+
+    (*options)->routing_table_source->is_user_set = UNSET;
+    (*options)->routing_table_source->file_name = NULL;
+
+    (*options)->export_format->is_user_set = UNSET;
+    (*options)->export_format->format = EXPORT_NETFLOW_V5;
+
+    (*options)->export_mtu->is_user_set = UNSET;
+    (*options)->export_mtu->mtu = MTU_DEFAULT;
+
+    (*options)->output_file_target->is_user_set = UNSET;
+    (*options)->output_file_target->file_name = NULL;
+
+    (*options)->arrow_file_target->is_user_set = UNSET;
+    (*options)->arrow_file_target->file_name = NULL;
+
+    (*options)->arrow_batch_size->is_user_set = UNSET;
+    (*options)->arrow_batch_size->rows = ARROW_BATCH_DEFAULT;
+
+    (*options)->flow_store_target->is_user_set = UNSET;
+    (*options)->flow_store_target->directory = NULL;
+
+    (*options)->checkpoint_target->is_user_set = UNSET;
+    (*options)->checkpoint_target->file_name = NULL;
+
+    (*options)->restore_source->is_user_set = UNSET;
+    (*options)->restore_source->file_name = NULL;
+
+    (*options)->time_window->is_user_set = UNSET;
+    (*options)->time_window->from_set = UNSET;
+    (*options)->time_window->to_set = UNSET;
+    (*options)->time_window->warmup_set = UNSET;
+    (*options)->time_window->from_ms = 0;
+    (*options)->time_window->to_ms = UINT64_MAX;
+    (*options)->time_window->warmup_seconds = 0;
+
+    (*options)->packet_filter->is_user_set = UNSET;
+    (*options)->packet_filter->expression = NULL;
+
+    (*options)->flow_hash_key->is_user_set = UNSET;
+    (*options)->flow_hash_key->key[0] = 0;
+    (*options)->flow_hash_key->key[1] = 0;
+
+    return NO_ERROR;
+}
+
+/*
+ * Function for print help
+ *
+ * @param program_name Name of program.
+ */
+void print_help (char* program_name)
+{
+    fprintf(stderr,
+            "Usage: %s [-f <file>] [-c <netflow_collector>[:<port>]] "
+            "[-a <active_timer>] [-i <inactive_timer>] [-m <count>] [-M <size>]\n"
+            "       [-F <filter>] [-P] [-L] [-b] [-W] [-s <mode>:<interval>] [-l <milliseconds>]\n"
+            "       [-n <packets>[:<bytes>]] [-g <high>[:<low>]]\n"
+            "       [-t <protocol>[/<port>]=<seconds>[,...]] [-T <half_open>[:<fin_wait>]]\n"
+            "       [-A <scheme>] [-r <routing_table>] [-e <format>] [-u <mtu>]\n"
+            "       [-o <output_file>] [-w <arrow_file>] [-B <rows>] [-S <store> [-Z]]\n"
+            "       [-C <checkpoint>] [-R <checkpoint>] [-K <key>]\n"
+            "       [--from <time>] [--to <time>] [--warmup <seconds>]\n"
+            "\n"
+            "  -f <file>                      The name of the analyzed file - in the pcap format (default: STDIN).\n"
+            "  -F <filter>                    Process only the packets matching the BPF expression (e.g. \"not vlan 20\").\n"
+            "  -c <netflow_collector:port>    IP address or hostname of the NetFlow collector (default: 127.0.0.1:2055).\n"
+            "  -a <active_timer>              Interval in seconds after which active records are exported to the collector (default: 60).\n"
+            "  -i <seconds>                   Interval in seconds after which inactive records are exported to the collector (default: 10).\n"
+            "  -m <count>                     Flow-cache size (default: 1024).\n"
+            "  -M <size>                      Flow-cache size given by a memory budget in bytes, K, M, G or T suffix can be used.\n"
+            "  -P                             Preallocate the flow-cache as one prefaulted arena backed by huge pages.\n"
+            "  -L                             Lock the preallocated flow-cache arena in memory (implies -P).\n"
+            "  -b                             Merge both directions of TCP and UDP conversations into one cache entry.\n"
+            "  -W                             Keep the cached flows as NetFlow v5 records and send them without conversion.\n"
+            "  -s <mode>:<interval>           Process 1 out of interval packets (mode count or random) or flows (mode flow).\n"
+            "  -l <milliseconds>              Raise the sampling when the processing lags behind the packets more (load shedding).\n"
+            "  -n <packets>[:<bytes>]         Cache a new flow after the packets or bytes, aggregate the smaller flows by protocol.\n"
+            "  -g <high>[:<low>]              Shorten the timeouts above the high-water mark of the flow-cache (percent).\n"
+            "  -t <protocol>[/<port>]=<sec>   Inactive timeout classes, protocol is tcp, udp, icmp or a number (e.g. icmp=5,udp/53=2).\n"
+            "  -T <half_open>[:<fin_wait>]    Track the TCP states, timeouts of the handshake and after FIN (default FIN: 3).\n"
+            "  -A <scheme>                    Aggregate the flows: none, prefix, source-prefix, protocol-port or protocol.\n"
+            "  -r <routing_table>             Fill the AS numbers, masks and next hops from the prefixes in the file.\n"
+            "  -e <format>                    Export format: v5 (default) or ipfix.\n"
+            "  -u <mtu>                       MTU of the IPFIX messages (576-9216, default 1500).\n"
+            "  -o <output_file>               Write the flows into the binary file (without -c, no collector is used).\n"
+            "  -w <arrow_file>                Write the flows into the columnar Arrow IPC file (without -c, no collector is used).\n"
+            "  -B <rows>                      Rows of the Arrow record batches (1-1048576, default 65536).\n"
+            "  -S <store>                     Append the flows to the time-indexed store in the directory (see flowquery).\n"
+            "  -Z                             Compress the blocks of the flow store.\n"
+            "  -C <checkpoint>                Save the flow-cache into the file at the end instead of exporting it.\n"
+            "  -R <checkpoint>                Restore the flow-cache from the file saved by -C in a previous run.\n"
+            "  -K <key>                       Key of the flow hash, 32 hex digits or a file holding them (default: random).\n"
+            "  --from <time>                  Export the flows which start at or after the time (seeks in the indexed file).\n"
+            "  --to <time>                    Export the flows which start before the time.\n"
+            "  --warmup <seconds>             Packets before --from which only build the flow-cache (default: active timer).\n"
+            "\n"
+            "The time is \"YYYY-MM-DD HH:MM:SS[.mmm]\" in UTC or seconds since the epoch.\n",
+            program_name);
+}
+
+/*
+ * Set default value for the NetFlow collector source if it is not specified.
+ * by user.
+ *
+ * @param options  Pointer to options storage.
+ * @return         Status of function processing.
+ */
+uint8_t set_default_if_not_user_set (options_t options)
+{
+    uint8_t status;
+    static const char* default_collector_source = "127.0.0.1:2055";
+
+    // If the NetFlow collector was not entered the source 127.0.0.1:2055 is set
+    // as a NetFlow collector source.
+    if (!options->netflow_collector_source->is_user_set)
+    {
+        status = allocate_string(&(options->netflow_collector_source->source),
+                                 strlen(default_collector_source));
+
+        if (status != EXIT_SUCCESS)
+        {
+            return MEMORY_HANDLING_ERROR;
+        }
+
+        strcpy(options->netflow_collector_source->source, default_collector_source);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Set the flow-cache size from the memory budget if it is specified by user.
+ * If the flow-cache size is specified too, the smaller of them is used.
+ *
+ * @param options  Pointer to options storage.
+ * @return         Status of function processing.
+ */
+uint8_t set_cache_size_from_budget (options_t options)
+{
+    uint64_t entries_number;
+
+    if (!options->cache_memory_budget->is_user_set)
+    {
+        return NO_ERROR;
+    }
+
+    entries_number = cache_entries_for_budget(options->cache_memory_budget->budget_bytes,
+                                              cache_select_layout(options));
+
+    if (entries_number > ENTRIES_NUMBER_MAX)
+    {
+        entries_number = ENTRIES_NUMBER_MAX;
+    }
+
+    if (entries_number < ENTRIES_NUMBER_MIN)
+    {
+        return ENTRIES_NUMBER_ERROR;
+    }
+
+    if (!options->cached_entries_number->is_user_set ||
+        entries_number < options->cached_entries_number->entries_number)
+    {
+        options->cached_entries_number->entries_number = (uint32_t) entries_number;
+    }
+
+    return NO_ERROR;
+}
+
+/*
+ * Function for parsing the packet sampling option in the format
+ * <mode>:<interval>. If the mode is omitted, the count mode is used.
+ *
+ * @param sampling Pointer to the sampling option storage.
+ * @param argument The option argument.
+ * @return         Status of function processing.
+ */
+uint8_t parse_sampling (sampling_rate_t sampling, char* argument)
+{
+    char* separator = strchr(argument, ':');
+    char* interval = argument;
+
+    sampling->mode = SAMPLING_DETERMINISTIC;
+
+    if (separator != NULL)
+    {
+        *separator = '\0';
+        sampling->mode = sampling_parse_mode(argument);
+        *separator = ':';
+        interval = separator + 1;
+    }
+
+    if (sampling->mode == SAMPLING_NONE || interval[0] == '-')
+    {
+        return SAMPLING_ERROR;
+    }
+
+    sampling->interval = strtoui_16(interval);
+
+    // Check if the value is in the allowed range. At the same time,
+    // it is checked if the input value was possible to convert
+    // to an unsigned int data type.
+    if (!in_range((unsigned int)sampling->interval,
+                  SAMPLING_INTERVAL_MIN, SAMPLING_INTERVAL_MAX))
+    {
+        return SAMPLING_ERROR;
+    }
+
+    return NO_ERROR;
+}
+
+/*
+ * Function for parsing the new flow admission option in the format
+ * <packets>[:<bytes>].
+ *
+ * @param admission Pointer to the admission option storage.
+ * @param argument  The option argument.
+ * @return          Status of function processing.
+ */
+uint8_t parse_admission (admission_threshold_t admission, char* argument)
+{
+    char* separator = strchr(argument, ':');
+
+    if (argument[0] == '-')
+    {
+        return ADMISSION_ERROR;
+    }
+
+    if (separator != NULL)
+    {
+        *separator = '\0';
+    }
+
+    admission->packets = strtoui_32(argument);
+
+    if (separator != NULL)
+    {
+        *separator = ':';
+        admission->octets = (uint32_t) strtoui_size(separator + 1);
+
+        if (admission->octets == 0 || separator[1] == '-')
+        {
+            return ADMISSION_ERROR;
+        }
+    }
+
+    // Check if the value is in the allowed range. At the same time,
+    // it is checked if the input value was possible to convert
+    // to an unsigned int data type.
+    if (!in_range((unsigned int)admission->packets,
+                  ADMISSION_PACKETS_MIN, ADMISSION_PACKETS_MAX))
+    {
+        return ADMISSION_ERROR;
+    }
+
+    return NO_ERROR;
+}
+
+/*
+ * Function for parsing the aggressive aging option in the format
+ * <high>[:<low>]. If the low-water mark is omitted, it is set 10 percent
+ * below the high-water mark.
+ *
+ * @param watermarks Pointer to the water marks storage.
+ * @param argument   The option argument.
+ * @return           Status of function processing.
+ */
+uint8_t parse_watermarks (aging_watermarks_t watermarks, char* argument)
+{
+    char* separator = strchr(argument, ':');
+    unsigned int low;
+    unsigned int high;
+
+    if (argument[0] == '-')
+    {
+        return WATERMARK_RANGE_ERROR;
+    }
+
+    if (separator != NULL)
+    {
+        *separator = '\0';
+    }
+
+    high = strtoui_16(argument);
+    low = (high > 10) ? high - 10 : 0;
+
+    if (separator != NULL)
+    {
+        *separator = ':';
+
+        if (separator[1] == '-' || !is_numeric_string(separator + 1))
+        {
+            return WATERMARK_RANGE_ERROR;
+        }
+
+        low = strtoui_16(separator + 1);
+    }
+
+    // The high mark has to be above the low mark.
+    if (!in_range(high, 1, 100) || low >= high)
+    {
+        return WATERMARK_RANGE_ERROR;
+    }
+
+    watermarks->high_percent = (uint8_t) high;
+    watermarks->low_percent = (uint8_t) low;
+
+    return NO_ERROR;
+}
+
+/*
+ * Function for parsing one timeout class in the format
+ * <protocol>[/<port>]=<seconds>.
+ *
+ * @param timeout_class Pointer to the timeout class storage.
+ * @param argument      The class definition.
+ * @return              Status of function processing.
+ */
+uint8_t parse_timeout_class (timeout_class_t timeout_class, char* argument)
+{
+    char* timeout = strchr(argument, '=');
+    char* port;
+    uint16_t prot;
+
+    if (timeout == NULL || (size_t) (timeout - argument) >= TIMEOUT_CLASS_NAME_MAX)
+    {
+        return TIMEOUT_CLASS_ERROR;
+    }
+
+    *timeout = '\0';
+    timeout++;
+
+    strcpy(timeout_class->name, argument);
+
+    port = strchr(argument, '/');
+
+    if (port != NULL)
+    {
+        *port = '\0';
+        port++;
+    }
+
+    if (strcmp(argument, "tcp") == 0)
+    {
+        prot = IPPROTO_TCP;
+    }
+    else if (strcmp(argument, "udp") == 0)
+    {
+        prot = IPPROTO_UDP;
+    }
+    else if (strcmp(argument, "icmp") == 0)
+    {
+        prot = IPPROTO_ICMP;
+    }
+    else
+    {
+        prot = strtoui_16(argument);
+
+        if (prot == 0 || prot > UINT8_MAX)
+        {
+            return TIMEOUT_CLASS_ERROR;
+        }
+    }
+
+    timeout_class->prot = (uint8_t) prot;
+    timeout_class->port_set = (port != NULL);
+    timeout_class->port = 0;
+
+    if (port != NULL)
+    {
+        timeout_class->port = strtoui_16(port);
+
+        if (timeout_class->port == 0)
+        {
+            return TIMEOUT_CLASS_ERROR;
+        }
+    }
+
+    if (timeout[0] == '-')
+    {
+        return TIMEOUT_CLASS_ERROR;
+    }
+
+    timeout_class->timeout_seconds = strtoui_16(timeout);
+
+    // Check if the value is in the allowed range. At the same time,
+    // it is checked if the input value was possible to convert
+    // to an unsigned int data type.
+    if (!in_range((unsigned int)timeout_class->timeout_seconds,
+                  CLASS_TIMEOUT_MIN, CLASS_TIMEOUT_MAX))
+    {
+        return TIMEOUT_CLASS_ERROR;
+    }
+
+    return NO_ERROR;
+}
+
+/*
+ * Function for parsing the comma separated list of the timeout classes.
+ *
+ * @param timeout_classes Pointer to the timeout classes storage.
+ * @param argument        The option argument.
+ * @return                Status of function processing.
+ */
+uint8_t parse_timeout_classes (timeout_classes_t timeout_classes, char* argument)
+{
+    uint8_t status;
+    char* definition = strtok(argument, ",");
+
+    while (definition != NULL)
+    {
+        if (timeout_classes->classes_number == TIMEOUT_CLASSES_MAX)
+        {
+            return TIMEOUT_CLASS_ERROR;
+        }
+
+        status = parse_timeout_class(&(timeout_classes->classes[timeout_classes->classes_number]),
+                                     definition);
+
+        if (status != NO_ERROR)
+        {
+            return status;
+        }
+
+        timeout_classes->classes_number++;
+        definition = strtok(NULL, ",");
+    }
+
+    if (timeout_classes->classes_number == 0)
+    {
+        return TIMEOUT_CLASS_ERROR;
+    }
+
+    return NO_ERROR;
+}
+
+/*
+ * Function for parsing the TCP state timeouts in the format
+ * <half_open>[:<fin_wait>].
+ *
+ * @param timeouts Pointer to the TCP state timeouts storage.
+ * @param argument The option argument.
+ * @return         Status of function processing.
+ */
+uint8_t parse_tcp_state_timeouts (tcp_state_timeouts_t timeouts, char* argument)
+{
+    char* separator = strchr(argument, ':');
+
+    if (argument[0] == '-')
+    {
+        return TCP_STATE_RANGE_ERROR;
+    }
+
+    if (separator != NULL)
+    {
+        *separator = '\0';
+    }
+
+    timeouts->half_open_seconds = strtoui_16(argument);
+    timeouts->fin_wait_seconds = TCP_FIN_WAIT_DEFAULT;
+
+    if (separator != NULL)
+    {
+        *separator = ':';
+
+        if (separator[1] == '-')
+        {
+            return TCP_STATE_RANGE_ERROR;
+        }
+
+        timeouts->fin_wait_seconds = strtoui_16(separator + 1);
+    }
+
+    // Check if the values are in the allowed range. At the same time,
+    // it is checked if the input values were possible to convert
+    // to an unsigned int data type.
+    if (!in_range((unsigned int)timeouts->half_open_seconds,
+                  TCP_STATE_TIMEOUT_MIN, TCP_STATE_TIMEOUT_MAX) ||
+        !in_range((unsigned int)timeouts->fin_wait_seconds,
+                  TCP_STATE_TIMEOUT_MIN, TCP_STATE_TIMEOUT_MAX))
+    {
+        return TCP_STATE_RANGE_ERROR;
+    }
+
     return NO_ERROR;
 }
 
-/*
- * Function for print help
- *
- * @param program_name Name of program.
- */
-void print_help (char* program_name)
-{
-    fprintf(stderr,
-            "Usage: %s [-f <file>] [-c <netflow_collector>[:<port>]] "
-            "[-a <active_timer>] [-i <inactive_timer>] [-m <count>]\n"
-            "\n"
-            "  -f <file>                      The name of the analyzed file - in the pcap format (default: STDIN).\n"
-            "  -c <netflow_collector:port>    IP address or hostname of the NetFlow collector (default: 127.0.0.1:2055).\n"
-            "  -a <active_timer>              Interval in seconds after which active records are exported to the collector (default: 60).\n"
-            "  -i <seconds>                   Interval in seconds after which inactive records are exported to the collector (default: 10).\n"
-            "  -m <count>                     Flow-cache size (default: 1024).\n",
-            program_name);
-}
+/*
+ * Function for parsing the key of the flow hash from 32 hex digits.
+ * The first 16 digits are the first half of the key.
+ *
+ * @param key    Pointer to the flow hash key storage.
+ * @param digits The hex digits, the white space around them is skipped.
+ * @return       True if the digits are a valid key, false otherwise.
+ */
+bool parse_hash_key_digits (flow_hash_key_t key, const char* digits)
+{
+    const char* hex = "0123456789abcdef";
+    const char* digit;
+    int i;
+
+    while (isspace((unsigned char) *digits))
+    {
+        digits++;
+    }
+
+    key->key[0] = 0;
+    key->key[1] = 0;
+
+    for (i = 0; i < HASH_KEY_DIGITS; i++)
+    {
+        digit = (digits[i] != '\0') ? strchr(hex, tolower((unsigned char) digits[i])) : NULL;
+
+        if (digit == NULL)
+        {
+            return false;
+        }
+
+        key->key[i / 16] = (key->key[i / 16] << 4) | (uint64_t) (digit - hex);
+    }
+
+    for (digits += HASH_KEY_DIGITS; *digits != '\0'; digits++)
+    {
+        if (!isspace((unsigned char) *digits))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Function for parsing the key of the flow hash. The argument is the key
+ * in 32 hex digits or the name of a file holding the key in the same form,
+ * so the key does not have to be visible in the process list.
+ *
+ * @param key      Pointer to the flow hash key storage.
+ * @param argument The option argument.
+ * @return         Status of function processing.
+ */
+uint8_t parse_hash_key (flow_hash_key_t key, char* argument)
+{
+    // The digits with some white space, a longer file is not a key.
+    char content[HASH_KEY_DIGITS * 2];
+    size_t read_number;
+    FILE* key_file;
+
+    if (parse_hash_key_digits(key, argument))
+    {
+        return NO_ERROR;
+    }
+
+    key_file = fopen(argument, "r");
+
+    if (key_file == NULL)
+    {
+        return HASH_KEY_ERROR;
+    }
+
+    read_number = fread(content, 1, sizeof(content) - 1, key_file);
+    fclose(key_file);
+
+    if (read_number == sizeof(content) - 1)
+    {
+        return HASH_KEY_ERROR;
+    }
+
+    content[read_number] = '\0';
+
+    return parse_hash_key_digits(key, content) ? NO_ERROR : HASH_KEY_ERROR;
+}
+
+/*
+ * Main function for parsing arguments
+ *
+ * @param argc     Count of arguments.
+ * @param argv     Arguments.
+ * @param options  Pointer to options storage.
+ * @return         Status of function processing.
+ */
+uint8_t parse_options (int argc, char* argv[], options_t options)
+{
+    uint8_t status;
+    int input_option;
+    static const struct option long_options[] =
+    {
+        { "from",   required_argument, NULL, FROM_OPTION },
+        { "to",     required_argument, NULL, TO_OPTION },
+        { "warmup", required_argument, NULL, WARMUP_OPTION },
+        { NULL,     0,                 NULL, 0 }
+    };
+
+    // Colon as the first character disables getopt to print errors.
+    while ((input_option = getopt_long(argc, argv,
+                                       ":hf:F:c:a:i:m:M:PLbWs:l:n:g:t:T:A:r:e:u:o:w:B:S:ZC:R:K:",
+                                       long_options, NULL)) != -1)
+    {
+        switch (input_option) {
+            case 'h':
+                options->help_set = true;
+
+                break;
+            case 'P':
+                options->flow_arena_set = SET;
+
+                break;
+            case 'L':
+                options->flow_arena_set = SET;
+                options->lock_memory_set = SET;
+
+                break;
+            case 'b':
+                options->biflow_set = SET;
+
+                break;
+            case 'Z':
+                options->store_compression_set = SET;
+
+                break;
+            case 'W':
+                options->wire_format_set = SET;
+
+                break;
+            case 'f':
+                // The second occurrence of the parameter.
+                if (options->analyzed_input_source->is_user_set)
+                {
+                    return MULTIPLE_OPTION_ERROR;
+                }
+
+                options->analyzed_input_source->is_user_set = SET;
+
+                status = allocate_string(&(options->analyzed_input_source->file_name),
+                                         strlen(optarg));
+
+                if (status != EXIT_SUCCESS)
+                {
+                    return MEMORY_HANDLING_ERROR;
+                }
+
+                strcpy(options->analyzed_input_source->file_name, optarg);
+
+                break;
+            case 'F':
+                // The second occurrence of the parameter.
+                if (options->packet_filter->is_user_set)
+                {
+                    return MULTIPLE_OPTION_ERROR;
+                }
+
+                options->packet_filter->is_user_set = SET;
+
+                status = allocate_string(&(options->packet_filter->expression),
+                                         strlen(optarg));
+
+                if (status != EXIT_SUCCESS)
+                {
+                    return MEMORY_HANDLING_ERROR;
+                }
+
+                strcpy(options->packet_filter->expression, optarg);
+
+                break;
+            case 'c':
+                // The second occurrence of the parameter.
+                if (options->netflow_collector_source->is_user_set)
+                {
+                    return MULTIPLE_OPTION_ERROR;
+                }
+
+                options->netflow_collector_source->is_user_set = SET;
+
+                status = allocate_string(&(options->netflow_collector_source->source),
+                                         strlen(optarg));
+
+                if (status != EXIT_SUCCESS)
+                {
+                    return MEMORY_HANDLING_ERROR;
+                }
+
+                strcpy(options->netflow_collector_source->source, optarg);
+
+                break;
+            case 'a':
+                // The second occurrence of the parameter.
+                if (options->active_entries_timeout->is_user_set)
+                {
+                    return MULTIPLE_OPTION_ERROR;
+                }
+
+                options->active_entries_timeout->is_user_set = SET;
+
+                if (optarg[0] != '-')
+                {
+                    options->active_entries_timeout->timeout_seconds = strtoui_16(optarg);
+
+                    // Check if the value is in the allowed range. At the same time,
+                    // it is checked if the input value was possible to convert
+                    // to an unsigned int data type.
+                    if (!in_range((unsigned int)options->active_entries_timeout->timeout_seconds,
+                                  ACTIVE_TIMEOUT_MIN, ACTIVE_TIMEOUT_MAX))
+                    {
+                        return ACTIVE_RANGE_ERROR;
+                    }
+                }
+                else
+                {
+                    return INVALID_OPTION_ERROR;
+                }
+
+                break;
+            case 'i':
+                // The second occurrence of the parameter.
+                if (options->inactive_entries_timeout->is_user_set)
+                {
+                    return MULTIPLE_OPTION_ERROR;
+                }
+
+                options->inactive_entries_timeout->is_user_set = SET;
+
+                if (optarg[0] != '-')
+                {
+                    options->inactive_entries_timeout->timeout_seconds = strtoui_16(optarg);
+
+                    // Check if the value is in the allowed range. At the same time,
+                    // it is checked if the input value was possible to convert
+                    // to an unsigned int data type.
+                    if (!in_range((unsigned int)options->inactive_entries_timeout->timeout_seconds,
+                                  INACTIVE_TIMEOUT_MIN, INACTIVE_TIMEOUT_MAX))
+                    {
+                        return INACTIVE_RANGE_ERROR;
+                    }
+                }
+                else
+                {
+                    return INVALID_OPTION_ERROR;
+                }
+
+                break;
+            case 'm':
+                // The second occurrence of the parameter.
+                if (options->cached_entries_number->is_user_set)
+                {
+                    return MULTIPLE_OPTION_ERROR;
+                }
+
+                options->cached_entries_number->is_user_set = SET;
+
+                if (optarg[0] != '-')
+                {
+                    options->cached_entries_number->entries_number = strtoui_32(optarg);
+
+                    // Check if the value is in the allowed range. At the same time,
+                    // it is checked if the input value was possible to convert
+                    // to an unsigned int data type.
+                    if (!in_range((unsigned int)options->cached_entries_number->entries_number,
+                                  ENTRIES_NUMBER_MIN, ENTRIES_NUMBER_MAX))
+                    {
+                        return ENTRIES_NUMBER_ERROR;
+                    }
+                }
+                else
+                {
+                    return INVALID_OPTION_ERROR;
+                }
+
+                break;
+            case 'M':
+                // The second occurrence of the parameter.
+                if (options->cache_memory_budget->is_user_set)
+                {
+                    return MULTIPLE_OPTION_ERROR;
+                }
+
+                options->cache_memory_budget->is_user_set = SET;
+                options->cache_memory_budget->budget_bytes = strtoui_size(optarg);
+
+                if (options->cache_memory_budget->budget_bytes == 0)
+                {
+                    return INVALID_OPTION_ERROR;
+                }
+
+                break;
+            case 's':
+                // The second occurrence of the parameter.
+                if (options->packet_sampling->is_user_set)
+                {
+                    return MULTIPLE_OPTION_ERROR;
+                }
+
+                options->packet_sampling->is_user_set = SET;
+
+                status = parse_sampling(options->packet_sampling, optarg);
+
+                if (status != NO_ERROR)
+                {
+                    return status;
+                }
+
+                break;
+            case 'l':
+                // The second occurrence of the parameter.
+                if (options->ingest_max_lag->is_user_set)
+                {
+                    return MULTIPLE_OPTION_ERROR;
+                }
+
+                options->ingest_max_lag->is_user_set = SET;
+
+                if (optarg[0] != '-')
+                {
+                    options->ingest_max_lag->lag_ms = strtoui_32(optarg);
+
+                    // Check if the value is in the allowed range. At the same time,
+                    // it is checked if the input value was possible to convert
+                    // to an unsigned int data type.
+                    if (!in_range((unsigned int)options->ingest_max_lag->lag_ms,
+                                  MAX_LAG_MIN, MAX_LAG_MAX))
+                    {
+                        return MAX_LAG_RANGE_ERROR;
+                    }
+                }
+                else
+                {
+                    return INVALID_OPTION_ERROR;
+                }
+
+                break;
+            case 'n':
+                // The second occurrence of the parameter.
+                if (options->new_flow_admission->is_user_set)
+                {
+                    return MULTIPLE_OPTION_ERROR;
+                }
+
+                options->new_flow_admission->is_user_set = SET;
+
+                status = parse_admission(options->new_flow_admission, optarg);
+
+                if (status != NO_ERROR)
+                {
+                    return status;
+                }
+
+                break;
+            case 'g':
+                // The second occurrence of the parameter.
+                if (options->aging_watermarks->is_user_set)
+                {
+                    return MULTIPLE_OPTION_ERROR;
+                }
 
-/*
- * Set default value for the NetFlow collector source if it is not specified.
- * by user.
- *
- * @param options  Pointer to options storage.
- * @return         Status of function processing.
- */
-uint8_t set_default_if_not_user_set (options_t options)
-{
-    uint8_t status;
-    static const char* default_collector_source = "127.0.0.1:2055";
+                options->aging_watermarks->is_user_set = SET;
 
-    // If the NetFlow collector was not entered the source 127.0.0.1:2055 is set
-    // as a NetFlow collector source.
-    if (!options->netflow_collector_source->is_user_set)
-    {
-        status = allocate_string(&(options->netflow_collector_source->source),
-                                 strlen(default_collector_source));
+                status = parse_watermarks(options->aging_watermarks, optarg);
 
-        if (status != EXIT_SUCCESS)
-        {
-            return MEMORY_HANDLING_ERROR;
-        }
+                if (status != NO_ERROR)
+                {
+                    return status;
+                }
 
-        strcpy(options->netflow_collector_source->source, default_collector_source);
-    }
+                break;
+            case 't':
+                // The second occurrence of the parameter.
+                if (options->timeout_classes->is_user_set)
+                {
+                    return MULTIPLE_OPTION_ERROR;
+                }
 
-    return EXIT_SUCCESS;
-}
+                options->timeout_classes->is_user_set = SET;
 
-/*
- * Main function for parsing arguments
- *
- * @param argc     Count of arguments.
- * @param argv     Arguments.
- * @param options  Pointer to options storage.
- * @return         Status of function processing.
- */
-uint8_t parse_options (int argc, char* argv[], options_t options)
-{
-    uint8_t status;
-    int input_option;
+                status = parse_timeout_classes(options->timeout_classes, optarg);
 
-    // Colon as the first character disables getopt to print errors.
-    while ((input_option = getopt(argc, argv, ":hf:c:a:i:m:")) != -1)
-    {
-        switch (input_option) {
-            case 'h':
-                options->help_set = true;
+                if (status != NO_ERROR)
+                {
+                    return status;
+                }
 
                 break;
-            case 'f':
+            case 'T':
                 // The second occurrence of the parameter.
-                if (options->analyzed_input_source->is_user_set)
+                if (options->tcp_state_timeouts->is_user_set)
                 {
                     return MULTIPLE_OPTION_ERROR;
                 }
 
-                options->analyzed_input_source->is_user_set = SET;
+                options->tcp_state_timeouts->is_user_set = SET;
 
-                status = allocate_string(&(options->analyzed_input_source->file_name),
+                status = parse_tcp_state_timeouts(options->tcp_state_timeouts, optarg);
+
+                if (status != NO_ERROR)
+                {
+                    return status;
+                }
+
+                break;
+            case 'A':
+                // The second occurrence of the parameter.
+                if (options->aggregation->is_user_set)
+                {
+                    return MULTIPLE_OPTION_ERROR;
+                }
+
+                options->aggregation->is_user_set = SET;
+                options->aggregation->scheme = aggregation_parse_scheme(optarg);
+
+                if (options->aggregation->scheme == AGGREGATION_SCHEMES_NUMBER)
+                {
+                    return AGGREGATION_ERROR;
+                }
+
+                break;
+            case 'r':
+                // The second occurrence of the parameter.
+                if (options->routing_table_source->is_user_set)
+                {
+                    return MULTIPLE_OPTION_ERROR;
+                }
+
+                options->routing_table_source->is_user_set = SET;
+
+                status = allocate_string(&(options->routing_table_source->file_name),
                                          strlen(optarg));
 
                 if (status != EXIT_SUCCESS)
@@ -147,19 +1028,51 @@ uint8_t parse_options (int argc, char* argv[], options_t options)
                     return MEMORY_HANDLING_ERROR;
                 }
 
-                strcpy(options->analyzed_input_source->file_name, optarg);
+                strcpy(options->routing_table_source->file_name, optarg);
 
                 break;
-            case 'c':
+            case 'e':
                 // The second occurrence of the parameter.
-                if (options->netflow_collector_source->is_user_set)
+                if (options->export_format->is_user_set)
                 {
                     return MULTIPLE_OPTION_ERROR;
                 }
 
-                options->netflow_collector_source->is_user_set = SET;
+                options->export_format->is_user_set = SET;
+                options->export_format->format = export_parse_format(optarg);
 
-                status = allocate_string(&(options->netflow_collector_source->source),
+                if (options->export_format->format == EXPORT_FORMATS_NUMBER)
+                {
+                    return EXPORT_FORMAT_ERROR;
+                }
+
+                break;
+            case 'u':
+                // The second occurrence of the parameter.
+                if (options->export_mtu->is_user_set)
+                {
+                    return MULTIPLE_OPTION_ERROR;
+                }
+
+                options->export_mtu->is_user_set = SET;
+                options->export_mtu->mtu = strtoui_16(optarg);
+
+                if (!in_range((unsigned int)options->export_mtu->mtu, MTU_MIN, MTU_MAX))
+                {
+                    return MTU_RANGE_ERROR;
+                }
+
+                break;
+            case 'o':
+                // The second occurrence of the parameter.
+                if (options->output_file_target->is_user_set)
+                {
+                    return MULTIPLE_OPTION_ERROR;
+                }
+
+                options->output_file_target->is_user_set = SET;
+
+                status = allocate_string(&(options->output_file_target->file_name),
                                          strlen(optarg));
 
                 if (status != EXIT_SUCCESS)
@@ -167,90 +1080,170 @@ uint8_t parse_options (int argc, char* argv[], options_t options)
                     return MEMORY_HANDLING_ERROR;
                 }
 
-                strcpy(options->netflow_collector_source->source, optarg);
+                strcpy(options->output_file_target->file_name, optarg);
 
                 break;
-            case 'a':
+            case 'w':
                 // The second occurrence of the parameter.
-                if (options->active_entries_timeout->is_user_set)
+                if (options->arrow_file_target->is_user_set)
                 {
                     return MULTIPLE_OPTION_ERROR;
                 }
 
-                options->active_entries_timeout->is_user_set = SET;
+                options->arrow_file_target->is_user_set = SET;
 
-                if (optarg[0] != '-')
+                status = allocate_string(&(options->arrow_file_target->file_name),
+                                         strlen(optarg));
+
+                if (status != EXIT_SUCCESS)
                 {
-                    options->active_entries_timeout->timeout_seconds = strtoui_16(optarg);
+                    return MEMORY_HANDLING_ERROR;
+                }
 
-                    // Check if the value is in the allowed range. At the same time,
-                    // it is checked if the input value was possible to convert
-                    // to an unsigned int data type.
-                    if (!in_range((unsigned int)options->active_entries_timeout->timeout_seconds,
-                                  ACTIVE_TIMEOUT_MIN, ACTIVE_TIMEOUT_MAX))
-                    {
-                        return ACTIVE_RANGE_ERROR;
-                    }
+                strcpy(options->arrow_file_target->file_name, optarg);
+
+                break;
+            case 'B':
+                // The second occurrence of the parameter.
+                if (options->arrow_batch_size->is_user_set)
+                {
+                    return MULTIPLE_OPTION_ERROR;
                 }
-                else
+
+                options->arrow_batch_size->is_user_set = SET;
+                options->arrow_batch_size->rows = strtoui_32(optarg);
+
+                if (!in_range((unsigned int)options->arrow_batch_size->rows,
+                              ARROW_BATCH_MIN, ARROW_BATCH_MAX))
                 {
-                    return INVALID_OPTION_ERROR;
+                    return BATCH_RANGE_ERROR;
                 }
 
                 break;
-            case 'i':
+            case 'S':
                 // The second occurrence of the parameter.
-                if (options->inactive_entries_timeout->is_user_set)
+                if (options->flow_store_target->is_user_set)
                 {
                     return MULTIPLE_OPTION_ERROR;
                 }
 
-                options->inactive_entries_timeout->is_user_set = SET;
+                options->flow_store_target->is_user_set = SET;
 
-                if (optarg[0] != '-')
+                status = allocate_string(&(options->flow_store_target->directory),
+                                         strlen(optarg));
+
+                if (status != EXIT_SUCCESS)
                 {
-                    options->inactive_entries_timeout->timeout_seconds = strtoui_16(optarg);
+                    return MEMORY_HANDLING_ERROR;
+                }
 
-                    // Check if the value is in the allowed range. At the same time,
-                    // it is checked if the input value was possible to convert
-                    // to an unsigned int data type.
-                    if (!in_range((unsigned int)options->inactive_entries_timeout->timeout_seconds,
-                                  INACTIVE_TIMEOUT_MIN, INACTIVE_TIMEOUT_MAX))
-                    {
-                        return INACTIVE_RANGE_ERROR;
-                    }
+                strcpy(options->flow_store_target->directory, optarg);
+
+                break;
+            case 'C':
+                // The second occurrence of the parameter.
+                if (options->checkpoint_target->is_user_set)
+                {
+                    return MULTIPLE_OPTION_ERROR;
                 }
-                else
+
+                options->checkpoint_target->is_user_set = SET;
+
+                status = allocate_string(&(options->checkpoint_target->file_name),
+                                         strlen(optarg));
+
+                if (status != EXIT_SUCCESS)
                 {
-                    return INVALID_OPTION_ERROR;
+                    return MEMORY_HANDLING_ERROR;
                 }
 
+                strcpy(options->checkpoint_target->file_name, optarg);
+
                 break;
-            case 'm':
+            case 'R':
                 // The second occurrence of the parameter.
-                if (options->cached_entries_number->is_user_set)
+                if (options->restore_source->is_user_set)
                 {
                     return MULTIPLE_OPTION_ERROR;
                 }
 
-                options->cached_entries_number->is_user_set = SET;
+                options->restore_source->is_user_set = SET;
 
-                if (optarg[0] != '-')
+                status = allocate_string(&(options->restore_source->file_name),
+                                         strlen(optarg));
+
+                if (status != EXIT_SUCCESS)
                 {
-                    options->cached_entries_number->entries_number = strtoui_32(optarg);
+                    return MEMORY_HANDLING_ERROR;
+                }
 
-                    // Check if the value is in the allowed range. At the same time,
-                    // it is checked if the input value was possible to convert
-                    // to an unsigned int data type.
-                    if (!in_range((unsigned int)options->cached_entries_number->entries_number,
-                                  ENTRIES_NUMBER_MIN, ENTRIES_NUMBER_MAX))
-                    {
-                        return ENTRIES_NUMBER_ERROR;
-                    }
+                strcpy(options->restore_source->file_name, optarg);
+
+                break;
+            case 'K':
+                // The second occurrence of the parameter.
+                if (options->flow_hash_key->is_user_set)
+                {
+                    return MULTIPLE_OPTION_ERROR;
                 }
-                else
+
+                options->flow_hash_key->is_user_set = SET;
+
+                status = parse_hash_key(options->flow_hash_key, optarg);
+
+                if (status != NO_ERROR)
                 {
-                    return INVALID_OPTION_ERROR;
+                    return status;
+                }
+
+                break;
+            case FROM_OPTION:
+                // The second occurrence of the parameter.
+                if (options->time_window->from_set)
+                {
+                    return MULTIPLE_OPTION_ERROR;
+                }
+
+                options->time_window->is_user_set = SET;
+                options->time_window->from_set = SET;
+
+                if (!parse_time_ms(optarg, &(options->time_window->from_ms)))
+                {
+                    return TIME_WINDOW_ERROR;
+                }
+
+                break;
+            case TO_OPTION:
+                // The second occurrence of the parameter.
+                if (options->time_window->to_set)
+                {
+                    return MULTIPLE_OPTION_ERROR;
+                }
+
+                options->time_window->is_user_set = SET;
+                options->time_window->to_set = SET;
+
+                if (!parse_time_ms(optarg, &(options->time_window->to_ms)))
+                {
+                    return TIME_WINDOW_ERROR;
+                }
+
+                break;
+            case WARMUP_OPTION:
+                // The second occurrence of the parameter.
+                if (options->time_window->warmup_set)
+                {
+                    return MULTIPLE_OPTION_ERROR;
+                }
+
+                options->time_window->warmup_set = SET;
+                options->time_window->warmup_seconds = strtoui_32(optarg);
+
+                if (!is_numeric_string(optarg) ||
+                    !in_range((unsigned int)options->time_window->warmup_seconds,
+                              WARMUP_MIN, WARMUP_MAX))
+                {
+                    return TIME_WINDOW_ERROR;
                 }
 
                 break;
@@ -262,6 +1255,39 @@ uint8_t parse_options (int argc, char* argv[], options_t options)
         }
     }
 
+    // The window ends after it starts, the warm-up is only before the window.
+    if (options->time_window->to_ms <= options->time_window->from_ms ||
+        (options->time_window->warmup_set && !options->time_window->from_set))
+    {
+        return TIME_WINDOW_ERROR;
+    }
+
+    // The records in the wire format are only sent to the collector,
+    // the other outputs and the biflows need the flows in the host format.
+    if (options->wire_format_set &&
+        (options->biflow_set ||
+         options->export_format->format != EXPORT_NETFLOW_V5 ||
+         options->output_file_target->is_user_set ||
+         options->arrow_file_target->is_user_set ||
+         options->flow_store_target->is_user_set))
+    {
+        return WIRE_FORMAT_ERROR;
+    }
+
+    // The flows started before the window are exported by the active timer
+    // at the latest, so their state is rebuilt by the warm-up of that length.
+    if (!options->time_window->warmup_set)
+    {
+        options->time_window->warmup_seconds = options->active_entries_timeout->timeout_seconds;
+    }
+
+    status = set_cache_size_from_budget(options);
+
+    if (status != NO_ERROR)
+    {
+        return status;
+    }
+
     return set_default_if_not_user_set(options);
 }
 
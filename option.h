@@ -20,6 +20,26 @@ typedef struct netflow_collector* netflow_collector_t;
 typedef struct active_timeout* active_timeout_t;
 typedef struct inactive_timeout* inactive_timeout_t;
 typedef struct cached_entries* cached_entries_t;
+typedef struct memory_budget* memory_budget_t;
+typedef struct sampling_rate* sampling_rate_t;
+typedef struct max_lag* max_lag_t;
+typedef struct admission_threshold* admission_threshold_t;
+typedef struct aging_watermarks* aging_watermarks_t;
+typedef struct timeout_class* timeout_class_t;
+typedef struct timeout_classes* timeout_classes_t;
+typedef struct tcp_state_timeouts* tcp_state_timeouts_t;
+typedef struct aggregation* aggregation_t;
+typedef struct routing_file* routing_file_t;
+typedef struct export_format_option* export_format_option_t;
+typedef struct export_mtu* export_mtu_t;
+typedef struct output_file* output_file_t;
+typedef struct arrow_file* arrow_file_t;
+typedef struct arrow_batch_size* arrow_batch_size_t;
+typedef struct store_directory* store_directory_t;
+typedef struct checkpoint_file* checkpoint_file_t;
+typedef struct time_window* time_window_t;
+typedef struct packet_filter* packet_filter_t;
+typedef struct flow_hash_key* flow_hash_key_t;
 typedef struct options* options_t;
 
 // The range values for timeouts are taken from the source on 2022-10-01:
@@ -37,10 +57,54 @@ enum inactive_timeout_range
     INACTIVE_TIMEOUT_MAX = 600
 };
 
+enum max_lag_range
+{
+    MAX_LAG_MIN = 1,
+    MAX_LAG_MAX = 60000
+};
+
+enum admission_packets_range
+{
+    ADMISSION_PACKETS_MIN = 1,
+    ADMISSION_PACKETS_MAX = 65535
+};
+
+enum class_timeout_range
+{
+    CLASS_TIMEOUT_MIN = 1,
+    CLASS_TIMEOUT_MAX = 3600
+};
+
+enum tcp_state_timeout_range
+{
+    TCP_STATE_TIMEOUT_MIN = 1,
+    TCP_STATE_TIMEOUT_MAX = 600
+};
+
+#define TCP_FIN_WAIT_DEFAULT   (3)  // The default timeout after a FIN.
+#define TIMEOUT_CLASSES_MAX    (8)  // The maximum number of timeout classes.
+#define TIMEOUT_CLASS_NAME_MAX (16) // The maximum length of a class name.
+
 enum entries_number_range
 {
     ENTRIES_NUMBER_MIN = 1024,
-    ENTRIES_NUMBER_MAX = 524288
+    ENTRIES_NUMBER_MAX = 134217728
+};
+
+enum warmup_range
+{
+    WARMUP_MIN = 0,
+    WARMUP_MAX = 86400
+};
+
+#define HASH_KEY_DIGITS (32) // The hex digits of the 128-bit flow hash key.
+
+// The options without a short name.
+enum long_option
+{
+    FROM_OPTION = 256,
+    TO_OPTION,
+    WARMUP_OPTION
 };
 
 /*
@@ -81,7 +145,7 @@ struct inactive_timeout
 
 /*
  * Structure to store the maximum allowed size of the cache (meaning number
- * of nodes in a tree).
+ * of cached flows).
  */
 struct cached_entries
 {
@@ -89,6 +153,206 @@ struct cached_entries
     uint32_t entries_number;
 };
 
+/*
+ * Structure to store the memory budget of the cache.
+ */
+struct memory_budget
+{
+    bool is_user_set;
+    uint64_t budget_bytes;
+};
+
+/*
+ * Structure to store the packet sampling mode and interval.
+ */
+struct sampling_rate
+{
+    bool is_user_set;
+    uint8_t mode;
+    uint16_t interval;
+};
+
+/*
+ * Structure to store the allowed processing lag for the load shedding.
+ */
+struct max_lag
+{
+    bool is_user_set;
+    uint32_t lag_ms;
+};
+
+/*
+ * Structure to store the thresholds of the new flow admission.
+ */
+struct admission_threshold
+{
+    bool is_user_set;
+    uint32_t packets;
+    uint32_t octets;
+};
+
+/*
+ * Structure to store the water marks of the aggressive aging
+ * in percents of the flow-cache size.
+ */
+struct aging_watermarks
+{
+    bool is_user_set;
+    uint8_t high_percent;
+    uint8_t low_percent;
+};
+
+/*
+ * Structure to store a timeout class. The class matches the flows
+ * of the protocol and optionally of the source or destination port.
+ */
+struct timeout_class
+{
+    char name[TIMEOUT_CLASS_NAME_MAX];
+    uint8_t prot;
+    bool port_set;
+    uint16_t port;
+    uint16_t timeout_seconds;
+};
+
+/*
+ * Structure to store the timeout classes, which replace the inactive timeout
+ * for the matching flows.
+ */
+struct timeout_classes
+{
+    bool is_user_set;
+    uint8_t classes_number;
+    struct timeout_class classes[TIMEOUT_CLASSES_MAX];
+};
+
+/*
+ * Structure to store the timeouts of the TCP connection states.
+ */
+struct tcp_state_timeouts
+{
+    bool is_user_set;
+    uint16_t half_open_seconds; // Only SYN or SYN-ACK was seen.
+    uint16_t fin_wait_seconds;  // FIN was seen, waiting for the last ACKs.
+};
+
+/*
+ * Structure to store the aggregation scheme of the flow keys.
+ */
+struct aggregation
+{
+    bool is_user_set;
+    uint8_t scheme;
+};
+
+/*
+ * Structure to store the name of the routing table file.
+ */
+struct routing_file
+{
+    bool is_user_set;
+    char* file_name;
+};
+
+/*
+ * Structure to store the export format.
+ */
+struct export_format_option
+{
+    bool is_user_set;
+    uint8_t format;
+};
+
+/*
+ * Structure to store the MTU of the export path.
+ */
+struct export_mtu
+{
+    bool is_user_set;
+    uint16_t mtu;
+};
+
+/*
+ * Structure to store the name of the output flow file.
+ */
+struct output_file
+{
+    bool is_user_set;
+    char* file_name;
+};
+
+/*
+ * Structure to store the name of the Arrow IPC flow file.
+ */
+struct arrow_file
+{
+    bool is_user_set;
+    char* file_name;
+};
+
+/*
+ * Structure to store the number of rows of the Arrow record batches.
+ */
+struct arrow_batch_size
+{
+    bool is_user_set;
+    uint32_t rows;
+};
+
+/*
+ * Structure to store the directory of the flow store.
+ */
+struct store_directory
+{
+    bool is_user_set;
+    char* directory;
+};
+
+/*
+ * Structure to store the name of a checkpoint file of the flow cache.
+ */
+struct checkpoint_file
+{
+    bool is_user_set;
+    char* file_name;
+};
+
+/*
+ * Structure to store the time window of the processed packets. The flows
+ * which start in the window are exported. The packets of the warm-up
+ * before the window only build the state of the flow cache, the packets
+ * of one active timeout after the window finish the flows of the window.
+ */
+struct time_window
+{
+    bool is_user_set;
+    bool from_set;
+    bool to_set;
+    bool warmup_set;
+    uint64_t from_ms;
+    uint64_t to_ms;
+    uint32_t warmup_seconds; // The default is the active timeout.
+};
+
+/*
+ * Structure to store the BPF expression of the packet filter.
+ */
+struct packet_filter
+{
+    bool is_user_set;
+    char* expression;
+};
+
+/*
+ * Structure to store the key of the flow hash. The runs with the same key
+ * select the same flows by the flow sampling and the admission.
+ */
+struct flow_hash_key
+{
+    bool is_user_set;
+    uint64_t key[2];
+};
+
 /*
  * Structure to store the references for the stored parameter and program
  * settings in general.
@@ -96,14 +360,66 @@ struct cached_entries
 struct options
 {
     bool help_set;
+    // Preallocate the flow storage as one prefaulted arena.
+    bool flow_arena_set;
+    // Lock the flow arena in memory (implies the flow arena).
+    bool lock_memory_set;
+    // Merge both directions of a conversation into one biflow.
+    bool biflow_set;
+    // Compress the blocks of the flow store.
+    bool store_compression_set;
+    // Keep the cached flows as the NetFlow v5 records in the wire format.
+    bool wire_format_set;
     analyzed_input_t analyzed_input_source;
     netflow_collector_t netflow_collector_source;
     // 60 - 3600 seconds (project default: 60, documentation default: 1800)
     active_timeout_t active_entries_timeout;
     // 10 - 600 seconds (project default: 10, documentation default: 15)
     inactive_timeout_t inactive_entries_timeout;
-    // 1024 - 524288 (project default: 1024, documentation default: 4096)
+    // 1024 - 134217728 (project default: 1024, documentation default: 4096)
     cached_entries_t cached_entries_number;
+    // The cache size computed from bytes, the smaller of -m and -M is used.
+    memory_budget_t cache_memory_budget;
+    // 1 - 16383, 1 out of the interval packets or flows is processed.
+    sampling_rate_t packet_sampling;
+    // 1 - 60000 milliseconds, the sampling is raised above the lag.
+    max_lag_t ingest_max_lag;
+    // 1 - 65535 packets (and optionally bytes) before a flow is cached.
+    admission_threshold_t new_flow_admission;
+    // 1 - 100 percent, the low mark defaults to the high mark minus 10.
+    aging_watermarks_t aging_watermarks;
+    // Up to 8 classes of <protocol>[/<port>]=<seconds>, 1 - 3600 seconds.
+    timeout_classes_t timeout_classes;
+    // 1 - 600 seconds for the half-open and FIN-wait TCP flows.
+    tcp_state_timeouts_t tcp_state_timeouts;
+    // none, prefix, source-prefix, protocol-port or protocol.
+    aggregation_t aggregation;
+    // Prefixes with the AS numbers and next hops of the exported records.
+    routing_file_t routing_table_source;
+    // NetFlow v5 or IPFIX.
+    export_format_option_t export_format;
+    // The IPFIX messages are packed up to the MTU.
+    export_mtu_t export_mtu;
+    // The flows are written into the file instead of or in addition
+    // to the collector.
+    output_file_t output_file_target;
+    // The flows are written into the columnar Arrow IPC file.
+    arrow_file_t arrow_file_target;
+    // 1 - 1048576 rows of a record batch (default: 65536).
+    arrow_batch_size_t arrow_batch_size;
+    // The flows are appended to the segments of the time-indexed store.
+    store_directory_t flow_store_target;
+    // The flow cache is saved into the checkpoint instead of being exported.
+    checkpoint_file_t checkpoint_target;
+    // The flow cache is restored from the checkpoint of a previous run.
+    checkpoint_file_t restore_source;
+    // The flows which start in the window, the pcap file is indexed
+    // to seek to the start of the warm-up.
+    time_window_t time_window;
+    // Only the packets matching the BPF expression are processed.
+    packet_filter_t packet_filter;
+    // 32 hex digits or a file holding them, the default is a random key.
+    flow_hash_key_t flow_hash_key;
 };
 
 /*
@@ -11,17 +11,61 @@
 
 #include "pcap.h"
 
-#include <arpa/inet.h>
 #include <netinet/in.h>
-#include <netinet/if_ether.h>
 #include <pcap.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
+#include <sys/time.h>
 
 #include "error.h"
+#include "linktype.h"
 #include "netflow_v5.h"
+#include "sampling.h"
+#include "timeindex.h"
 
-#define SIZE_ETHERNET (14) // Offset of Ethernet header to L3 protocol.
+/*
+ * The helper function for seeking to the start of the warm-up
+ * by the time index of the input file. Without the index, the packets
+ * are read from the start and the older ones are skipped.
+ *
+ * @param handle    The opened input file.
+ * @param file_name The name of the input file.
+ * @param start_ms  The time of the first processed packet.
+ * @return          Status of function processing.
+ */
+static uint8_t seek_window_start (pcap_t* handle, const char* file_name, uint64_t start_ms)
+{
+    struct time_index index;
+    time_index_entry_t entry;
+    uint8_t status = NO_ERROR;
+
+    if (time_index_open(&index, file_name) != NO_ERROR)
+    {
+        printf("time_index: not available, reading from the start\n");
+
+        return NO_ERROR;
+    }
+
+    entry = time_index_find(&index, start_ms);
+
+    // Print info about the time index.
+    printf("time_index: %lu entries%s, skipping %lu packets\n",
+           index.entries_number,
+           index.built ? " (built)" : "",
+           entry->packets_number);
+
+    // The saved file is read through its stream, so the next record
+    // is read from the offset.
+    if (fseeko(pcap_file(handle), (off_t) entry->offset, SEEK_SET) != 0)
+    {
+        status = PCAP_HANDLING_ERROR;
+    }
+
+    time_index_close(&index);
+
+    return status;
+}
 
 /*
  * Function which runs reading the packet from the pcap files, processing
@@ -44,7 +88,19 @@ uint8_t run_packets_processing (netflow_recording_system_t netflow_records,
     const u_char* packet;
     struct pcap_pkthdr* header; // Has to be pointer because of pcap_next_ex.
     pcap_t* handle;
-    struct ether_header* eptr;
+    link_parser_t parser;
+    uint32_t layer_3_offset;
+    struct pcap_stat stats;
+    uint64_t dropped_packets = 0;
+    uint64_t packet_ms;
+    uint64_t start_ms = 0;
+    uint64_t stop_ms = UINT64_MAX;
+    uint64_t margin_ms;
+    time_window_t window = options->time_window;
+    struct bpf_program filter;
+    bool filter_set = options->packet_filter->is_user_set;
+    struct timeval processing_start;
+    struct timeval processing_end;
 
     char* input_stream = options->analyzed_input_source->file_name;
 
@@ -68,23 +124,125 @@ uint8_t run_packets_processing (netflow_recording_system_t netflow_records,
         return INVALID_INPUT_FILE_ERROR;
     }
 
+    // The parser is selected once by the link type of the input.
+    parser = link_parser_select(pcap_datalink(handle));
+
+    if (parser == NULL)
+    {
+        pcap_close(handle);
+
+        return LINK_TYPE_ERROR;
+    }
+
+    netflow_records->link_type_name = parser->name;
+
+    // Print info about link type.
+    printf("link_type: %s\n", parser->name);
+
+    // The filter is compiled for the link type of the input. The packets
+    // are matched before the parsing, so the rejected packets cost only
+    // the filter program.
+    if (filter_set &&
+        pcap_compile(handle, &filter, options->packet_filter->expression,
+                     1, PCAP_NETMASK_UNKNOWN) != 0)
+    {
+        pcap_close(handle);
+
+        return FILTER_ERROR;
+    }
+
+    // The warm-up builds the flows which continue into the window,
+    // one active timeout after the window finishes the flows of the window.
+    if (window->from_set)
+    {
+        margin_ms = (uint64_t) window->warmup_seconds * 1000;
+        start_ms = (window->from_ms > margin_ms) ? window->from_ms - margin_ms : 0;
+    }
+
+    if (window->to_set)
+    {
+        margin_ms = (uint64_t) options->active_entries_timeout->timeout_seconds * 1000;
+        stop_ms = (window->to_ms < UINT64_MAX - margin_ms) ? window->to_ms + margin_ms : UINT64_MAX;
+    }
+
+    if (window->from_set && options->analyzed_input_source->file_name != NULL)
+    {
+        status = seek_window_start(handle, input_stream, start_ms);
+
+        if (status != NO_ERROR)
+        {
+            if (filter_set)
+            {
+                pcap_freecode(&filter);
+            }
+
+            pcap_close(handle);
+
+            return status;
+        }
+    }
+
     printf("\n");
     printf("\n");
     printf("Starting processing packets ...\n");
     printf("Processing packets...\n");
 
+    gettimeofday(&processing_start, NULL);
+
     while (((return_code = pcap_next_ex(handle, &header, &packet)) > 0) && status == NO_ERROR)
     {
-        // Read the Ethernet header.
-        eptr = (struct ether_header *) packet;
-
-        switch (ntohs(eptr->ether_type)){
-            case ETHERTYPE_IP: // IPv4 packet
-                status = process_packet(netflow_records, sending_system, header, packet, options);
-                break;
-            default:
-                break;
+        packet_ms = (uint64_t) header->ts.tv_sec * 1000 + (uint64_t) header->ts.tv_usec / 1000;
+
+        // The packets before the warm-up do not drive the timers at all.
+        if (packet_ms < start_ms)
+        {
+            continue;
+        }
+
+        if (packet_ms >= stop_ms)
+        {
+            break;
+        }
+
+        netflow_records->read_packets++;
+
+        if (filter_set && pcap_offline_filter(&filter, header, packet) == 0)
+        {
+            netflow_records->filtered_packets++;
+            continue;
         }
+
+        // Adapt the sampling to the load. The capture statistics are
+        // not available for the saved files, then only the lag is used.
+        if (sampling_shedding_due(netflow_records->sampling))
+        {
+            if (pcap_stats(handle, &stats) == 0)
+            {
+                dropped_packets = (uint64_t) stats.ps_drop + stats.ps_ifdrop;
+            }
+
+            sampling_shed_load(netflow_records->sampling, &(header->ts), dropped_packets);
+        }
+
+        // Only the IPv4 packets are processed.
+        layer_3_offset = parser->parse(packet, header->caplen, &(netflow_records->link_statistics));
+
+        if (layer_3_offset != LINK_NOT_IPV4)
+        {
+            status = process_packet(netflow_records, sending_system, header, packet,
+                                    layer_3_offset, options);
+        }
+    }
+
+    gettimeofday(&processing_end, NULL);
+
+    netflow_records->processing_us +=
+            (uint64_t) (processing_end.tv_sec - processing_start.tv_sec) * 1000000 +
+            (uint64_t) processing_end.tv_usec - (uint64_t) processing_start.tv_usec;
+
+    if (filter_set)
+    {
+        pcap_freecode(&filter);
     }
 
     if (return_code < 0 && return_code != PCAP_ERROR_BREAK)
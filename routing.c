@@ -0,0 +1,429 @@
+/**********************************************************/
+/*                                                        */
+/* File: routing.c                                        */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Routing table for the exported records    */
+/*                                                        */
+/**********************************************************/
+
+#include "routing.h"
+
+#include <arpa/inet.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "error.h"
+
+#define ROUTING_LINE_LENGTH (256)
+
+typedef struct routing_prefix* routing_prefix_t;
+
+/*
+ * Structure to store a loaded prefix before the insertion.
+ */
+struct routing_prefix
+{
+    uint32_t addr;   // In the host byte order.
+    uint32_t route;
+    uint8_t length;
+};
+
+/*
+ * The helper function for ordering the prefixes by their length.
+ *
+ * @param first  The first prefix.
+ * @param second The second prefix.
+ * @return       Negative, zero or positive value as for qsort.
+ */
+static int compare_prefixes (const void* first, const void* second)
+{
+    const struct routing_prefix* first_prefix = first;
+    const struct routing_prefix* second_prefix = second;
+
+    return (int) first_prefix->length - (int) second_prefix->length;
+}
+
+/*
+ * The helper function for adding a route.
+ *
+ * @param table Pointer to the routing table.
+ * @param route The added route.
+ * @return      The index of the route or ROUTING_NO_ROUTE if the memory
+ *              cannot be allocated.
+ */
+static uint32_t routing_add_route (routing_table_t table, const struct route* route)
+{
+    struct route* routes;
+    uint32_t capacity;
+
+    if (table->routes_number == table->routes_capacity)
+    {
+        capacity = (table->routes_capacity > 0) ? table->routes_capacity * 2 : 1024;
+
+        // The top bit of the entries marks the tbl8 groups.
+        if (capacity >= ROUTING_TBL8_FLAG)
+        {
+            return ROUTING_NO_ROUTE;
+        }
+
+        routes = (struct route*) realloc(table->routes, capacity * sizeof(struct route));
+
+        if (routes == NULL)
+        {
+            return ROUTING_NO_ROUTE;
+        }
+
+        table->routes = routes;
+        table->routes_capacity = capacity;
+    }
+
+    table->routes[table->routes_number] = *route;
+
+    return table->routes_number++;
+}
+
+/*
+ * The helper function for getting a new tbl8 group filled with the route
+ * of the covering tbl24 entry.
+ *
+ * @param table Pointer to the routing table.
+ * @param route The route of the covering entry.
+ * @return      The index of the group or ROUTING_TBL8_FLAG if the memory
+ *              cannot be allocated.
+ */
+static uint32_t routing_add_group (routing_table_t table, uint32_t route)
+{
+    uint32_t* tbl8;
+    uint32_t capacity;
+    uint32_t group;
+
+    if (table->tbl8_groups == table->tbl8_capacity)
+    {
+        capacity = (table->tbl8_capacity > 0) ? table->tbl8_capacity * 2 : 256;
+
+        tbl8 = (uint32_t*) realloc(table->tbl8,
+                                   (size_t) capacity * ROUTING_TBL8_SIZE * sizeof(uint32_t));
+
+        if (tbl8 == NULL)
+        {
+            return ROUTING_TBL8_FLAG;
+        }
+
+        table->tbl8 = tbl8;
+        table->tbl8_capacity = capacity;
+    }
+
+    group = table->tbl8_groups++;
+
+    for (uint32_t i = 0; i < ROUTING_TBL8_SIZE; i++)
+    {
+        table->tbl8[group * ROUTING_TBL8_SIZE + i] = route;
+    }
+
+    return group;
+}
+
+/*
+ * The helper function for inserting a prefix. The shorter prefixes
+ * have to be inserted first.
+ *
+ * @param table  Pointer to the routing table.
+ * @param prefix The inserted prefix.
+ * @return       Status of function processing.
+ */
+static uint8_t routing_insert (routing_table_t table, routing_prefix_t prefix)
+{
+    uint32_t first;
+    uint32_t count;
+    uint32_t entry;
+    uint32_t group;
+
+    if (prefix->length <= ROUTING_TBL24_BITS)
+    {
+        first = prefix->addr >> 8;
+        count = UINT32_C(1) << (ROUTING_TBL24_BITS - prefix->length);
+
+        for (uint32_t i = first; i < first + count; i++)
+        {
+            entry = table->tbl24[i];
+
+            if (entry & ROUTING_TBL8_FLAG)
+            {
+                group = entry & ~ROUTING_TBL8_FLAG;
+
+                for (uint32_t j = 0; j < ROUTING_TBL8_SIZE; j++)
+                {
+                    table->tbl8[group * ROUTING_TBL8_SIZE + j] = prefix->route;
+                }
+            }
+            else
+            {
+                table->tbl24[i] = prefix->route;
+            }
+        }
+
+        return NO_ERROR;
+    }
+
+    entry = table->tbl24[prefix->addr >> 8];
+
+    if (entry & ROUTING_TBL8_FLAG)
+    {
+        group = entry & ~ROUTING_TBL8_FLAG;
+    }
+    else
+    {
+        group = routing_add_group(table, entry);
+
+        if (group == ROUTING_TBL8_FLAG)
+        {
+            return MEMORY_HANDLING_ERROR;
+        }
+
+        table->tbl24[prefix->addr >> 8] = group | ROUTING_TBL8_FLAG;
+    }
+
+    first = prefix->addr & (ROUTING_TBL8_SIZE - 1);
+    count = UINT32_C(1) << (32 - prefix->length);
+
+    for (uint32_t i = first; i < first + count; i++)
+    {
+        table->tbl8[group * ROUTING_TBL8_SIZE + i] = prefix->route;
+    }
+
+    return NO_ERROR;
+}
+
+/*
+ * The helper function for parsing a line of the routing table file.
+ *
+ * @param line   The parsed line.
+ * @param prefix Output parameter for the prefix.
+ * @param route  Output parameter for the route.
+ * @return       True if the line is valid.
+ */
+static bool routing_parse_line (char* line, routing_prefix_t prefix, route_t route)
+{
+    char* address = strtok(line, " \t\r\n");
+    char* as = strtok(NULL, " \t\r\n");
+    char* nexthop = strtok(NULL, " \t\r\n");
+    char* length;
+    char* end;
+    struct in_addr addr;
+    unsigned long value;
+
+    if (address == NULL || as == NULL || (length = strchr(address, '/')) == NULL)
+    {
+        return false;
+    }
+
+    *length++ = '\0';
+
+    if (inet_pton(AF_INET, address, &addr) != 1)
+    {
+        return false;
+    }
+
+    value = strtoul(length, &end, 10);
+
+    if (*length == '\0' || *end != '\0' || value > 32)
+    {
+        return false;
+    }
+
+    prefix->length = (uint8_t) value;
+    // The host bits are cleared, the shift by 32 is undefined.
+    prefix->addr = (value == 0) ? 0 : ntohl(addr.s_addr) & (UINT32_MAX << (32 - value));
+
+    // The AS may be written as "AS65000".
+    if (strncmp(as, "AS", 2) == 0)
+    {
+        as += 2;
+    }
+
+    value = strtoul(as, &end, 10);
+
+    if (*as == '\0' || *end != '\0' || value > UINT32_MAX)
+    {
+        return false;
+    }
+
+    route->as = (uint32_t) value;
+    route->mask = prefix->length;
+    route->nexthop = 0;
+
+    if (nexthop != NULL)
+    {
+        if (inet_pton(AF_INET, nexthop, &addr) != 1)
+        {
+            return false;
+        }
+
+        route->nexthop = addr.s_addr;
+    }
+
+    return true;
+}
+
+/*
+ * Function for loading the routing table from a text file. Every line
+ * contains a prefix, the AS number and optionally the next hop:
+ *
+ *     <address>/<length> <as> [<nexthop>]
+ *
+ * The empty lines and the lines starting with '#' are skipped. The longer
+ * prefixes are inserted after the shorter ones, so they overwrite them.
+ *
+ * @param table     Pointer to the allocated routing table.
+ * @param file_name The name of the file.
+ * @return          Status of function processing.
+ */
+uint8_t routing_load (routing_table_t table, const char* file_name)
+{
+    static const struct route no_route = { 0, 0, 0 };
+    uint8_t status = NO_ERROR;
+    char line[ROUTING_LINE_LENGTH];
+    char* start;
+    FILE* file;
+    routing_prefix_t prefixes = NULL;
+    routing_prefix_t resized;
+    uint32_t prefixes_number = 0;
+    uint32_t prefixes_capacity = 0;
+    struct route route;
+
+    file = fopen(file_name, "r");
+
+    if (file == NULL)
+    {
+        return ROUTING_FILE_ERROR;
+    }
+
+    routing_add_route(table, &no_route);
+
+    while (status == NO_ERROR && fgets(line, sizeof(line), file) != NULL)
+    {
+        start = line + strspn(line, " \t");
+
+        if (*start == '#' || *start == '\n' || *start == '\r' || *start == '\0')
+        {
+            continue;
+        }
+
+        if (prefixes_number == prefixes_capacity)
+        {
+            prefixes_capacity = (prefixes_capacity > 0) ? prefixes_capacity * 2 : 1024;
+            resized = (routing_prefix_t) realloc(prefixes,
+                                                 prefixes_capacity * sizeof(struct routing_prefix));
+
+            if (resized == NULL)
+            {
+                status = MEMORY_HANDLING_ERROR;
+                break;
+            }
+
+            prefixes = resized;
+        }
+
+        if (!routing_parse_line(start, &(prefixes[prefixes_number]), &route))
+        {
+            status = ROUTING_FILE_ERROR;
+            break;
+        }
+
+        prefixes[prefixes_number].route = routing_add_route(table, &route);
+
+        if (prefixes[prefixes_number].route == ROUTING_NO_ROUTE)
+        {
+            status = MEMORY_HANDLING_ERROR;
+            break;
+        }
+
+        prefixes_number++;
+    }
+
+    fclose(file);
+
+    if (status == NO_ERROR)
+    {
+        qsort(prefixes, prefixes_number, sizeof(struct routing_prefix), compare_prefixes);
+
+        for (uint32_t i = 0; i < prefixes_number && status == NO_ERROR; i++)
+        {
+            status = routing_insert(table, &(prefixes[i]));
+        }
+    }
+
+    free(prefixes);
+
+    return status;
+}
+
+/*
+ * Function for finding the longest prefix match of an address.
+ *
+ * @param table Pointer to the routing table.
+ * @param addr  The address in the network byte order.
+ * @return      The matched route or NULL if the address has no route.
+ */
+route_t routing_lookup (routing_table_t table, uint32_t addr)
+{
+    uint32_t host_addr = ntohl(addr);
+    uint32_t entry = table->tbl24[host_addr >> 8];
+
+    if (entry & ROUTING_TBL8_FLAG)
+    {
+        entry = table->tbl8[(entry & ~ROUTING_TBL8_FLAG) * ROUTING_TBL8_SIZE +
+                            (host_addr & (ROUTING_TBL8_SIZE - 1))];
+    }
+
+    table->lookups_number++;
+
+    if (entry == ROUTING_NO_ROUTE)
+    {
+        table->misses_number++;
+
+        return NULL;
+    }
+
+    return &(table->routes[entry]);
+}
+
+/*
+ * Function for computing the memory occupied by the routing table.
+ * Only the touched pages of the tbl24 are counted.
+ *
+ * @param table Pointer to the routing table.
+ * @return      The memory size in bytes.
+ */
+size_t routing_memory_size (routing_table_t table)
+{
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    size_t pages_number = (table->tbl24_size + page_size - 1) / page_size;
+    size_t memory_size = (size_t) table->tbl8_capacity * ROUTING_TBL8_SIZE * sizeof(uint32_t) +
+                         (size_t) table->routes_capacity * sizeof(struct route);
+    unsigned char* residency = (unsigned char*) malloc(pages_number);
+
+    if (residency != NULL && mincore(table->tbl24, table->tbl24_size, residency) == 0)
+    {
+        for (size_t i = 0; i < pages_number; i++)
+        {
+            memory_size += (residency[i] & 1) ? page_size : 0;
+        }
+    }
+    else
+    {
+        memory_size += table->tbl24_size;
+    }
+
+    free(residency);
+
+    return memory_size;
+}
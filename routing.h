@@ -0,0 +1,96 @@
+/**********************************************************/
+/*                                                        */
+/* File: routing.h                                        */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Header file for the routing table         */
+/*                                                        */
+/**********************************************************/
+
+#ifndef FLOW_ROUTING_H
+#define FLOW_ROUTING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ROUTING_TBL24_BITS (24)
+#define ROUTING_TBL24_SIZE (1 << ROUTING_TBL24_BITS)
+#define ROUTING_TBL8_SIZE  (256)
+#define ROUTING_TBL8_FLAG  (UINT32_C(0x80000000)) // The entry is a tbl8 group.
+#define ROUTING_NO_ROUTE   (0)
+#define ROUTING_AS_TRANS   (23456) // RFC 6793, a 4-byte AS in a 2-byte field.
+
+typedef struct route* route_t;
+typedef struct routing_table* routing_table_t;
+
+/*
+ * Structure to store the values of a route exported in the NetFlow records.
+ */
+struct route
+{
+    uint32_t nexthop; // In the network byte order.
+    uint32_t as;
+    uint8_t mask;
+};
+
+/*
+ * Structure to store the routing table as the DIR-24-8 longest prefix match.
+ * The tbl24 is indexed by the upper 24 bits of the address, its entry
+ * is the index of the route (ROUTING_NO_ROUTE if none) or the index
+ * of a tbl8 group with the ROUTING_TBL8_FLAG. A tbl8 group is indexed
+ * by the lower 8 bits of the address and stores the route indexes
+ * of the prefixes longer than 24 bits. So a lookup reads one or two entries.
+ *
+ * The tbl24 is mapped without the reserved memory, only the pages
+ * covered by the prefixes occupy the memory.
+ */
+struct routing_table
+{
+    uint32_t* tbl24;
+    size_t tbl24_size;        // Size of the tbl24 in bytes.
+    uint32_t* tbl8;
+    uint32_t tbl8_groups;     // The number of used tbl8 groups.
+    uint32_t tbl8_capacity;   // The number of allocated tbl8 groups.
+    struct route* routes;     // The route 0 is ROUTING_NO_ROUTE.
+    uint32_t routes_number;
+    uint32_t routes_capacity;
+    uint64_t lookups_number;
+    uint64_t misses_number;   // The lookups without a route.
+};
+
+/*
+ * Function for loading the routing table from a text file. Every line
+ * contains a prefix, the AS number and optionally the next hop:
+ *
+ *     <address>/<length> <as> [<nexthop>]
+ *
+ * The empty lines and the lines starting with '#' are skipped. The longer
+ * prefixes are inserted after the shorter ones, so they overwrite them.
+ *
+ * @param table     Pointer to the allocated routing table.
+ * @param file_name The name of the file.
+ * @return          Status of function processing.
+ */
+uint8_t routing_load (routing_table_t table, const char* file_name);
+
+/*
+ * Function for finding the longest prefix match of an address.
+ *
+ * @param table Pointer to the routing table.
+ * @param addr  The address in the network byte order.
+ * @return      The matched route or NULL if the address has no route.
+ */
+route_t routing_lookup (routing_table_t table, uint32_t addr);
+
+/*
+ * Function for computing the memory occupied by the routing table.
+ * Only the touched pages of the tbl24 are counted.
+ *
+ * @param table Pointer to the routing table.
+ * @return      The memory size in bytes.
+ */
+size_t routing_memory_size (routing_table_t table);
+
+#endif // FLOW_ROUTING_H
@@ -0,0 +1,383 @@
+/**********************************************************/
+/*                                                        */
+/* File: sampling.c                                       */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Packet sampling for the NetFlow exporter  */
+/*                                                        */
+/**********************************************************/
+
+#include "sampling.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * The helper function for generating a pseudo-random number.
+ *
+ * The function is the xorshift64* generator:
+ *
+ * Source: https://en.wikipedia.org/wiki/Xorshift#xorshift*
+ * Author: Sebastiano Vigna
+ *
+ * @param state Pointer to the state of the generator.
+ * @return      The pseudo-random number.
+ */
+static uint64_t random_next (uint64_t* state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+
+    return *state * 0x2545f4914f6cdd1dULL;
+}
+
+/*
+ * The helper function for starting a new sampling window.
+ *
+ * @param sampling Pointer to the sampling state.
+ */
+static void sampling_new_window (packet_sampling_t sampling)
+{
+    sampling->position = 0;
+
+    if (sampling->mode == SAMPLING_RANDOM)
+    {
+        sampling->selected = (uint16_t) (random_next(&(sampling->random_state)) %
+                                         sampling->interval);
+    }
+    else
+    {
+        sampling->selected = 0;
+    }
+}
+
+/*
+ * Function for parsing the sampling mode name.
+ *
+ * @param name The name of the mode (count, random or flow).
+ * @return     The sampling mode or SAMPLING_NONE for an unknown name.
+ */
+uint8_t sampling_parse_mode (const char* name)
+{
+    if (strcmp(name, "count") == 0)
+    {
+        return SAMPLING_DETERMINISTIC;
+    }
+
+    if (strcmp(name, "random") == 0)
+    {
+        return SAMPLING_RANDOM;
+    }
+
+    if (strcmp(name, "flow") == 0)
+    {
+        return SAMPLING_FLOW;
+    }
+
+    return SAMPLING_NONE;
+}
+
+/*
+ * Function for getting the name of the sampling mode.
+ *
+ * @param mode The sampling mode.
+ * @return     The name of the mode.
+ */
+const char* sampling_mode_name (uint8_t mode)
+{
+    static const char* mode_names[] =
+    {
+        "none",
+        "count",
+        "random",
+        "flow"
+    };
+
+    if (mode > SAMPLING_FLOW)
+    {
+        mode = SAMPLING_NONE;
+    }
+
+    return mode_names[mode];
+}
+
+/*
+ * Function for the sampling initialization.
+ *
+ * @param sampling Pointer to the sampling state.
+ * @param mode     The sampling mode.
+ * @param interval The sampling interval (1 out of interval is processed).
+ */
+void sampling_init (packet_sampling_t sampling, uint8_t mode, uint16_t interval)
+{
+    sampling->mode = mode;
+    sampling->seen_packets = 0;
+    sampling->sampled_packets = 0;
+    sampling->base_mode = mode;
+    sampling->base_interval = (mode == SAMPLING_NONE) ? 1 : interval;
+    sampling->max_lag_ms = 0;
+    sampling->raises_number = 0;
+    sampling->lowers_number = 0;
+    sampling->max_interval = sampling->base_interval;
+
+    // The generator state must not be zero.
+    sampling->random_state = ((uint64_t) time(NULL) << 20) ^ (uint64_t) getpid();
+    sampling->random_state |= 1;
+
+    sampling_set_interval(sampling, (mode == SAMPLING_NONE) ? 1 : interval);
+}
+
+/*
+ * Function for changing the sampling interval. The current sampling window
+ * is restarted.
+ *
+ * @param sampling Pointer to the sampling state.
+ * @param interval The new sampling interval.
+ */
+void sampling_set_interval (packet_sampling_t sampling, uint16_t interval)
+{
+    sampling->interval = interval;
+    sampling->flow_threshold = (uint32_t) (((uint64_t) UINT32_MAX + 1) / interval - 1);
+
+    sampling_new_window(sampling);
+}
+
+/*
+ * The helper function for getting a time in microseconds.
+ *
+ * @param time The time value.
+ * @return     The time in microseconds.
+ */
+static int64_t timeval_us (const struct timeval* time)
+{
+    return (int64_t) time->tv_sec * 1000000 + time->tv_usec;
+}
+
+/*
+ * Function for enabling the load shedding. The sampling interval is raised
+ * stepwise when the processing lag exceeds the limit or packets are dropped,
+ * and it is lowered back to the interval set by user when the load subsides.
+ *
+ * @param sampling   Pointer to the sampling state.
+ * @param max_lag_ms The allowed processing lag in milliseconds.
+ */
+void sampling_enable_shedding (packet_sampling_t sampling, uint32_t max_lag_ms)
+{
+    sampling->max_lag_ms = max_lag_ms;
+    sampling->check_countdown = SHEDDING_CHECK_PACKETS;
+    sampling->calm_periods = 0;
+    sampling->min_delay_us = INT64_MAX;
+    sampling->last_change_us = 0;
+    sampling->last_lag_ms = 0;
+    sampling->dropped_packets = 0;
+}
+
+/*
+ * Function for finding out if the load should be checked. The function
+ * is called for every packet, the load is checked once per
+ * SHEDDING_CHECK_PACKETS packets.
+ *
+ * @param sampling Pointer to the sampling state.
+ * @return         True if the load should be checked, false otherwise.
+ */
+bool sampling_shedding_due (packet_sampling_t sampling)
+{
+    if (sampling->max_lag_ms == 0 || --(sampling->check_countdown) > 0)
+    {
+        return false;
+    }
+
+    sampling->check_countdown = SHEDDING_CHECK_PACKETS;
+
+    return true;
+}
+
+/*
+ * Function for adapting the sampling interval to the load. The lag is
+ * the delay between the packet time stamp and the wall clock compared
+ * to the smallest delay seen, so the clock offset of the capture does not
+ * matter and a file read faster than real time has no lag.
+ *
+ * @param sampling        Pointer to the sampling state.
+ * @param packet_time     The time stamp of the current packet.
+ * @param dropped_packets The total number of packets dropped by the capture.
+ */
+void sampling_shed_load (packet_sampling_t sampling,
+                         const struct timeval* packet_time,
+                         uint64_t dropped_packets)
+{
+    struct timeval wall_time;
+    int64_t now_us;
+    int64_t delay_us;
+    int64_t lag_ms;
+    bool dropped = (dropped_packets > sampling->dropped_packets);
+    bool growing;
+    uint32_t interval = sampling->interval;
+
+    gettimeofday(&wall_time, NULL);
+
+    now_us = timeval_us(&wall_time);
+    delay_us = now_us - timeval_us(packet_time);
+
+    if (delay_us < sampling->min_delay_us)
+    {
+        sampling->min_delay_us = delay_us;
+    }
+
+    sampling->dropped_packets = dropped_packets;
+
+    // The load is evaluated once per period, so a change has time
+    // to take effect.
+    if (now_us - sampling->last_change_us < SHEDDING_PERIOD_MS * 1000)
+    {
+        return;
+    }
+
+    sampling->last_change_us = now_us;
+    lag_ms = (delay_us - sampling->min_delay_us) / 1000;
+    growing = (lag_ms >= sampling->last_lag_ms);
+    sampling->last_lag_ms = lag_ms;
+
+    if (dropped || (lag_ms > (int64_t) sampling->max_lag_ms && growing))
+    {
+        // Falling behind, double the interval. While the lag decreases,
+        // the backlog is being processed and the interval is kept.
+        sampling->calm_periods = 0;
+
+        if (interval >= SAMPLING_INTERVAL_MAX)
+        {
+            return;
+        }
+
+        interval = (interval * 2 > SAMPLING_INTERVAL_MAX) ? SAMPLING_INTERVAL_MAX :
+                                                            interval * 2;
+
+        if (sampling->mode == SAMPLING_NONE)
+        {
+            sampling->mode = SAMPLING_DETERMINISTIC;
+        }
+
+        sampling->raises_number++;
+    }
+    else if (lag_ms < (int64_t) sampling->max_lag_ms / 4 &&
+             interval > sampling->base_interval)
+    {
+        // The load subsides, halve the interval after a few calm periods.
+        if (++(sampling->calm_periods) < SHEDDING_CALM_PERIODS)
+        {
+            return;
+        }
+
+        sampling->calm_periods = 0;
+        interval = (interval / 2 < sampling->base_interval) ? sampling->base_interval :
+                                                              interval / 2;
+
+        if (interval == sampling->base_interval)
+        {
+            sampling->mode = sampling->base_mode;
+        }
+
+        sampling->lowers_number++;
+    }
+    else
+    {
+        sampling->calm_periods = 0;
+
+        return;
+    }
+
+    if (interval > sampling->max_interval)
+    {
+        sampling->max_interval = (uint16_t) interval;
+    }
+
+    sampling_set_interval(sampling, (uint16_t) interval);
+}
+
+/*
+ * Function for deciding if the packet is processed by the packet sampling.
+ * Packets are always processed by the flow sampling mode.
+ *
+ * @param sampling Pointer to the sampling state.
+ * @return         True if the packet is processed, false otherwise.
+ */
+bool sampling_keep_packet (packet_sampling_t sampling)
+{
+    bool keep = true;
+
+    sampling->seen_packets++;
+
+    if ((sampling->mode == SAMPLING_DETERMINISTIC || sampling->mode == SAMPLING_RANDOM) &&
+        sampling->interval > 1)
+    {
+        keep = (sampling->position == sampling->selected);
+        sampling->position++;
+
+        if (sampling->position == sampling->interval)
+        {
+            sampling_new_window(sampling);
+        }
+    }
+
+    if (keep)
+    {
+        sampling->sampled_packets++;
+    }
+
+    return keep;
+}
+
+/*
+ * Function for deciding if a new flow is processed by the flow sampling.
+ * The function is called only for the flows not found in the flow cache,
+ * so the cached flows keep all their packets when the interval changes.
+ * All flows are processed by the packet sampling modes.
+ *
+ * @param sampling  Pointer to the sampling state.
+ * @param flow_hash The hash of the flow key.
+ * @return          True if the flow is processed, false otherwise.
+ */
+bool sampling_keep_flow (packet_sampling_t sampling, uint32_t flow_hash)
+{
+    if (sampling->mode != SAMPLING_FLOW || sampling->interval <= 1)
+    {
+        return true;
+    }
+
+    // The flow hash selects also the bucket of the flow cache by its lower
+    // bits, so the hash is scrambled by a multiplication before the threshold
+    // check. Otherwise, all selected flows would share a few buckets.
+    if ((uint32_t) (flow_hash * 0x9e3779b1U) <= sampling->flow_threshold)
+    {
+        return true;
+    }
+
+    // The packet was already counted as sampled.
+    sampling->sampled_packets--;
+
+    return false;
+}
+
+/*
+ * Function for getting the value of the NetFlow v5 header sampling_interval
+ * field in the host byte order.
+ *
+ * @param sampling Pointer to the sampling state.
+ * @return         The value of the sampling_interval field.
+ */
+uint16_t sampling_header_value (packet_sampling_t sampling)
+{
+    if (sampling->mode == SAMPLING_NONE)
+    {
+        return 0;
+    }
+
+    return (uint16_t) ((sampling->mode << SAMPLING_MODE_SHIFT) | sampling->interval);
+}
@@ -0,0 +1,169 @@
+/**********************************************************/
+/*                                                        */
+/* File: sampling.h                                       */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Header file for the packet sampling       */
+/*                                                        */
+/**********************************************************/
+
+#ifndef FLOW_SAMPLING_H
+#define FLOW_SAMPLING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+// The interval is stored in the lower 14 bits of the NetFlow v5 header
+// sampling_interval field, the mode is stored in the upper 2 bits.
+#define SAMPLING_INTERVAL_MIN  (1)
+#define SAMPLING_INTERVAL_MAX  (0x3FFF)
+#define SAMPLING_MODE_SHIFT    (14)
+
+#define SHEDDING_CHECK_PACKETS (1024) // Packets between the load checks.
+#define SHEDDING_PERIOD_MS     (100)  // The minimum time between rate changes.
+#define SHEDDING_CALM_PERIODS  (5)    // Calm periods before lowering the rate.
+
+typedef struct packet_sampling* packet_sampling_t;
+
+/*
+ * Enumeration of the sampling modes. The values are the NetFlow v5 sampling
+ * mode values, the flow sampling uses the value not defined by NetFlow v5.
+ */
+enum sampling_mode
+{
+    SAMPLING_NONE = 0,          // Every packet is processed.
+    SAMPLING_DETERMINISTIC = 1, // Every N-th packet is processed.
+    SAMPLING_RANDOM = 2,        // One random packet of every N packets.
+    SAMPLING_FLOW = 3           // 1/N of flows selected by the flow key hash.
+};
+
+/*
+ * Structure to store the state of the sampling.
+ */
+struct packet_sampling
+{
+    uint8_t mode;
+    uint16_t interval;
+    uint16_t position;      // Position of the packet in the current window.
+    uint16_t selected;      // Position of the selected packet in the window.
+    uint32_t flow_threshold; // The flows with a lower hash value are selected.
+    uint64_t random_state;
+    uint64_t seen_packets;
+    uint64_t sampled_packets;
+    // Load shedding, the interval is raised when the processing falls behind.
+    uint8_t base_mode;       // The mode set by user.
+    uint16_t base_interval;  // The interval set by user.
+    uint32_t max_lag_ms;     // The allowed lag, 0 disables the load shedding.
+    uint32_t check_countdown;
+    uint32_t calm_periods;
+    int64_t min_delay_us;    // The smallest delay of packet processing seen.
+    int64_t last_change_us;  // The wall time of the last evaluation.
+    int64_t last_lag_ms;     // The lag of the last evaluation.
+    uint64_t dropped_packets;
+    uint64_t raises_number;
+    uint64_t lowers_number;
+    uint16_t max_interval;   // The largest interval used.
+};
+
+/*
+ * Function for parsing the sampling mode name.
+ *
+ * @param name The name of the mode (count, random or flow).
+ * @return     The sampling mode or SAMPLING_NONE for an unknown name.
+ */
+uint8_t sampling_parse_mode (const char* name);
+
+/*
+ * Function for getting the name of the sampling mode.
+ *
+ * @param mode The sampling mode.
+ * @return     The name of the mode.
+ */
+const char* sampling_mode_name (uint8_t mode);
+
+/*
+ * Function for the sampling initialization.
+ *
+ * @param sampling Pointer to the sampling state.
+ * @param mode     The sampling mode.
+ * @param interval The sampling interval (1 out of interval is processed).
+ */
+void sampling_init (packet_sampling_t sampling, uint8_t mode, uint16_t interval);
+
+/*
+ * Function for changing the sampling interval. The current sampling window
+ * is restarted.
+ *
+ * @param sampling Pointer to the sampling state.
+ * @param interval The new sampling interval.
+ */
+void sampling_set_interval (packet_sampling_t sampling, uint16_t interval);
+
+/*
+ * Function for enabling the load shedding. The sampling interval is raised
+ * stepwise when the processing lag exceeds the limit or packets are dropped,
+ * and it is lowered back to the interval set by user when the load subsides.
+ *
+ * @param sampling   Pointer to the sampling state.
+ * @param max_lag_ms The allowed processing lag in milliseconds.
+ */
+void sampling_enable_shedding (packet_sampling_t sampling, uint32_t max_lag_ms);
+
+/*
+ * Function for finding out if the load should be checked. The function
+ * is called for every packet, the load is checked once per
+ * SHEDDING_CHECK_PACKETS packets.
+ *
+ * @param sampling Pointer to the sampling state.
+ * @return         True if the load should be checked, false otherwise.
+ */
+bool sampling_shedding_due (packet_sampling_t sampling);
+
+/*
+ * Function for adapting the sampling interval to the load. The lag is
+ * the delay between the packet time stamp and the wall clock compared
+ * to the smallest delay seen, so the clock offset of the capture does not
+ * matter and a file read faster than real time has no lag.
+ *
+ * @param sampling        Pointer to the sampling state.
+ * @param packet_time     The time stamp of the current packet.
+ * @param dropped_packets The total number of packets dropped by the capture.
+ */
+void sampling_shed_load (packet_sampling_t sampling,
+                         const struct timeval* packet_time,
+                         uint64_t dropped_packets);
+
+/*
+ * Function for deciding if the packet is processed by the packet sampling.
+ * Packets are always processed by the flow sampling mode.
+ *
+ * @param sampling Pointer to the sampling state.
+ * @return         True if the packet is processed, false otherwise.
+ */
+bool sampling_keep_packet (packet_sampling_t sampling);
+
+/*
+ * Function for deciding if a new flow is processed by the flow sampling.
+ * The function is called only for the flows not found in the flow cache,
+ * so the cached flows keep all their packets when the interval changes.
+ * All flows are processed by the packet sampling modes.
+ *
+ * @param sampling  Pointer to the sampling state.
+ * @param flow_hash The hash of the flow key.
+ * @return          True if the flow is processed, false otherwise.
+ */
+bool sampling_keep_flow (packet_sampling_t sampling, uint32_t flow_hash);
+
+/*
+ * Function for getting the value of the NetFlow v5 header sampling_interval
+ * field in the host byte order.
+ *
+ * @param sampling Pointer to the sampling state.
+ * @return         The value of the sampling_interval field.
+ */
+uint16_t sampling_header_value (packet_sampling_t sampling);
+
+#endif // FLOW_SAMPLING_H
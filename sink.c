@@ -0,0 +1,268 @@
+/**********************************************************/
+/*                                                        */
+/* File: sink.c                                           */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Flow file sink                            */
+/*                                                        */
+/**********************************************************/
+
+#include "sink.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "error.h"
+
+/*
+ * The helper function for converting a time stamp into the milliseconds
+ * since the epoch.
+ *
+ * @param time The time stamp.
+ * @return     The milliseconds since the epoch.
+ */
+static uint64_t sink_epoch_ms (const struct timeval* time)
+{
+    return (uint64_t) time->tv_sec * 1000 + (uint64_t) time->tv_usec / 1000;
+}
+
+/*
+ * The helper function for extending the file by the next segment
+ * and mapping it. The previous segment is unmapped, its pages are written
+ * back by the kernel. The blocks of the segment are reserved first,
+ * so a full disk fails here instead of on a store into the mapping.
+ * The file without the reservation support is only extended.
+ *
+ * @param sink Pointer to the sink.
+ * @return     Status of function processing.
+ */
+static uint8_t sink_next_segment (flow_sink_t sink)
+{
+    void* segment;
+    uint64_t offset = 0;
+    int return_code;
+
+    if (sink->segment != NULL)
+    {
+        munmap(sink->segment, SINK_SEGMENT_SIZE);
+        sink->segment = NULL;
+
+        offset = sink->segment_offset + SINK_SEGMENT_SIZE;
+    }
+
+    // On a failure, the offset and the length still describe
+    // the last written segment for the close.
+    return_code = posix_fallocate(sink->fd, (off_t) offset, SINK_SEGMENT_SIZE);
+
+    if (return_code == EOPNOTSUPP)
+    {
+        return_code = ftruncate(sink->fd, (off_t) (offset + SINK_SEGMENT_SIZE));
+    }
+
+    if (return_code != 0)
+    {
+        return SINK_FILE_ERROR;
+    }
+
+    segment = mmap(NULL, SINK_SEGMENT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   sink->fd, (off_t) offset);
+
+    if (segment == MAP_FAILED)
+    {
+        return SINK_FILE_ERROR;
+    }
+
+    sink->segment = (uint8_t*) segment;
+    sink->segment_offset = offset;
+    // The header is written at the start of the first segment on close.
+    sink->segment_length = (offset == 0) ? sizeof(struct sink_file_header) : 0;
+    sink->segments_number++;
+
+    return NO_ERROR;
+}
+
+/*
+ * Function for opening the flow file. The file is created or truncated.
+ *
+ * @param sink      Pointer to the sink.
+ * @param file_name The name of the file.
+ * @return          Status of function processing.
+ */
+uint8_t sink_open (flow_sink_t sink, const char* file_name)
+{
+    sink->segment = NULL;
+    sink->segment_offset = 0;
+    sink->segment_length = 0;
+    sink->records_number = 0;
+    sink->segments_number = 0;
+
+    sink->fd = open(file_name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if (sink->fd == -1)
+    {
+        return SINK_FILE_ERROR;
+    }
+
+    return NO_ERROR;
+}
+
+/*
+ * Function for filling a record of one direction of a flow.
+ *
+ * @param record  The filled record.
+ * @param flow    The written flow.
+ * @param reverse The reverse direction of the biflow is filled.
+ */
+void sink_fill_record (sink_record_t record, flow_node_t flow, bool reverse)
+{
+    flow_reverse_t reverse_flow = reverse ? flow_reverse_direction(flow) : NULL;
+
+    if (reverse_flow != NULL)
+    {
+        record->packets = reverse_flow->packets;
+        record->octets = reverse_flow->octets;
+        record->first_ms = sink_epoch_ms(&(reverse_flow->first));
+        record->last_ms = sink_epoch_ms(&(reverse_flow->last));
+        record->src_addr = flow->dst_addr;
+        record->dst_addr = flow->src_addr;
+        record->nexthop = reverse_flow->nexthop;
+        record->src_as = flow->dst_as;
+        record->dst_as = flow->src_as;
+        record->src_port = flow->dst_port;
+        record->dst_port = flow->src_port;
+        record->tcp_flags = reverse_flow->tcp_flags;
+        record->src_mask = flow->dst_mask;
+        record->dst_mask = flow->src_mask;
+    }
+    else
+    {
+        record->packets = flow->packets;
+        record->octets = flow->octets;
+        record->first_ms = sink_epoch_ms(&(flow->first));
+        record->last_ms = sink_epoch_ms(&(flow->last));
+        record->src_addr = flow->src_addr;
+        record->dst_addr = flow->dst_addr;
+        record->nexthop = flow->nexthop;
+        record->src_as = flow->src_as;
+        record->dst_as = flow->dst_as;
+        record->src_port = flow->src_port;
+        record->dst_port = flow->dst_port;
+        record->tcp_flags = flow->tcp_flags;
+        record->src_mask = flow->src_mask;
+        record->dst_mask = flow->dst_mask;
+    }
+
+    record->prot = flow->prot;
+    record->tos = flow->tos;
+    memset(record->pad, 0, sizeof(record->pad));
+}
+
+/*
+ * Function for writing flows into the flow file. A biflow is written
+ * as two records, one per direction.
+ *
+ * @param sink         Pointer to the sink.
+ * @param flows        An array of flows to write.
+ * @param flows_number The number of flows in the array of flows to write.
+ * @return             Status of function processing.
+ */
+uint8_t sink_write_flows (flow_sink_t sink,
+                          flow_node_t* flows,
+                          const uint16_t flows_number)
+{
+    uint8_t status = NO_ERROR;
+
+    for (uint16_t i = 0; i < flows_number && status == NO_ERROR; i++)
+    {
+        // The initiator direction, then the reverse direction of a biflow.
+        for (uint8_t direction = 0; direction < 2 && status == NO_ERROR; direction++)
+        {
+            if (direction == 1 && flow_reverse_direction(flows[i]) == NULL)
+            {
+                break;
+            }
+
+            if (sink->segment == NULL ||
+                sink->segment_length + sizeof(struct sink_record) > SINK_SEGMENT_SIZE)
+            {
+                status = sink_next_segment(sink);
+
+                if (status != NO_ERROR)
+                {
+                    break;
+                }
+            }
+
+            sink_fill_record((sink_record_t) (sink->segment + sink->segment_length),
+                             flows[i],
+                             direction == 1);
+
+            sink->segment_length += sizeof(struct sink_record);
+            sink->records_number++;
+        }
+    }
+
+    return status;
+}
+
+/*
+ * Function for closing the flow file. The header is written
+ * and the file is truncated to the written records.
+ *
+ * @param netflow_records Pointer to the netflow recording system.
+ * @param sink            Pointer to the sink.
+ * @return                Status of function processing.
+ */
+uint8_t sink_close (netflow_recording_system_t netflow_records, flow_sink_t sink)
+{
+    uint8_t status = NO_ERROR;
+    struct sink_file_header header;
+    uint64_t file_size = sizeof(header);
+
+    // The records written before a failed extension are kept.
+    if (sink->segments_number > 0)
+    {
+        file_size = sink->segment_offset + sink->segment_length;
+    }
+
+    if (sink->segment != NULL)
+    {
+        munmap(sink->segment, SINK_SEGMENT_SIZE);
+        sink->segment = NULL;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SINK_MAGIC, sizeof(header.magic));
+    header.version = SINK_VERSION;
+    header.header_size = sizeof(header);
+    header.record_size = sizeof(struct sink_record);
+    header.byte_order = SINK_BYTE_ORDER;
+    header.records_number = sink->records_number;
+    // The first packet time is known once a flow was written.
+    header.first_packet_ms = (sink->records_number > 0) ?
+                             sink_epoch_ms(netflow_records->first_packet_time) : 0;
+
+    if (ftruncate(sink->fd, (off_t) file_size) != 0 ||
+        pwrite(sink->fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header))
+    {
+        status = SINK_FILE_ERROR;
+    }
+
+    if (close(sink->fd) != 0)
+    {
+        status = SINK_FILE_ERROR;
+    }
+
+    sink->fd = -1;
+
+    return status;
+}
@@ -0,0 +1,131 @@
+/**********************************************************/
+/*                                                        */
+/* File: sink.h                                           */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Header file for the flow file sink        */
+/*                                                        */
+/**********************************************************/
+
+#ifndef FLOW_SINK_H
+#define FLOW_SINK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "netflow_v5.h"
+
+#define SINK_MAGIC        "FLOW"
+#define SINK_VERSION      (1)
+#define SINK_BYTE_ORDER   (0x01020304) // Written in the byte order of the writer.
+#define SINK_SEGMENT_SIZE (64 * 1024 * 1024) // The file is extended by segments.
+
+typedef struct sink_file_header* sink_file_header_t;
+typedef struct sink_record* sink_record_t;
+typedef struct flow_sink* flow_sink_t;
+
+/*
+ * Structure to store the header of the flow file. The header is padded
+ * to the record size, so the records never cross the segments.
+ */
+struct sink_file_header
+{
+    char magic[4];             // SINK_MAGIC without the terminating zero.
+    uint16_t version;
+    uint16_t header_size;
+    uint16_t record_size;
+    uint16_t reserved;
+    uint32_t byte_order;       // SINK_BYTE_ORDER.
+    uint64_t records_number;
+    uint64_t first_packet_ms;  // The first packet time since the epoch.
+    uint8_t pad[32];
+};
+
+/*
+ * Structure to store a flow record of the file. The addresses and
+ * the next hop are in the network byte order, the other fields
+ * in the byte order of the header. The times are in milliseconds
+ * since the epoch.
+ */
+struct sink_record
+{
+    uint64_t packets;
+    uint64_t octets;
+    uint64_t first_ms;
+    uint64_t last_ms;
+    uint32_t src_addr;
+    uint32_t dst_addr;
+    uint32_t nexthop;
+    uint32_t src_as;
+    uint32_t dst_as;
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint8_t tcp_flags;
+    uint8_t prot;
+    uint8_t tos;
+    uint8_t src_mask;
+    uint8_t dst_mask;
+    uint8_t pad[3];
+};
+
+/*
+ * Structure to store the flow file sink. The file is extended
+ * by SINK_SEGMENT_SIZE and only the current segment is mapped, the records
+ * are copied into the mapping without a system call per record. The header
+ * is written when the file is closed.
+ */
+struct flow_sink
+{
+    int fd;
+    uint8_t* segment;         // The mapped current segment or NULL.
+    uint64_t segment_offset;  // The file offset of the current segment.
+    size_t segment_length;    // The used bytes of the current segment.
+    uint64_t records_number;
+    uint64_t segments_number;
+};
+
+/*
+ * Function for opening the flow file. The file is created or truncated.
+ *
+ * @param sink      Pointer to the sink.
+ * @param file_name The name of the file.
+ * @return          Status of function processing.
+ */
+uint8_t sink_open (flow_sink_t sink, const char* file_name);
+
+/*
+ * Function for filling a record of one direction of a flow.
+ *
+ * @param record  The filled record.
+ * @param flow    The written flow.
+ * @param reverse The reverse direction of the biflow is filled.
+ */
+void sink_fill_record (sink_record_t record, flow_node_t flow, bool reverse);
+
+/*
+ * Function for writing flows into the flow file. A biflow is written
+ * as two records, one per direction.
+ *
+ * @param sink         Pointer to the sink.
+ * @param flows        An array of flows to write.
+ * @param flows_number The number of flows in the array of flows to write.
+ * @return             Status of function processing.
+ */
+uint8_t sink_write_flows (flow_sink_t sink,
+                          flow_node_t* flows,
+                          const uint16_t flows_number);
+
+/*
+ * Function for closing the flow file. The header is written
+ * and the file is truncated to the written records.
+ *
+ * @param netflow_records Pointer to the netflow recording system.
+ * @param sink            Pointer to the sink.
+ * @return                Status of function processing.
+ */
+uint8_t sink_close (netflow_recording_system_t netflow_records, flow_sink_t sink);
+
+#endif // FLOW_SINK_H
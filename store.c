@@ -0,0 +1,698 @@
+/**********************************************************/
+/*                                                        */
+/* File: store.c                                          */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Time-indexed flow store                   */
+/*                                                        */
+/**********************************************************/
+
+#include "store.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "error.h"
+
+/*
+ * The helper function for getting the two bits of a value in a Bloom
+ * filter. Both are taken from one multiplicative hash.
+ *
+ * @param value     The value.
+ * @param bits_log2 The size of the filter as the power of two.
+ * @param bits      Output parameter for the two bit indexes.
+ */
+static void store_bloom_bits (uint32_t value, uint8_t bits_log2, uint32_t* bits)
+{
+    uint64_t hash = (uint64_t) value * UINT64_C(0x9E3779B97F4A7C15);
+
+    bits[0] = (uint32_t) (hash >> (64 - bits_log2));
+    bits[1] = (uint32_t) (hash >> (32 - bits_log2)) & ((UINT32_C(1) << bits_log2) - 1);
+}
+
+/*
+ * The helper function for adding a value into a Bloom filter.
+ *
+ * @param bloom     The words of the filter.
+ * @param bits_log2 The size of the filter as the power of two.
+ * @param value     The value.
+ */
+static void store_bloom_add (uint64_t* bloom, uint8_t bits_log2, uint32_t value)
+{
+    uint32_t bits[2];
+
+    store_bloom_bits(value, bits_log2, bits);
+
+    bloom[bits[0] / 64] |= UINT64_C(1) << (bits[0] % 64);
+    bloom[bits[1] / 64] |= UINT64_C(1) << (bits[1] % 64);
+}
+
+/*
+ * The helper function for testing a value in a Bloom filter.
+ *
+ * @param bloom     The words of the filter.
+ * @param bits_log2 The size of the filter as the power of two.
+ * @param value     The value.
+ * @return          False if the filter surely does not contain the value.
+ */
+static bool store_bloom_test (const uint64_t* bloom, uint8_t bits_log2, uint32_t value)
+{
+    uint32_t bits[2];
+
+    store_bloom_bits(value, bits_log2, bits);
+
+    return (bloom[bits[0] / 64] & (UINT64_C(1) << (bits[0] % 64))) &&
+           (bloom[bits[1] / 64] & (UINT64_C(1) << (bits[1] % 64)));
+}
+
+/*
+ * Function for checking whether a block may contain an address.
+ *
+ * @param entry The index entry of the block.
+ * @param addr  The address in the network byte order.
+ * @return      False if the block surely does not contain the address.
+ */
+bool store_block_has_address (store_index_entry_t entry, uint32_t addr)
+{
+    return store_bloom_test(entry->address_bloom, STORE_ADDRESS_BITS, addr);
+}
+
+/*
+ * Function for checking whether a block may contain a port.
+ *
+ * @param entry The index entry of the block.
+ * @param port  The port.
+ * @return      False if the block surely does not contain the port.
+ */
+bool store_block_has_port (store_index_entry_t entry, uint16_t port)
+{
+    return store_bloom_test(entry->port_bloom, STORE_PORT_BITS, port);
+}
+
+/*
+ * The helper function for writing the whole buffer.
+ *
+ * @param fd     The file descriptor.
+ * @param data   The written bytes.
+ * @param length The number of bytes.
+ * @return       Status of function processing.
+ */
+static uint8_t store_write (int fd, const void* data, size_t length)
+{
+    const uint8_t* bytes = data;
+    ssize_t written;
+
+    while (length > 0)
+    {
+        written = write(fd, bytes, length);
+
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (written <= 0)
+        {
+            return STORE_ERROR;
+        }
+
+        bytes += written;
+        length -= (size_t) written;
+    }
+
+    return NO_ERROR;
+}
+
+/*
+ * The helper function for encoding an unsigned varint.
+ *
+ * @param data  The output position.
+ * @param value The encoded value.
+ * @return      The number of written bytes.
+ */
+static size_t store_put_varint (uint8_t* data, uint64_t value)
+{
+    size_t length = 0;
+
+    while (value >= 0x80)
+    {
+        data[length++] = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+
+    data[length++] = (uint8_t) value;
+
+    return length;
+}
+
+/*
+ * The helper function for decoding an unsigned varint.
+ *
+ * @param data   The input position, moved after the varint.
+ * @param end    The end of the input.
+ * @param value  Output parameter for the decoded value.
+ * @return       False if the input ends inside the varint.
+ */
+static bool store_get_varint (const uint8_t** data, const uint8_t* end, uint64_t* value)
+{
+    *value = 0;
+
+    for (uint8_t shift = 0; *data < end && shift < 64; shift += 7)
+    {
+        *value |= (uint64_t) (**data & 0x7F) << shift;
+
+        if ((*(*data)++ & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * The helper function for compressing a block. The first times are
+ * stored as the zigzag deltas of the previous record, the last times
+ * as the durations and the counters and AS numbers as varints.
+ *
+ * @param store Pointer to the store.
+ * @return      The length of the compressed block.
+ */
+static size_t store_encode_block (flow_store_t store)
+{
+    uint8_t* data = store->encoded;
+    uint64_t previous_first = 0;
+    int64_t delta;
+    sink_record_t record;
+
+    for (uint32_t i = 0; i < store->block_records; i++)
+    {
+        record = &(store->block[i]);
+        delta = (int64_t) (record->first_ms - previous_first);
+        previous_first = record->first_ms;
+
+        data += store_put_varint(data, ((uint64_t) delta << 1) ^ (uint64_t) (delta >> 63));
+        data += store_put_varint(data, record->last_ms - record->first_ms);
+        data += store_put_varint(data, record->packets);
+        data += store_put_varint(data, record->octets);
+        data += store_put_varint(data, record->src_as);
+        data += store_put_varint(data, record->dst_as);
+
+        memcpy(data, &(record->src_addr), 3 * sizeof(uint32_t)); // With the next hop.
+        data += 3 * sizeof(uint32_t);
+        memcpy(data, &(record->src_port), 2 * sizeof(uint16_t));
+        data += 2 * sizeof(uint16_t);
+
+        *data++ = record->tcp_flags;
+        *data++ = record->prot;
+        *data++ = record->tos;
+        *data++ = record->src_mask;
+        *data++ = record->dst_mask;
+    }
+
+    return (size_t) (data - store->encoded);
+}
+
+/*
+ * The helper function for decompressing a block.
+ *
+ * @param data           The compressed block.
+ * @param length         The length of the compressed block.
+ * @param records_number The number of records of the block.
+ * @param records        Output parameter for the records.
+ * @return               False if the block is corrupted.
+ */
+static bool store_decode_block (const uint8_t* data,
+                                size_t length,
+                                uint32_t records_number,
+                                sink_record_t records)
+{
+    const uint8_t* end = data + length;
+    uint64_t previous_first = 0;
+    uint64_t values[6];
+    sink_record_t record;
+
+    for (uint32_t i = 0; i < records_number; i++)
+    {
+        record = &(records[i]);
+
+        for (uint8_t j = 0; j < 6; j++)
+        {
+            if (!store_get_varint(&data, end, &(values[j])))
+            {
+                return false;
+            }
+        }
+
+        if ((size_t) (end - data) < 3 * sizeof(uint32_t) + 2 * sizeof(uint16_t) + 5)
+        {
+            return false;
+        }
+
+        previous_first += (values[0] >> 1) ^ (~(values[0] & 1) + 1);
+        record->first_ms = previous_first;
+        record->last_ms = previous_first + values[1];
+        record->packets = values[2];
+        record->octets = values[3];
+        record->src_as = (uint32_t) values[4];
+        record->dst_as = (uint32_t) values[5];
+
+        memcpy(&(record->src_addr), data, 3 * sizeof(uint32_t));
+        data += 3 * sizeof(uint32_t);
+        memcpy(&(record->src_port), data, 2 * sizeof(uint16_t));
+        data += 2 * sizeof(uint16_t);
+
+        record->tcp_flags = *data++;
+        record->prot = *data++;
+        record->tos = *data++;
+        record->src_mask = *data++;
+        record->dst_mask = *data++;
+        memset(record->pad, 0, sizeof(record->pad));
+    }
+
+    return data == end;
+}
+
+/*
+ * The helper function for creating the next segment file. The space
+ * of the header is reserved.
+ *
+ * @param store Pointer to the store.
+ * @return      Status of function processing.
+ */
+static uint8_t store_next_segment (flow_store_t store)
+{
+    char file_name[STORE_NAME_LENGTH];
+    struct store_segment_header header;
+    int directory_fd;
+
+    snprintf(file_name, sizeof(file_name), STORE_NAME_FORMAT, store->segment_number);
+
+    directory_fd = open(store->directory, O_RDONLY | O_DIRECTORY);
+
+    if (directory_fd == -1)
+    {
+        return STORE_ERROR;
+    }
+
+    store->fd = openat(directory_fd, file_name, O_WRONLY | O_CREAT | O_EXCL, 0644);
+    close(directory_fd);
+
+    if (store->fd == -1)
+    {
+        return STORE_ERROR;
+    }
+
+    memset(&header, 0, sizeof(header));
+
+    store->segment_offset = sizeof(header);
+    store->segment_records = 0;
+    store->blocks_number = 0;
+
+    return store_write(store->fd, &header, sizeof(header));
+}
+
+/*
+ * The helper function for closing the current segment. The index
+ * and the header are written.
+ *
+ * @param store Pointer to the store.
+ * @return      Status of function processing.
+ */
+static uint8_t store_close_segment (flow_store_t store)
+{
+    static const uint8_t padding[sizeof(uint64_t)] = { 0 };
+    uint8_t status;
+    struct store_segment_header header;
+    // The index is aligned for the mapping, the compressed blocks are not.
+    size_t padding_length = (sizeof(uint64_t) - store->segment_offset % sizeof(uint64_t)) %
+                            sizeof(uint64_t);
+
+    status = store_write(store->fd, padding, padding_length);
+    store->segment_offset += padding_length;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, STORE_MAGIC, sizeof(header.magic));
+    header.version = STORE_VERSION;
+    header.header_size = sizeof(header);
+    header.byte_order = STORE_BYTE_ORDER;
+    header.flags = store->compressed ? STORE_COMPRESSED : 0;
+    header.records_number = store->segment_records;
+    header.first_ms = UINT64_MAX;
+    header.index_offset = store->segment_offset;
+    header.blocks_number = store->blocks_number;
+    header.block_records = STORE_BLOCK_RECORDS;
+
+    for (uint32_t i = 0; i < store->blocks_number; i++)
+    {
+        header.first_ms = (store->index[i].first_ms < header.first_ms) ?
+                          store->index[i].first_ms : header.first_ms;
+        header.last_ms = (store->index[i].last_ms > header.last_ms) ?
+                         store->index[i].last_ms : header.last_ms;
+    }
+
+    if (status == NO_ERROR)
+    {
+        status = store_write(store->fd, store->index,
+                             store->blocks_number * sizeof(struct store_index_entry));
+    }
+
+    // The magic marks the segment as complete, so the header is written last.
+    if (status == NO_ERROR &&
+        pwrite(store->fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header))
+    {
+        status = STORE_ERROR;
+    }
+
+    if (close(store->fd) != 0)
+    {
+        status = STORE_ERROR;
+    }
+
+    store->fd = -1;
+    store->segment_number++;
+    store->segments_number++;
+
+    return status;
+}
+
+/*
+ * The helper function for appending the collected block to the current
+ * segment and indexing it.
+ *
+ * @param store Pointer to the store.
+ * @return      Status of function processing.
+ */
+static uint8_t store_flush_block (flow_store_t store)
+{
+    uint8_t status = NO_ERROR;
+    store_index_entry_t entry;
+    sink_record_t record;
+    const void* data = store->block;
+    size_t length = store->block_records * sizeof(struct sink_record);
+
+    if (store->fd == -1)
+    {
+        status = store_next_segment(store);
+
+        if (status != NO_ERROR)
+        {
+            return status;
+        }
+    }
+
+    entry = &(store->index[store->blocks_number]);
+    memset(entry, 0, sizeof(struct store_index_entry));
+    entry->first_ms = UINT64_MAX;
+
+    for (uint32_t i = 0; i < store->block_records; i++)
+    {
+        record = &(store->block[i]);
+
+        entry->first_ms = (record->first_ms < entry->first_ms) ? record->first_ms : entry->first_ms;
+        entry->last_ms = (record->last_ms > entry->last_ms) ? record->last_ms : entry->last_ms;
+
+        store_bloom_add(entry->address_bloom, STORE_ADDRESS_BITS, record->src_addr);
+        store_bloom_add(entry->address_bloom, STORE_ADDRESS_BITS, record->dst_addr);
+        store_bloom_add(entry->port_bloom, STORE_PORT_BITS, record->src_port);
+        store_bloom_add(entry->port_bloom, STORE_PORT_BITS, record->dst_port);
+    }
+
+    if (store->compressed)
+    {
+        data = store->encoded;
+        length = store_encode_block(store);
+    }
+
+    entry->offset = store->segment_offset;
+    entry->length = (uint32_t) length;
+    entry->records_number = store->block_records;
+
+    status = store_write(store->fd, data, length);
+
+    if (status != NO_ERROR)
+    {
+        return status;
+    }
+
+    store->segment_offset += length;
+    store->segment_records += store->block_records;
+    store->raw_bytes += store->block_records * sizeof(struct sink_record);
+    store->stored_bytes += length;
+    store->blocks_number++;
+    store->block_records = 0;
+
+    if (store->blocks_number == STORE_SEGMENT_BLOCKS)
+    {
+        status = store_close_segment(store);
+    }
+
+    return status;
+}
+
+/*
+ * Function for opening the flow store. The directory is created
+ * if it does not exist.
+ *
+ * @param store      Pointer to the allocated store.
+ * @param directory  The directory of the segments.
+ * @param compressed The blocks are compressed.
+ * @return           Status of function processing.
+ */
+uint8_t store_open (flow_store_t store, const char* directory, bool compressed)
+{
+    DIR* entries;
+    struct dirent* entry;
+    unsigned int number;
+
+    store->directory = directory;
+    store->fd = -1;
+    store->segment_number = 0;
+    store->block_records = 0;
+    store->blocks_number = 0;
+    store->compressed = compressed;
+    store->records_number = 0;
+    store->raw_bytes = 0;
+    store->stored_bytes = 0;
+    store->segments_number = 0;
+
+    if (mkdir(directory, 0755) != 0 && errno != EEXIST)
+    {
+        return STORE_ERROR;
+    }
+
+    entries = opendir(directory);
+
+    if (entries == NULL)
+    {
+        return STORE_ERROR;
+    }
+
+    // The segments are appended after the segments of the previous runs.
+    while ((entry = readdir(entries)) != NULL)
+    {
+        if (sscanf(entry->d_name, "flows-%u.seg", &number) == 1 &&
+            number >= store->segment_number)
+        {
+            store->segment_number = number + 1;
+        }
+    }
+
+    closedir(entries);
+
+    return NO_ERROR;
+}
+
+/*
+ * Function for writing flows into the flow store. A biflow is written
+ * as two records, one per direction.
+ *
+ * @param store        Pointer to the store.
+ * @param flows        An array of flows to write.
+ * @param flows_number The number of flows in the array of flows to write.
+ * @return             Status of function processing.
+ */
+uint8_t store_write_flows (flow_store_t store,
+                           flow_node_t* flows,
+                           const uint16_t flows_number)
+{
+    uint8_t status = NO_ERROR;
+
+    for (uint16_t i = 0; i < flows_number && status == NO_ERROR; i++)
+    {
+        // The initiator direction, then the reverse direction of a biflow.
+        for (uint8_t direction = 0; direction < 2 && status == NO_ERROR; direction++)
+        {
+            if (direction == 1 && flow_reverse_direction(flows[i]) == NULL)
+            {
+                break;
+            }
+
+            sink_fill_record(&(store->block[store->block_records]), flows[i], direction == 1);
+            store->block_records++;
+            store->records_number++;
+
+            if (store->block_records == STORE_BLOCK_RECORDS)
+            {
+                status = store_flush_block(store);
+            }
+        }
+    }
+
+    return status;
+}
+
+/*
+ * Function for closing the flow store. The last block and the index
+ * of the current segment are written.
+ *
+ * @param store Pointer to the store.
+ * @return      Status of function processing.
+ */
+uint8_t store_close (flow_store_t store)
+{
+    uint8_t status = NO_ERROR;
+
+    if (store->block_records > 0)
+    {
+        status = store_flush_block(store);
+    }
+
+    if (store->fd != -1)
+    {
+        if (status == NO_ERROR)
+        {
+            status = store_close_segment(store);
+        }
+        else
+        {
+            close(store->fd);
+            store->fd = -1;
+        }
+    }
+
+    return status;
+}
+
+/*
+ * Function for mapping a segment file. The incomplete segments
+ * are rejected.
+ *
+ * @param segment   Pointer to the segment.
+ * @param file_name The name of the segment file.
+ * @return          Status of function processing.
+ */
+uint8_t store_segment_open (store_segment_t segment, const char* file_name)
+{
+    struct stat file_stat;
+    void* data;
+    int fd = open(file_name, O_RDONLY);
+
+    segment->data = NULL;
+    segment->size = 0;
+
+    if (fd == -1)
+    {
+        return STORE_ERROR;
+    }
+
+    if (fstat(fd, &file_stat) != 0 || (size_t) file_stat.st_size < sizeof(struct store_segment_header))
+    {
+        close(fd);
+
+        return STORE_ERROR;
+    }
+
+    data = mmap(NULL, (size_t) file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+    {
+        return STORE_ERROR;
+    }
+
+    segment->data = (uint8_t*) data;
+    segment->size = (size_t) file_stat.st_size;
+    segment->header = (store_segment_header_t) data;
+    segment->index = (store_index_entry_t) (segment->data + segment->header->index_offset);
+
+    if (memcmp(segment->header->magic, STORE_MAGIC, sizeof(segment->header->magic)) != 0 ||
+        segment->header->version != STORE_VERSION ||
+        segment->header->byte_order != STORE_BYTE_ORDER ||
+        segment->header->block_records != STORE_BLOCK_RECORDS ||
+        segment->header->index_offset % sizeof(uint64_t) != 0 ||
+        segment->header->index_offset > segment->size ||
+        (segment->size - segment->header->index_offset) / sizeof(struct store_index_entry) <
+        segment->header->blocks_number)
+    {
+        store_segment_close(segment);
+
+        return STORE_ERROR;
+    }
+
+    return NO_ERROR;
+}
+
+/*
+ * Function for unmapping a segment file.
+ *
+ * @param segment Pointer to the segment.
+ */
+void store_segment_close (store_segment_t segment)
+{
+    if (segment->data != NULL)
+    {
+        munmap(segment->data, segment->size);
+        segment->data = NULL;
+    }
+}
+
+/*
+ * Function for reading the records of a block.
+ *
+ * @param segment Pointer to the segment.
+ * @param block   The index of the block.
+ * @param records Output parameter for STORE_BLOCK_RECORDS records.
+ * @return        The number of read records, 0 if the block is corrupted.
+ */
+uint32_t store_read_block (store_segment_t segment, uint32_t block, sink_record_t records)
+{
+    store_index_entry_t entry = &(segment->index[block]);
+
+    if (entry->records_number > STORE_BLOCK_RECORDS ||
+        entry->offset > segment->header->index_offset ||
+        entry->length > segment->header->index_offset - entry->offset)
+    {
+        return 0;
+    }
+
+    if (segment->header->flags & STORE_COMPRESSED)
+    {
+        if (!store_decode_block(segment->data + entry->offset, entry->length,
+                                entry->records_number, records))
+        {
+            return 0;
+        }
+    }
+    else
+    {
+        if (entry->length != entry->records_number * sizeof(struct sink_record))
+        {
+            return 0;
+        }
+
+        memcpy(records, segment->data + entry->offset, entry->length);
+    }
+
+    return entry->records_number;
+}
@@ -0,0 +1,196 @@
+/**********************************************************/
+/*                                                        */
+/* File: store.h                                          */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Header file for the time-indexed flow     */
+/*              store                                     */
+/*                                                        */
+/**********************************************************/
+
+#ifndef FLOW_STORE_H
+#define FLOW_STORE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "netflow_v5.h"
+#include "sink.h"
+
+#define STORE_MAGIC          "FSEG"
+#define STORE_VERSION        (1)
+#define STORE_BYTE_ORDER     (0x01020304) // Written in the byte order of the writer.
+#define STORE_BLOCK_RECORDS  (256)
+#define STORE_SEGMENT_BLOCKS (4096)       // A segment has up to 1048576 records.
+// The Bloom filters are sized for the addresses and ports of a block,
+// about 5 % false positives for the addresses.
+#define STORE_ADDRESS_BITS   (12)
+#define STORE_PORT_BITS      (11)
+#define STORE_ADDRESS_WORDS  ((1 << STORE_ADDRESS_BITS) / 64)
+#define STORE_PORT_WORDS     ((1 << STORE_PORT_BITS) / 64)
+#define STORE_COMPRESSED     (1)          // The flag of the compressed blocks.
+#define STORE_NAME_LENGTH    (32)
+#define STORE_NAME_FORMAT    "flows-%08u.seg"
+// The longest compressed record, the varints take up to 10 bytes.
+#define STORE_RECORD_MAX     (4 * 10 + 2 * 5 + 3 * 4 + 2 * 2 + 5)
+
+typedef struct store_segment_header* store_segment_header_t;
+typedef struct store_index_entry* store_index_entry_t;
+typedef struct flow_store* flow_store_t;
+typedef struct store_segment* store_segment_t;
+
+/*
+ * Structure to store the header of a segment file. The header is written
+ * when the segment is closed, a segment without the magic is incomplete.
+ */
+struct store_segment_header
+{
+    char magic[4];             // STORE_MAGIC without the terminating zero.
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t byte_order;       // STORE_BYTE_ORDER.
+    uint32_t flags;            // STORE_COMPRESSED or 0.
+    uint64_t records_number;
+    uint64_t first_ms;         // The earliest first time of the records.
+    uint64_t last_ms;          // The latest last time of the records.
+    uint64_t index_offset;     // The index follows the blocks.
+    uint32_t blocks_number;
+    uint32_t block_records;    // STORE_BLOCK_RECORDS.
+    uint8_t pad[8];
+};
+
+/*
+ * Structure to store the sparse index entry of a block. A block is read
+ * only if its time range overlaps the queried one and the Bloom filters
+ * may contain the queried address and port.
+ */
+struct store_index_entry
+{
+    uint64_t offset;
+    uint64_t first_ms;         // The earliest first time of the records.
+    uint64_t last_ms;          // The latest last time of the records.
+    uint32_t length;           // The stored length in bytes.
+    uint32_t records_number;
+    uint64_t address_bloom[STORE_ADDRESS_WORDS]; // Both addresses of the records.
+    uint64_t port_bloom[STORE_PORT_WORDS];       // Both ports of the records.
+};
+
+/*
+ * Structure to store the flow store writer. The records are collected
+ * in a block, a full block is appended to the current segment
+ * and indexed. The index and the header are written when the segment
+ * is full or the store is closed. The segments of the previous runs
+ * are kept, the numbering continues after them.
+ */
+struct flow_store
+{
+    const char* directory;
+    int fd;                          // The current segment or -1.
+    uint32_t segment_number;         // The number in the name of the next segment.
+    uint64_t segment_offset;         // The written bytes of the current segment.
+    uint64_t segment_records;
+    struct sink_record* block;       // STORE_BLOCK_RECORDS records.
+    uint32_t block_records;
+    uint8_t* encoded;                // The compressed block.
+    struct store_index_entry* index; // STORE_SEGMENT_BLOCKS entries.
+    uint32_t blocks_number;
+    bool compressed;
+    uint64_t records_number;
+    uint64_t raw_bytes;              // The size of the records uncompressed.
+    uint64_t stored_bytes;           // The size of the written blocks.
+    uint32_t segments_number;        // The segments written by this run.
+};
+
+/*
+ * Structure to store a segment mapped for the reading.
+ */
+struct store_segment
+{
+    uint8_t* data;
+    size_t size;
+    store_segment_header_t header;
+    store_index_entry_t index;
+};
+
+/*
+ * Function for opening the flow store. The directory is created
+ * if it does not exist.
+ *
+ * @param store      Pointer to the allocated store.
+ * @param directory  The directory of the segments.
+ * @param compressed The blocks are compressed.
+ * @return           Status of function processing.
+ */
+uint8_t store_open (flow_store_t store, const char* directory, bool compressed);
+
+/*
+ * Function for writing flows into the flow store. A biflow is written
+ * as two records, one per direction.
+ *
+ * @param store        Pointer to the store.
+ * @param flows        An array of flows to write.
+ * @param flows_number The number of flows in the array of flows to write.
+ * @return             Status of function processing.
+ */
+uint8_t store_write_flows (flow_store_t store,
+                           flow_node_t* flows,
+                           const uint16_t flows_number);
+
+/*
+ * Function for closing the flow store. The last block and the index
+ * of the current segment are written.
+ *
+ * @param store Pointer to the store.
+ * @return      Status of function processing.
+ */
+uint8_t store_close (flow_store_t store);
+
+/*
+ * Function for mapping a segment file. The incomplete segments
+ * are rejected.
+ *
+ * @param segment   Pointer to the segment.
+ * @param file_name The name of the segment file.
+ * @return          Status of function processing.
+ */
+uint8_t store_segment_open (store_segment_t segment, const char* file_name);
+
+/*
+ * Function for unmapping a segment file.
+ *
+ * @param segment Pointer to the segment.
+ */
+void store_segment_close (store_segment_t segment);
+
+/*
+ * Function for reading the records of a block.
+ *
+ * @param segment Pointer to the segment.
+ * @param block   The index of the block.
+ * @param records Output parameter for STORE_BLOCK_RECORDS records.
+ * @return        The number of read records, 0 if the block is corrupted.
+ */
+uint32_t store_read_block (store_segment_t segment, uint32_t block, sink_record_t records);
+
+/*
+ * Function for checking whether a block may contain an address.
+ *
+ * @param entry The index entry of the block.
+ * @param addr  The address in the network byte order.
+ * @return      False if the block surely does not contain the address.
+ */
+bool store_block_has_address (store_index_entry_t entry, uint32_t addr);
+
+/*
+ * Function for checking whether a block may contain a port.
+ *
+ * @param entry The index entry of the block.
+ * @param port  The port.
+ * @return      False if the block surely does not contain the port.
+ */
+bool store_block_has_port (store_index_entry_t entry, uint16_t port);
+
+#endif // FLOW_STORE_H
@@ -0,0 +1,66 @@
+/**********************************************************/
+/*                                                        */
+/* File: alloc_counter.c                                  */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Counting of the heap allocations          */
+/*              for the allocation test                   */
+/*                                                        */
+/**********************************************************/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// The program is linked with --wrap, so its calls of the allocation
+// functions come here and the real functions are reached by __real_.
+void* __real_malloc (size_t size);
+void* __real_calloc (size_t number, size_t size);
+void* __real_realloc (void* pointer, size_t size);
+void __real_free (void* pointer);
+
+static uint64_t allocations_number = 0;
+static uint64_t frees_number = 0;
+
+void* __wrap_malloc (size_t size)
+{
+    allocations_number++;
+
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc (size_t number, size_t size)
+{
+    allocations_number++;
+
+    return __real_calloc(number, size);
+}
+
+void* __wrap_realloc (void* pointer, size_t size)
+{
+    allocations_number++;
+
+    return __real_realloc(pointer, size);
+}
+
+void __wrap_free (void* pointer)
+{
+    if (pointer != NULL)
+    {
+        frees_number++;
+    }
+
+    __real_free(pointer);
+}
+
+/*
+ * Function for printing the counters when the program finishes.
+ */
+__attribute__((destructor))
+static void alloc_counter_report (void)
+{
+    fprintf(stderr, "allocations: %lu\n", allocations_number);
+    fprintf(stderr, "frees: %lu\n", frees_number);
+}
@@ -0,0 +1,81 @@
+#!/bin/sh
+#**********************************************************
+#
+# File: alloc_test.sh
+# Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>
+# Project: Project for the course ISA - variant 1
+#          - Generation of NetFlow data from captured
+#            network traffic.
+# Description: Test of the heap allocations per packet
+#
+#**********************************************************
+#
+# The same flows are processed for a short and a four times longer
+# capture. The flows are created, updated, expired by the active timer
+# and exported many times more in the longer run, so any allocation
+# after the warm-up makes the counts differ. The flows are exported
+# to a local collector and written to the flow file.
+#
+# Usage: alloc_test.sh <flow_with_counter> <gen_pcap> <collector> <directory>
+
+FLOW=$1
+GEN_PCAP=$2
+COLLECTOR=$3
+DIRECTORY=$4
+
+FLOWS=300
+PACKETS=30000
+DURATION=120 # Not SECONDS, which is a special variable of bash.
+
+run_counted ()
+{
+    "$FLOW" "$@" >/dev/null 2>"$DIRECTORY/alloc.err" || return 1
+    sed -n 's/^allocations: //p' "$DIRECTORY/alloc.err"
+}
+
+# The same options are run for both captures.
+check_allocations ()
+{
+    NAME=$1
+    shift
+
+    SHORT=$(run_counted -f "$DIRECTORY/alloc_short.pcap" "$@")
+    LONG=$(run_counted -f "$DIRECTORY/alloc_long.pcap" "$@")
+
+    if [ -z "$SHORT" ] || [ -z "$LONG" ]; then
+        echo "alloc_test: FAILED, $NAME: the exporter failed" \
+             "or the allocation counter did not report"
+        return 1
+    fi
+
+    if [ "$SHORT" != "$LONG" ]; then
+        echo "alloc_test: FAILED, $NAME: $SHORT allocations for $PACKETS packets," \
+             "$LONG allocations for $((PACKETS * 4)) packets"
+        return 1
+    fi
+
+    echo "alloc_test: passed, $NAME: $SHORT allocations for both" \
+         "$PACKETS and $((PACKETS * 4)) packets"
+}
+
+"$GEN_PCAP" "$DIRECTORY/alloc_short.pcap" $FLOWS $PACKETS $DURATION || exit 1
+"$GEN_PCAP" "$DIRECTORY/alloc_long.pcap" $FLOWS $((PACKETS * 4)) $((DURATION * 4)) || exit 1
+
+# The datagrams are sent to the local collector, so the records
+# are filled into the datagram buffer and sent for every export.
+set -- $("$COLLECTOR")
+
+if [ -z "$1" ]; then
+    echo "alloc_test: FAILED, the collector did not start"
+    exit 1
+fi
+
+check_allocations "UDP export" -c "127.0.0.1:$1"
+RESULT=$?
+
+check_allocations "flow file" -o "$DIRECTORY/alloc_long.bin" || RESULT=1
+
+kill "$2"
+rm -f "$DIRECTORY"/alloc_short.* "$DIRECTORY"/alloc_long.* "$DIRECTORY/alloc.err"
+
+exit $RESULT
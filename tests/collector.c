@@ -0,0 +1,74 @@
+/**********************************************************/
+/*                                                        */
+/* File: collector.c                                      */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Local UDP collector                       */
+/*              for the allocation test                   */
+/*                                                        */
+/**********************************************************/
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define COLLECTOR_LIFETIME (120) // The collector is ended by the test before.
+
+/*
+ * The collector binds a UDP socket on the loopback and prints its port
+ * and the process id of the child which keeps the socket open. The sent
+ * datagrams are not refused, they are never read and the kernel drops
+ * the ones over the socket buffer.
+ *
+ * Usage: collector
+ */
+int main (void)
+{
+    struct sockaddr_in address;
+    socklen_t address_length = sizeof(address);
+    pid_t pid;
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (fd == -1)
+    {
+        return EXIT_FAILURE;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0; // Any free port.
+
+    if (bind(fd, (struct sockaddr*) &address, sizeof(address)) != 0 ||
+        getsockname(fd, (struct sockaddr*) &address, &address_length) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    pid = fork();
+
+    if (pid == -1)
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (pid == 0)
+    {
+        // The output is closed, so the test does not wait for the child.
+        close(STDOUT_FILENO);
+        alarm(COLLECTOR_LIFETIME);
+        pause();
+
+        return EXIT_SUCCESS;
+    }
+
+    printf("%u %d\n", ntohs(address.sin_port), (int) pid);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+/**********************************************************/
+/*                                                        */
+/* File: gen_pcap.c                                       */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Generator of the pcap files               */
+/*              for the allocation test                   */
+/*                                                        */
+/**********************************************************/
+
+#include <arpa/inet.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PCAP_MAGIC       (0xa1b2c3d4)
+#define LINKTYPE_EN10MB  (1)
+#define START_SECONDS    (1600000000)
+#define FRAME_SIZE       (14 + 20 + 8 + 22) // Ethernet, IPv4, UDP and payload.
+
+/*
+ * Structure to store the header of a pcap file.
+ */
+struct pcap_file_header
+{
+    uint32_t magic;
+    uint16_t version_major;
+    uint16_t version_minor;
+    int32_t thiszone;
+    uint32_t sigfigs;
+    uint32_t snaplen;
+    uint32_t linktype;
+};
+
+/*
+ * Structure to store the header of a pcap record.
+ */
+struct pcap_record_header
+{
+    uint32_t seconds;
+    uint32_t microseconds;
+    uint32_t caplen;
+    uint32_t len;
+};
+
+/*
+ * The helper function for building the UDP frame of a flow.
+ *
+ * @param frame The filled frame.
+ * @param flow  The number of the flow.
+ */
+static void fill_frame (uint8_t* frame, uint32_t flow)
+{
+    uint8_t* ip = frame + 14;
+    uint8_t* udp = ip + 20;
+    uint32_t src_addr = htonl(0x0a000000 | (flow & 0xffff));
+    uint32_t dst_addr = htonl(0xc0a80001);
+    uint16_t value;
+
+    memset(frame, 0, FRAME_SIZE);
+
+    // Ethernet with the IPv4 EtherType.
+    frame[12] = 0x08;
+    frame[13] = 0x00;
+
+    ip[0] = 0x45;
+    value = htons(FRAME_SIZE - 14);
+    memcpy(ip + 2, &value, sizeof(value));
+    ip[8] = 64;
+    ip[9] = 17;
+    memcpy(ip + 12, &src_addr, sizeof(src_addr));
+    memcpy(ip + 16, &dst_addr, sizeof(dst_addr));
+
+    value = htons((uint16_t) (10000 + flow % 50000));
+    memcpy(udp, &value, sizeof(value));
+    value = htons(53);
+    memcpy(udp + 2, &value, sizeof(value));
+    value = htons(FRAME_SIZE - 14 - 20);
+    memcpy(udp + 4, &value, sizeof(value));
+}
+
+/*
+ * The generator writes the packets of a fixed number of flows evenly
+ * spread over the duration, the flows take turns.
+ *
+ * Usage: gen_pcap <file> <flows> <packets> <seconds>
+ */
+int main (int argc, char* argv[])
+{
+    struct pcap_file_header file_header = { PCAP_MAGIC, 2, 4, 0, 0, 65535, LINKTYPE_EN10MB };
+    struct pcap_record_header record_header;
+    uint8_t frame[FRAME_SIZE];
+    uint64_t packets;
+    uint64_t time_us;
+    uint64_t step_us;
+    uint32_t flows;
+    FILE* file;
+
+    if (argc != 5)
+    {
+        fprintf(stderr, "Usage: %s <file> <flows> <packets> <seconds>\n", argv[0]);
+
+        return EXIT_FAILURE;
+    }
+
+    flows = (uint32_t) strtoul(argv[2], NULL, 10);
+    packets = strtoull(argv[3], NULL, 10);
+    step_us = (packets > 0) ? strtoull(argv[4], NULL, 10) * 1000000 / packets : 0;
+
+    if (flows == 0 || (file = fopen(argv[1], "wb")) == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+
+    fwrite(&file_header, sizeof(file_header), 1, file);
+
+    for (uint64_t i = 0; i < packets; i++)
+    {
+        time_us = i * step_us;
+
+        record_header.seconds = (uint32_t) (START_SECONDS + time_us / 1000000);
+        record_header.microseconds = (uint32_t) (time_us % 1000000);
+        record_header.caplen = FRAME_SIZE;
+        record_header.len = FRAME_SIZE;
+
+        fill_frame(frame, (uint32_t) (i % flows));
+
+        fwrite(&record_header, sizeof(record_header), 1, file);
+        fwrite(frame, sizeof(frame), 1, file);
+    }
+
+    if (fclose(file) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,79 @@
+#!/bin/sh
+#**********************************************************
+#
+# File: window_test.sh
+# Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>
+# Project: Project for the course ISA - variant 1
+#          - Generation of NetFlow data from captured
+#            network traffic.
+# Description: Test of the flows exported by the time windows
+#
+#**********************************************************
+#
+# The long flows of the capture are cut by the active timer many times.
+# The records of three adjacent windows must be exactly the records
+# of one window over the whole capture, so every packet is exported once.
+#
+# Usage: window_test.sh <flow> <gen_pcap> <directory>
+
+FLOW=$1
+GEN_PCAP=$2
+DIRECTORY=$3
+
+FLOWS=200
+PACKETS=60000
+DURATION=600
+START=1600000000 # The first packet time of gen_pcap.
+# The window bounds are not the multiples of the active timeout.
+FIRST_BOUND=$((START + 250))
+SECOND_BOUND=$((START + 430))
+
+# The records of the flow file without the header, one line per record.
+print_records ()
+{
+    od -A n -t u8 -w64 -v -j 64 "$1"
+}
+
+run_window ()
+{
+    OUTPUT=$1
+    shift
+
+    "$FLOW" -f "$DIRECTORY/window.pcap" -o "$OUTPUT" "$@" >/dev/null
+}
+
+"$GEN_PCAP" "$DIRECTORY/window.pcap" $FLOWS $PACKETS $DURATION || exit 1
+
+RESULT=0
+
+if ! run_window "$DIRECTORY/window_all.bin" --from $START ||
+   ! run_window "$DIRECTORY/window_1.bin" --to $FIRST_BOUND ||
+   ! run_window "$DIRECTORY/window_2.bin" --from $FIRST_BOUND --to $SECOND_BOUND ||
+   ! run_window "$DIRECTORY/window_3.bin" --from $SECOND_BOUND
+then
+    echo "window_test: FAILED, the exporter failed"
+    RESULT=1
+else
+    print_records "$DIRECTORY/window_all.bin" | sort > "$DIRECTORY/window_all.txt"
+    for WINDOW in 1 2 3; do
+        print_records "$DIRECTORY/window_$WINDOW.bin"
+    done | sort > "$DIRECTORY/window_split.txt"
+
+    RECORDS=$(wc -l < "$DIRECTORY/window_all.txt")
+    EXPORTED=$(awk '{ packets += $1 } END { print packets }' "$DIRECTORY/window_split.txt")
+
+    if ! cmp -s "$DIRECTORY/window_all.txt" "$DIRECTORY/window_split.txt" ||
+       [ "$EXPORTED" != "$PACKETS" ]
+    then
+        echo "window_test: FAILED, $EXPORTED of $PACKETS packets exported by the windows," \
+             "the records differ from one window"
+        RESULT=1
+    else
+        echo "window_test: passed, $RECORDS records of $PACKETS packets" \
+             "exported once by three windows"
+    fi
+fi
+
+rm -f "$DIRECTORY"/window.pcap* "$DIRECTORY"/window_*.bin "$DIRECTORY"/window_*.txt
+
+exit $RESULT
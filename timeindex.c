@@ -0,0 +1,423 @@
+/**********************************************************/
+/*                                                        */
+/* File: timeindex.c                                      */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Time index of the pcap files              */
+/*                                                        */
+/**********************************************************/
+
+#include "timeindex.h"
+
+#include <byteswap.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "error.h"
+
+#define TIME_INDEX_PATH_LENGTH (4096)
+
+// The magic numbers of the pcap files with microsecond and nanosecond
+// time stamps, the swapped ones are written in the other byte order.
+#define PCAP_MAGIC_US (0xa1b2c3d4)
+#define PCAP_MAGIC_NS (0xa1b23c4d)
+#define PCAP_HEADER_SIZE        (24)
+#define PCAP_RECORD_HEADER_SIZE (16)
+
+/*
+ * Function for parsing a time, either as "YYYY-MM-DD HH:MM:SS[.mmm]"
+ * in UTC or as seconds since the epoch.
+ *
+ * @param string The parsed string.
+ * @param time   Output parameter for the milliseconds since the epoch.
+ * @return       False if the string is not a time.
+ */
+bool parse_time_ms (const char* string, uint64_t* time)
+{
+    struct tm date;
+    unsigned int milliseconds = 0;
+    int length = 0;
+    int digits = 0;
+    double seconds;
+    char* end;
+
+    memset(&date, 0, sizeof(date));
+
+    if (sscanf(string, "%d-%d-%d%*[ T]%d:%d:%d%n",
+               &date.tm_year, &date.tm_mon, &date.tm_mday,
+               &date.tm_hour, &date.tm_min, &date.tm_sec, &length) == 6)
+    {
+        if (string[length] == '.' &&
+            sscanf(string + length + 1, "%3u%n", &milliseconds, &digits) == 1)
+        {
+            length += 1 + digits;
+
+            // The fraction ".5" is 500 milliseconds.
+            for (; digits < 3; digits++)
+            {
+                milliseconds *= 10;
+            }
+        }
+
+        if (string[length] != '\0')
+        {
+            return false;
+        }
+
+        date.tm_year -= 1900;
+        date.tm_mon -= 1;
+
+        *time = (uint64_t) timegm(&date) * 1000 + milliseconds;
+
+        return true;
+    }
+
+    seconds = strtod(string, &end);
+
+    if (*string == '\0' || *end != '\0' || seconds < 0)
+    {
+        return false;
+    }
+
+    *time = (uint64_t) (seconds * 1000);
+
+    return true;
+}
+
+/*
+ * The helper function for appending an entry to the index.
+ *
+ * @param index Pointer to the index.
+ * @param entry The appended entry.
+ * @return      Status of function processing.
+ */
+static uint8_t time_index_append (time_index_t index, const struct time_index_entry* entry)
+{
+    time_index_entry_t entries;
+    uint64_t capacity;
+
+    if (index->entries_number == index->entries_capacity)
+    {
+        capacity = (index->entries_capacity > 0) ? 2 * index->entries_capacity : 1024;
+        entries = (time_index_entry_t) realloc(index->entries,
+                                               capacity * sizeof(struct time_index_entry));
+
+        if (entries == NULL)
+        {
+            return MEMORY_HANDLING_ERROR;
+        }
+
+        index->entries = entries;
+        index->entries_capacity = capacity;
+    }
+
+    index->entries[index->entries_number] = *entry;
+    index->entries_number++;
+
+    return NO_ERROR;
+}
+
+/*
+ * The helper function for building the index by reading the record
+ * headers of a pcap file. The packet data are skipped. A truncated
+ * last record ends the index.
+ *
+ * @param index Pointer to the empty index.
+ * @param file  The pcap file.
+ * @return      Status of function processing.
+ */
+static uint8_t time_index_build (time_index_t index, FILE* file)
+{
+    uint32_t header[PCAP_HEADER_SIZE / sizeof(uint32_t)];
+    uint32_t record[PCAP_RECORD_HEADER_SIZE / sizeof(uint32_t)];
+    struct time_index_entry entry = { PCAP_HEADER_SIZE, 0, 0 };
+    uint64_t latest_ms = 0;
+    uint64_t boundary_ms = 0;
+    uint64_t packet_ms;
+    uint32_t fraction_divisor;
+    uint32_t caplen;
+    bool swapped;
+    uint8_t status;
+
+    if (fread(header, sizeof(header), 1, file) != 1)
+    {
+        return TIME_INDEX_ERROR;
+    }
+
+    // The pcapng files have no fixed record headers, so they are not indexed.
+    if (header[0] == PCAP_MAGIC_US || header[0] == bswap_32(PCAP_MAGIC_US))
+    {
+        fraction_divisor = 1000;
+    }
+    else if (header[0] == PCAP_MAGIC_NS || header[0] == bswap_32(PCAP_MAGIC_NS))
+    {
+        fraction_divisor = 1000000;
+    }
+    else
+    {
+        return TIME_INDEX_ERROR;
+    }
+
+    swapped = (header[0] != PCAP_MAGIC_US && header[0] != PCAP_MAGIC_NS);
+
+    status = time_index_append(index, &entry);
+
+    while (status == NO_ERROR && fread(record, sizeof(record), 1, file) == 1)
+    {
+        if (swapped)
+        {
+            record[0] = bswap_32(record[0]);
+            record[1] = bswap_32(record[1]);
+            record[2] = bswap_32(record[2]);
+        }
+
+        caplen = record[2];
+        packet_ms = (uint64_t) record[0] * 1000 + record[1] / fraction_divisor;
+
+        if (caplen > TIME_INDEX_MAX_CAPLEN)
+        {
+            break;
+        }
+
+        // The first packet of a new second or of the next packets
+        // starts an entry.
+        if (entry.packets_number > 0 &&
+            (packet_ms >= boundary_ms + TIME_INDEX_INTERVAL_MS ||
+             entry.packets_number - index->entries[index->entries_number - 1].packets_number >=
+             TIME_INDEX_PACKETS))
+        {
+            entry.time_ms = latest_ms;
+            status = time_index_append(index, &entry);
+            boundary_ms = packet_ms - packet_ms % TIME_INDEX_INTERVAL_MS;
+        }
+        else if (entry.packets_number == 0)
+        {
+            boundary_ms = packet_ms - packet_ms % TIME_INDEX_INTERVAL_MS;
+        }
+
+        latest_ms = (packet_ms > latest_ms) ? packet_ms : latest_ms;
+
+        if (fseeko(file, (off_t) caplen, SEEK_CUR) != 0)
+        {
+            break;
+        }
+
+        entry.offset += PCAP_RECORD_HEADER_SIZE + caplen;
+        entry.packets_number++;
+    }
+
+    return status;
+}
+
+/*
+ * The helper function for reading the index file. The index is used
+ * only if it belongs to the pcap file.
+ *
+ * @param index      Pointer to the empty index.
+ * @param index_name The name of the index file.
+ * @param pcap_stat  The status of the pcap file.
+ * @return           True if the index was read.
+ */
+static bool time_index_read (time_index_t index, const char* index_name, struct stat* pcap_stat)
+{
+    struct time_index_header header;
+    FILE* file = fopen(index_name, "rb");
+
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, TIME_INDEX_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != TIME_INDEX_VERSION ||
+        header.header_size != sizeof(header) ||
+        header.byte_order != TIME_INDEX_BYTE_ORDER ||
+        header.pcap_size != (uint64_t) pcap_stat->st_size ||
+        header.pcap_mtime_ns != (int64_t) pcap_stat->st_mtim.tv_sec * 1000000000 +
+                                pcap_stat->st_mtim.tv_nsec ||
+        header.entries_number == 0)
+    {
+        fclose(file);
+
+        return false;
+    }
+
+    index->entries = (time_index_entry_t) malloc(header.entries_number *
+                                                 sizeof(struct time_index_entry));
+
+    if (index->entries == NULL ||
+        fread(index->entries, sizeof(struct time_index_entry),
+              header.entries_number, file) != header.entries_number)
+    {
+        free(index->entries);
+        index->entries = NULL;
+        fclose(file);
+
+        return false;
+    }
+
+    index->entries_number = header.entries_number;
+    index->entries_capacity = header.entries_number;
+
+    fclose(file);
+
+    return true;
+}
+
+/*
+ * The helper function for saving the index file. The index is written
+ * under a temporary name and renamed. A failure is not an error,
+ * the index is just built again by the next run.
+ *
+ * @param index      Pointer to the index.
+ * @param index_name The name of the index file.
+ * @param pcap_stat  The status of the pcap file.
+ */
+static void time_index_save (time_index_t index, const char* index_name, struct stat* pcap_stat)
+{
+    struct time_index_header header;
+    char temporary[TIME_INDEX_PATH_LENGTH];
+    FILE* file;
+    bool written;
+
+    if (snprintf(temporary, sizeof(temporary), "%s.tmp", index_name) >= (int) sizeof(temporary))
+    {
+        return;
+    }
+
+    file = fopen(temporary, "wb");
+
+    if (file == NULL)
+    {
+        return;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TIME_INDEX_MAGIC, sizeof(header.magic));
+    header.version = TIME_INDEX_VERSION;
+    header.header_size = sizeof(header);
+    header.byte_order = TIME_INDEX_BYTE_ORDER;
+    header.pcap_size = (uint64_t) pcap_stat->st_size;
+    header.pcap_mtime_ns = (int64_t) pcap_stat->st_mtim.tv_sec * 1000000000 +
+                           pcap_stat->st_mtim.tv_nsec;
+    header.entries_number = index->entries_number;
+
+    written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(index->entries, sizeof(struct time_index_entry),
+                     index->entries_number, file) == index->entries_number;
+
+    if (fclose(file) != 0 || !written || rename(temporary, index_name) != 0)
+    {
+        remove(temporary);
+    }
+}
+
+/*
+ * Function for opening the time index of a pcap file. The index file
+ * next to the pcap file is used if it belongs to the pcap file,
+ * otherwise the index is built by reading the record headers
+ * and saved if the directory is writable.
+ *
+ * @param index     Pointer to the index.
+ * @param file_name The name of the pcap file.
+ * @return          Status of function processing.
+ */
+uint8_t time_index_open (time_index_t index, const char* file_name)
+{
+    char index_name[TIME_INDEX_PATH_LENGTH];
+    struct stat pcap_stat;
+    uint8_t status;
+    FILE* file;
+
+    index->entries = NULL;
+    index->entries_number = 0;
+    index->entries_capacity = 0;
+    index->built = false;
+
+    if (snprintf(index_name, sizeof(index_name), "%s%s", file_name, TIME_INDEX_SUFFIX) >=
+        (int) sizeof(index_name) ||
+        stat(file_name, &pcap_stat) != 0 ||
+        !S_ISREG(pcap_stat.st_mode))
+    {
+        return TIME_INDEX_ERROR;
+    }
+
+    if (time_index_read(index, index_name, &pcap_stat))
+    {
+        return NO_ERROR;
+    }
+
+    file = fopen(file_name, "rb");
+
+    if (file == NULL)
+    {
+        return TIME_INDEX_ERROR;
+    }
+
+    status = time_index_build(index, file);
+    fclose(file);
+
+    if (status != NO_ERROR)
+    {
+        time_index_close(index);
+
+        return status;
+    }
+
+    index->built = true;
+    time_index_save(index, index_name, &pcap_stat);
+
+    return NO_ERROR;
+}
+
+/*
+ * Function for finding the entry to start reading a time from.
+ * All packets before the entry are older than the time.
+ *
+ * @param index   Pointer to the index.
+ * @param time_ms The time in milliseconds since the epoch.
+ * @return        Pointer to the entry.
+ */
+time_index_entry_t time_index_find (time_index_t index, uint64_t time_ms)
+{
+    uint64_t low = 0;
+    uint64_t high = index->entries_number;
+    uint64_t middle;
+
+    // The last entry whose older packets are all before the time,
+    // the first entry has no older packets.
+    while (high - low > 1)
+    {
+        middle = low + (high - low) / 2;
+
+        if (index->entries[middle].time_ms < time_ms)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return &(index->entries[low]);
+}
+
+/*
+ * Function for releasing the entries of the time index.
+ *
+ * @param index Pointer to the index.
+ */
+void time_index_close (time_index_t index)
+{
+    free(index->entries);
+    index->entries = NULL;
+    index->entries_number = 0;
+    index->entries_capacity = 0;
+}
@@ -0,0 +1,110 @@
+/**********************************************************/
+/*                                                        */
+/* File: timeindex.h                                      */
+/* Author: David Chocholaty <xchoch09@stud.fit.vutbr.cz>  */
+/* Project: Project for the course ISA - variant 1        */
+/*          - Generation of NetFlow data from captured    */
+/*            network traffic.                            */
+/* Description: Header file for the time index            */
+/*              of the pcap files                         */
+/*                                                        */
+/**********************************************************/
+
+#ifndef TIME_INDEX_H
+#define TIME_INDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TIME_INDEX_MAGIC       "PIDX"
+#define TIME_INDEX_VERSION     (1)
+#define TIME_INDEX_BYTE_ORDER  (0x01020304) // Written in the byte order of the writer.
+#define TIME_INDEX_SUFFIX      ".idx"
+#define TIME_INDEX_INTERVAL_MS (1000)       // An entry per second of the capture
+#define TIME_INDEX_PACKETS     (65536)      // or per the packets.
+#define TIME_INDEX_MAX_CAPLEN  (262144)     // The longer record is not a pcap record.
+
+typedef struct time_index_header* time_index_header_t;
+typedef struct time_index_entry* time_index_entry_t;
+typedef struct time_index* time_index_t;
+
+/*
+ * Structure to store the header of a time index file. The index belongs
+ * to the pcap file of the same size and modification time.
+ */
+struct time_index_header
+{
+    char magic[4];             // TIME_INDEX_MAGIC without the terminating zero.
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t byte_order;       // TIME_INDEX_BYTE_ORDER.
+    uint32_t pad;
+    uint64_t pcap_size;
+    int64_t pcap_mtime_ns;
+    uint64_t entries_number;
+};
+
+/*
+ * Structure to store an entry of the time index. The time stamps
+ * of a capture may go slightly back, so the entry holds the latest time
+ * of all packets before it. The packets before the entry are surely
+ * older than the time.
+ */
+struct time_index_entry
+{
+    uint64_t offset;           // The offset of a packet record in the pcap file.
+    uint64_t time_ms;          // The latest time of the packets before the offset.
+    uint64_t packets_number;   // The packets before the offset.
+};
+
+/*
+ * Structure to store the time index of a pcap file.
+ */
+struct time_index
+{
+    time_index_entry_t entries;
+    uint64_t entries_number;
+    uint64_t entries_capacity;
+    bool built;                // The index was built by this run.
+};
+
+/*
+ * Function for parsing a time, either as "YYYY-MM-DD HH:MM:SS[.mmm]"
+ * in UTC or as seconds since the epoch.
+ *
+ * @param string The parsed string.
+ * @param time   Output parameter for the milliseconds since the epoch.
+ * @return       False if the string is not a time.
+ */
+bool parse_time_ms (const char* string, uint64_t* time);
+
+/*
+ * Function for opening the time index of a pcap file. The index file
+ * next to the pcap file is used if it belongs to the pcap file,
+ * otherwise the index is built by reading the record headers
+ * and saved if the directory is writable.
+ *
+ * @param index     Pointer to the index.
+ * @param file_name The name of the pcap file.
+ * @return          Status of function processing.
+ */
+uint8_t time_index_open (time_index_t index, const char* file_name);
+
+/*
+ * Function for finding the entry to start reading a time from.
+ * All packets before the entry are older than the time.
+ *
+ * @param index   Pointer to the index.
+ * @param time_ms The time in milliseconds since the epoch.
+ * @return        Pointer to the entry.
+ */
+time_index_entry_t time_index_find (time_index_t index, uint64_t time_ms);
+
+/*
+ * Function for releasing the entries of the time index.
+ *
+ * @param index Pointer to the index.
+ */
+void time_index_close (time_index_t index);
+
+#endif // TIME_INDEX_H
@@ -75,6 +75,49 @@ uint32_t strtoui_32 (char* string)
     return (numeric_value > UINT32_MAX) ? 0L : numeric_value;
 }
 
+/*
+ * Function for convert string with a size to uint64_t. The size can be
+ * followed by one of the binary unit suffixes K, M, G or T.
+ *
+ * @param string Input string.
+ * @return       If string doesn't contain a size: 0L,
+ *               size in bytes in uint64_t data type otherwise.
+ */
+uint64_t strtoui_size (char* string)
+{
+    static const char* units = "KMGT";
+    char* unit;
+    char* end = NULL;
+    unsigned long long numeric_value;
+    unsigned int shift = 0;
+
+    if (!isdigit(string[0]))
+    {
+        return 0L;
+    }
+
+    numeric_value = strtoull(string, &end, 10);
+
+    if (*end != '\0')
+    {
+        unit = strchr(units, toupper(*end));
+
+        if (unit == NULL || end[1] != '\0')
+        {
+            return 0L;
+        }
+
+        shift = 10 * (unsigned int) (unit - units + 1);
+    }
+
+    if (numeric_value > (UINT64_MAX >> shift))
+    {
+        return 0L;
+    }
+
+    return (uint64_t) numeric_value << shift;
+}
+
 /*
  * Function checks if the value is in a range between the minimum
  * and maximum value including both range sides.
@@ -38,6 +38,16 @@ uint16_t strtoui_16 (char* string);
  */
 uint32_t strtoui_32 (char* string);
 
+/*
+ * Function for convert string with a size to uint64_t. The size can be
+ * followed by one of the binary unit suffixes K, M, G or T.
+ *
+ * @param string Input string.
+ * @return       If string doesn't contain a size: 0L,
+ *               size in bytes in uint64_t data type otherwise.
+ */
+uint64_t strtoui_size (char* string);
+
 /*
  * Function checks if the value is in a range between the minimum
  * and maximum value including both range sides.